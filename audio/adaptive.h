@@ -0,0 +1,359 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include <g40/nv2_util.h>
+#include <audio/rt_metrics.h>
+#include <audio/rs4.h>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// when the controller acts. loads are percentages of the buffer period
+		struct AdaptivePolicy
+		{
+			// mean load over the callbacks of one update interval that
+			// counts as pressure
+			double highLoad = 75.0;
+			// below this counts as calm
+			double lowLoad = 35.0;
+			// xruns (overflow, underflow or overrun) in one interval that
+			// count as pressure
+			uint64_t xruns = 1;
+			// seconds between successive degrade steps
+			double degradeHold = 0.5;
+			// seconds of calm before a restore step
+			double restoreHold = 5.0;
+			// candidate buffer sizes, ascending. empty never renegotiates
+			std::vector<unsigned int> bufferSizes = { 128, 256, 512, 1024, 2048 };
+			// ask for a bigger buffer once more than this many degrade steps
+			// are in force, or when there is nothing left to degrade
+			unsigned int growAfter = 2;
+			// calm for this long with every stage restored shrinks the buffer
+			double shrinkHold = 30.0;
+		};
+
+		//-----------------------------------------------------------------------------
+		// watches callback metrics from a control thread and trades quality
+		// for headroom. under pressure optional stages are stepped down one
+		// at a time in the order they were added, after a period of calm
+		// they are stepped back up in reverse. buffer size changes are only
+		// recommended while the stream runs and applied once it is idle.
+		// every decision is logged.
+		class AdaptiveController
+		{
+		public:
+			//
+			using clock_t = std::chrono::steady_clock;
+			//
+			struct Decision
+			{
+				enum Kind { eDegrade, eRestore, eBufferSize };
+				Kind kind = eDegrade;
+				// seconds since the controller was created
+				double time = 0;
+				// stage name or "samples"
+				std::string name;
+				int from = 0;
+				int to = 0;
+				// load and xruns that triggered it
+				double load = 0;
+				uint64_t xruns = 0;
+				//
+				std::string str() const
+				{
+					static const char* kinds[] = { "degrade", "restore", "buffer" };
+					return nv2::sprintf("%.3fs %s %s %d->%d load %.1f%% xruns %llu",
+						time, kinds[kind], name.c_str(), from, to, load, (unsigned long long)xruns);
+				}
+			};
+			//
+			using Apply = std::function<void(int level)>;
+			using Reopen = std::function<bool(unsigned int samples)>;
+			using Log = std::function<void(const Decision&)>;
+
+		private:
+			// level 0 is full quality, levels - 1 the cheapest
+			struct Stage
+			{
+				std::string name;
+				int levels = 1;
+				int level = 0;
+				Apply apply;
+			};
+			//
+			AdaptivePolicy m_policy;
+			std::vector<Stage> m_stages;
+			//
+			Reopen m_reopen;
+			unsigned int m_samples = 0;
+			unsigned int m_wanted = 0;
+			//
+			Log m_log;
+			std::vector<Decision> m_decisions;
+			//
+			clock_t::time_point m_start;
+			CallbackMetrics::Snapshot m_last;
+			bool m_primed = false;
+			double m_lastDegrade = -1e9;
+			double m_calmSince = -1;
+			//
+			double now() const
+			{
+				return std::chrono::duration<double>(clock_t::now() - m_start).count();
+			}
+			//
+			static uint64_t xruns(const CallbackMetrics::Snapshot& s)
+			{
+				return s.ipOverflows + s.opUnderflows + s.overruns;
+			}
+			//
+			void record(Decision::Kind kind, const std::string& name, int from, int to, double t, double load, uint64_t x)
+			{
+				Decision d;
+				d.kind = kind;
+				d.time = t;
+				d.name = name;
+				d.from = from;
+				d.to = to;
+				d.load = load;
+				d.xruns = x;
+				m_decisions.push_back(d);
+				if (m_log)
+					m_log(d);
+			}
+			// degrade steps currently in force
+			int depth() const
+			{
+				int ret = 0;
+				for (const Stage& s : m_stages)
+					ret += s.level;
+				return ret;
+			}
+			// next size up or down the ladder from the current one
+			unsigned int step(int direction) const
+			{
+				const std::vector<unsigned int>& sizes = m_policy.bufferSizes;
+				if (sizes.empty() || m_samples == 0)
+					return m_samples;
+				if (direction > 0)
+				{
+					for (unsigned int s : sizes)
+						if (s > m_samples)
+							return s;
+				}
+				else
+				{
+					for (auto it = sizes.rbegin(); it != sizes.rend(); ++it)
+						if (*it < m_samples)
+							return *it;
+				}
+				return m_samples;
+			}
+
+		public:
+			//
+			AdaptiveController(const AdaptivePolicy& policy = AdaptivePolicy()) :
+				m_policy(policy),
+				m_start(clock_t::now())
+			{
+			}
+			//
+			const AdaptivePolicy& policy() const { return m_policy; }
+			// every decision goes here as well as into decisions()
+			void setLog(Log log) { m_log = log; }
+			//
+			const std::vector<Decision>& decisions() const { return m_decisions; }
+
+			//-----------------------------------------------------------------------------
+			// an optional stage with 'levels' settings, 0 is full quality.
+			// apply is called on the control thread so must hand the change
+			// to the audio thread without blocking (an atomic or similar)
+			void addStage(const std::string& name, int levels, Apply apply)
+			{
+				Stage s;
+				s.name = name;
+				s.levels = std::max(levels, 1);
+				s.apply = apply;
+				m_stages.push_back(s);
+			}
+			// on/off stage, e.g. a flag the processor checks every callback
+			void addBypass(const std::string& name, std::atomic<bool>& bypass)
+			{
+				std::atomic<bool>* pb = &bypass;
+				addStage(name, 2, [pb](int level) { pb->store(level != 0, std::memory_order_relaxed); });
+			}
+			// resampler quality from its assigned value down to 'lowest'.
+			// RS4::request() is safe from any thread and never allocates
+			void addResampler(const std::string& name, RS4& rs, size_t lowest = 0)
+			{
+				RS4* prs = &rs;
+				const int top = (int)rs.assigned();
+				const int bottom = std::min((int)lowest, top);
+				addStage(name, top - bottom + 1, [prs, top](int level) { prs->request(size_t(top - level)); });
+			}
+			// how to reopen the stream with a new buffer size. only called
+			// while the stream is stopped
+			void setReopen(unsigned int samples, Reopen reopen)
+			{
+				m_samples = samples;
+				m_wanted = samples;
+				m_reopen = reopen;
+			}
+			// buffer size the controller would like, 0 if none is set
+			unsigned int wanted() const { return m_wanted; }
+			//
+			unsigned int samples() const { return m_samples; }
+
+			//-----------------------------------------------------------------------------
+			// call periodically from a control thread, a few times a second.
+			// returns true if anything changed
+			bool update(const CallbackMetrics::Snapshot& s, bool running)
+			{
+				const double t = now();
+				bool ret = false;
+				// idle. apply any pending buffer change
+				if (!running)
+				{
+					if (m_reopen && m_wanted != m_samples)
+					{
+						record(Decision::eBufferSize, "samples", (int)m_samples, (int)m_wanted, t, 0, 0);
+						if (m_reopen(m_wanted))
+							m_samples = m_wanted;
+						else
+							m_wanted = m_samples;
+						ret = true;
+					}
+					// counters restart with the stream
+					m_primed = false;
+					return ret;
+				}
+				if (!m_primed || s.callbacks < m_last.callbacks)
+				{
+					m_last = s;
+					m_primed = true;
+					m_calmSince = t;
+					return false;
+				}
+				if (s.callbacks == m_last.callbacks)
+					return false;
+				// this interval only
+				const uint64_t x = xruns(s) - xruns(m_last);
+				const double load = (s.totalLoad - m_last.totalLoad) / double(s.callbacks - m_last.callbacks);
+				m_last = s;
+				const bool pressure = (load >= m_policy.highLoad) || (m_policy.xruns && x >= m_policy.xruns);
+				if (pressure)
+				{
+					m_calmSince = -1;
+					if (t - m_lastDegrade < m_policy.degradeHold)
+						return false;
+					m_lastDegrade = t;
+					// cheapest first
+					for (Stage& st : m_stages)
+					{
+						if (st.level + 1 < st.levels)
+						{
+							record(Decision::eDegrade, st.name, st.level, st.level + 1, t, load, x);
+							st.level++;
+							st.apply(st.level);
+							ret = true;
+							break;
+						}
+					}
+					// nothing left to give, or policy says grow now
+					if ((!ret || depth() > (int)m_policy.growAfter) && m_reopen)
+					{
+						unsigned int bigger = step(+1);
+						if (bigger != m_wanted && bigger > m_samples)
+						{
+							record(Decision::eBufferSize, "samples", (int)m_samples, (int)bigger, t, load, x);
+							m_wanted = bigger;
+							ret = true;
+						}
+					}
+					return ret;
+				}
+				if (load > m_policy.lowLoad)
+				{
+					m_calmSince = -1;
+					return false;
+				}
+				if (m_calmSince < 0)
+					m_calmSince = t;
+				const double calm = t - m_calmSince;
+				if (calm >= m_policy.restoreHold && depth())
+				{
+					// most recently degraded first
+					for (auto it = m_stages.rbegin(); it != m_stages.rend(); ++it)
+					{
+						if (it->level)
+						{
+							record(Decision::eRestore, it->name, it->level, it->level - 1, t, load, x);
+							it->level--;
+							it->apply(it->level);
+							break;
+						}
+					}
+					// restart the clock for the next step
+					m_calmSince = t;
+					return true;
+				}
+				if (calm >= m_policy.shrinkHold && !depth() && m_reopen)
+				{
+					unsigned int smaller = step(-1);
+					if (smaller != m_wanted && smaller < m_samples)
+					{
+						record(Decision::eBufferSize, "samples", (int)m_samples, (int)smaller, t, load, x);
+						m_wanted = smaller;
+						m_calmSince = t;
+						return true;
+					}
+				}
+				return false;
+			}
+			// RtAudioDuplex or anything else with metrics() and isRunning()
+			template <typename D>
+			bool update(const D& duplex)
+			{
+				return update(duplex.metrics(), duplex.isRunning());
+			}
+		};
+	}
+}
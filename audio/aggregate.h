@@ -0,0 +1,438 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <audio/audio_u.h>
+#include <audio/mix_matrix.h>
+#include <audio/ring_buffer.h>
+#include <audio/rs4.h>
+#include <audio/rt_metrics.h>
+#include <audio/rtaudio.hpp>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// an input on one device and an output on another. each device runs
+		// its own stream: the input callback only copies into a ring, the
+		// output callback pulls from it through a fractional RS4. a
+		// delay-locked loop on the ring fill level steers the resampling
+		// ratio, so the two clocks may drift apart for ever without the ring
+		// running dry or overflowing. the processor runs on the output
+		// callback with input already at the output clock.
+		class AggregateDuplex
+		{
+		public:
+			//
+			struct Options
+			{
+				// input frames kept queued, 0 picks both buffers plus one
+				// output buffer of margin
+				size_t target = 0;
+				// ring capacity as a multiple of the target
+				size_t periods = 4;
+				// loop bandwidth in Hz. lower is smoother but slower to lock
+				double bandwidth = 0.1;
+				//
+				double damping = 0.707;
+				// largest ratio correction, +/-. crystals are within 100ppm
+				double range = 0.002;
+				// resampler quality
+				size_t quality = 4;
+			};
+			//
+			struct Stats
+			{
+				// input frames consumed per output frame, and the same as
+				// a correction in parts per million
+				double ratio = 1;
+				double ppm = 0;
+				// estimated and wanted fill, input frames
+				double fill = 0;
+				size_t target = 0;
+				// output short of input, input dropped on a full ring
+				uint64_t underruns = 0;
+				uint64_t overflows = 0;
+				// false while prefilling
+				bool locked = false;
+			};
+
+		private:
+			//
+			std::unique_ptr<RtAudio> m_ipDevice;
+			std::unique_ptr<RtAudio> m_opDevice;
+			IDuplexProcessor<float>* m_processor = nullptr;
+			//
+			unsigned int m_ipChannels = 0;
+			unsigned int m_opChannels = 0;
+			unsigned int m_ipRate = 0;
+			unsigned int m_opRate = 0;
+			unsigned int m_ipSamples = 0;
+			unsigned int m_opSamples = 0;
+			Options m_options;
+			size_t m_target = 0;
+			//
+			std::unique_ptr<InterleavedRing<float>> m_ring;
+			RS4 m_rs;
+			// input at the output clock, one output buffer
+			std::vector<float> m_scratch;
+			// used when there is no processor
+			MixMatrix<float> m_route;
+			// published by the input callback. time is stored first
+			std::atomic<uint64_t> m_written{ 0 };
+			std::atomic<double> m_ipTime{ 0 };
+			std::atomic<uint64_t> m_overflows{ 0 };
+			// output callback only
+			uint64_t m_read = 0;
+			bool m_running = false;
+			// loop coefficients and state
+			double m_kp = 0;
+			double m_ki = 0;
+			double m_smooth = 0;
+			double m_z1 = 0;
+			double m_z2 = 0;
+			double m_z3 = 0;
+			// published by the output callback
+			std::atomic<double> m_ratio{ 1 };
+			std::atomic<double> m_fill{ 0 };
+			std::atomic<uint64_t> m_underruns{ 0 };
+			std::atomic<bool> m_locked{ false };
+			CallbackMetrics m_metrics;
+			// a common clock for both callbacks
+			static double now()
+			{
+				return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			}
+			//
+			static int ipCallback(void*, void* inputBuffer, unsigned int samples,
+				double, RtAudioStreamStatus, void* userdata)
+			{
+				AggregateDuplex* instance = reinterpret_cast<AggregateDuplex*>(userdata);
+				instance->capture(SampleView(reinterpret_cast<float*>(inputBuffer), samples, instance->m_ipChannels), now());
+				return 0;
+			}
+			//
+			static int opCallback(void* outputBuffer, void*, unsigned int samples,
+				double streamTime, RtAudioStreamStatus status, void* userdata)
+			{
+				AggregateDuplex* instance = reinterpret_cast<AggregateDuplex*>(userdata);
+				return instance->render(InterleavedView<float>(reinterpret_cast<float*>(outputBuffer), samples, instance->m_opChannels), now(), streamTime, status);
+			}
+			// input frames queued, plus those the input device has captured
+			// since its last callback. removes the sawtooth the input
+			// buffer size would otherwise put on the loop error
+			double estimate(double time)
+			{
+				uint64_t written = m_written.load(std::memory_order_acquire);
+				double ipTime = 0;
+				for (int tries = 0; tries < 4; tries++)
+				{
+					ipTime = m_ipTime.load(std::memory_order_acquire);
+					const uint64_t check = m_written.load(std::memory_order_acquire);
+					if (check == written)
+						break;
+					written = check;
+				}
+				const double since = std::max(0.0, std::min(double(m_ipSamples), (time - ipTime) * m_ipRate));
+				return double(written - m_read) + (written ? since : 0.0);
+			}
+			// input through the resampler into scratch. false if the ring
+			// ran dry first
+			bool pull(const InterleavedView<float>& ip)
+			{
+				size_t done = 0;
+				while (done < ip.frames)
+				{
+					RingRegion<InterleavedView<float>> r = m_ring->read_region(m_ring->readable());
+					if (r.first.frames == 0)
+						break;
+					size_t used = 0;
+					const size_t n = m_rs.process(r.first, ip.slice(done, ip.frames - done), used);
+					m_ring->commit_read(used);
+					m_read += used;
+					done += n;
+					if (n == 0 && used == 0)
+						break;
+				}
+				for (size_t f = done; f < ip.frames; f++)
+					for (size_t c = 0; c < ip.channels; c++)
+						ip.at(f, c) = 0.0f;
+				return (done == ip.frames);
+			}
+			// non-copyable
+			AggregateDuplex(const AggregateDuplex&) = delete;
+			AggregateDuplex& operator=(const AggregateDuplex&) = delete;
+
+		protected:
+			// everything but the devices. also used by device-less backends
+			bool Configure(IDuplexProcessor<float>* processor,
+							unsigned int ipChannels, unsigned int opChannels,
+							unsigned int ipRate, unsigned int opRate,
+							unsigned int ipSamples, unsigned int opSamples,
+							const Options& options)
+			{
+				if (!ipChannels || !opChannels || !ipRate || !opRate || !ipSamples || !opSamples)
+					return false;
+				m_processor = processor;
+				m_ipChannels = ipChannels;
+				m_opChannels = opChannels;
+				m_ipRate = ipRate;
+				m_opRate = opRate;
+				m_ipSamples = ipSamples;
+				m_opSamples = opSamples;
+				m_options = options;
+				// in input frames
+				const size_t opFrames = size_t(std::ceil(double(opSamples) * ipRate / opRate));
+				m_target = (options.target ? options.target : ipSamples + (2 * opFrames));
+				m_ring.reset(new InterleavedRing<float>(std::max<size_t>(options.periods, 2) * m_target, ipChannels));
+				m_rs.clear();
+				if (!m_rs.assign(ipChannels, ipRate, opRate, options.quality) || !m_rs.vary(options.range))
+					return false;
+				m_scratch.assign(size_t(opSamples) * ipChannels, 0.0f);
+				m_route = MixMatrix<float>::standard(ipChannels, opChannels);
+				// second order loop, one update per output buffer. the
+				// error is in output buffers so the plant has unit gain
+				const double w = 2.0 * 3.14159265358979323846 * options.bandwidth * opSamples / opRate;
+				m_kp = 2.0 * options.damping * w;
+				m_ki = w * w;
+				// error smoothing, a decade above the loop
+				m_smooth = 1.0 - std::exp(-10.0 * w);
+				m_z1 = m_z2 = m_z3 = 0;
+				m_written.store(0);
+				m_ipTime.store(0);
+				m_overflows.store(0);
+				m_underruns.store(0);
+				m_read = 0;
+				m_running = false;
+				m_ratio.store(1);
+				m_fill.store(0);
+				m_locked.store(false);
+				return true;
+			}
+
+		public:
+			//
+			AggregateDuplex() {}
+			//
+			virtual ~AggregateDuplex() { Close(); }
+			// open the input and output devices as two streams at the same
+			// nominal rate. a device that picks another rate is resampled
+			bool Open(RtAudioEnumerator::DeviceId ipId,
+					RtAudioEnumerator::DeviceId opId,
+					IDuplexProcessor<float>* processor,
+					int ipChannels,
+					int opChannels,
+					int sampleRate,
+					unsigned int samples,
+					const Options& options)
+			{
+				if (m_ipDevice || m_opDevice)
+					return false;
+				m_ipChannels = ipChannels;
+				m_opChannels = opChannels;
+				std::unique_ptr<RtAudio> ipDevice(new RtAudio());
+				std::unique_ptr<RtAudio> opDevice(new RtAudio());
+				RtAudio::StreamParameters ipParams;
+				ipParams.deviceId = ipId;
+				ipParams.nChannels = ipChannels;
+				ipParams.firstChannel = 0;
+				RtAudio::StreamParameters opParams;
+				opParams.deviceId = opId;
+				opParams.nChannels = opChannels;
+				opParams.firstChannel = 0;
+				void* userdata = reinterpret_cast<void*>(this);
+				unsigned int ipSamples = samples;
+				unsigned int opSamples = samples;
+				if (ipDevice->openStream(nullptr, &ipParams, RTAUDIO_FLOAT32, sampleRate, &ipSamples, &ipCallback, userdata))
+					return false;
+				if (opDevice->openStream(&opParams, nullptr, RTAUDIO_FLOAT32, sampleRate, &opSamples, &opCallback, userdata))
+					return false;
+				if (!ipDevice->isStreamOpen() || !opDevice->isStreamOpen())
+					return false;
+				if (!Configure(processor, ipChannels, opChannels,
+								ipDevice->getStreamSampleRate(), opDevice->getStreamSampleRate(),
+								ipSamples, opSamples, options))
+					return false;
+				m_ipDevice = std::move(ipDevice);
+				m_opDevice = std::move(opDevice);
+				return true;
+			}
+			//
+			bool Open(RtAudioEnumerator::DeviceId ipId,
+					RtAudioEnumerator::DeviceId opId,
+					IDuplexProcessor<float>* processor = nullptr,
+					int ipChannels = 2,
+					int opChannels = 2,
+					int sampleRate = 44100,
+					unsigned int samples = 512)
+			{
+				return Open(ipId, opId, processor, ipChannels, opChannels, sampleRate, samples, Options());
+			}
+			// output first, so it is waiting when input starts arriving
+			bool Start()
+			{
+				if (!m_ipDevice || !m_opDevice)
+					return false;
+				if (m_opDevice->startStream())
+					return false;
+				if (m_ipDevice->startStream())
+				{
+					m_opDevice->stopStream();
+					return false;
+				}
+				return true;
+			}
+			//
+			bool Stop()
+			{
+				if (m_ipDevice && m_ipDevice->isStreamRunning())
+					m_ipDevice->stopStream();
+				if (m_opDevice && m_opDevice->isStreamRunning())
+					m_opDevice->stopStream();
+				return true;
+			}
+			//
+			bool Close()
+			{
+				Stop();
+				m_ipDevice = nullptr;
+				m_opDevice = nullptr;
+				return true;
+			}
+
+			// input callback. 'time' in seconds on the clock given to render()
+			void capture(const SampleView& ip, double time)
+			{
+				const size_t n = m_ring->write(ip);
+				if (n < ip.frames)
+					m_overflows.fetch_add(1, std::memory_order_relaxed);
+				m_ipTime.store(time, std::memory_order_release);
+				m_written.store(m_written.load(std::memory_order_relaxed) + n, std::memory_order_release);
+			}
+
+			// output callback
+			int render(const InterleavedView<float>& op, double time, double streamTime, RtAudioStreamStatus status)
+			{
+				CallbackMetrics::clock_t::time_point start = m_metrics.begin();
+				const size_t frames = std::min(op.frames, size_t(m_opSamples));
+				InterleavedView<float> ip(m_scratch.data(), frames, m_ipChannels);
+				double fill = estimate(time);
+				if (!m_running && fill >= double(m_target))
+				{
+					// start centred on the target, late input is dropped
+					const size_t queued = m_ring->readable();
+					const size_t excess = size_t(fill) - m_target;
+					const size_t drop = std::min(queued, excess);
+					m_ring->commit_read(drop);
+					m_read += drop;
+					fill -= double(drop);
+					m_z1 = m_z2 = 0;
+					m_running = true;
+				}
+				int ret = 0;
+				if (m_running)
+				{
+					// error in output buffers, smoothed twice then PI
+					const double e = (fill - double(m_target)) / (double(frames) * m_ipRate / m_opRate);
+					m_z1 += m_smooth * (e - m_z1);
+					m_z2 += m_smooth * (m_z1 - m_z2);
+					m_z3 += m_ki * m_z2;
+					m_z3 = std::max(-m_options.range, std::min(m_options.range, m_z3));
+					m_rs.adjust(1.0 + (m_kp * m_z2) + m_z3);
+					if (!pull(ip))
+					{
+						// prefill again, the drift estimate is kept
+						m_underruns.fetch_add(1, std::memory_order_relaxed);
+						m_running = false;
+					}
+					if (m_processor)
+					{
+						ret = m_processor->process(SampleView(ip), op.slice(0, frames), m_opRate, streamTime, status);
+					}
+					else
+					{
+						for (size_t f = 0; f < frames; f++)
+							for (size_t c = 0; c < op.channels; c++)
+								op.at(f, c) = 0.0f;
+						m_route.apply(ip, op.slice(0, frames));
+					}
+					// a host buffer beyond the resampled block is silent
+					const InterleavedView<float> tail = op.slice(frames, op.frames - frames);
+					for (size_t f = 0; f < tail.frames; f++)
+						for (size_t c = 0; c < tail.channels; c++)
+							tail.at(f, c) = 0.0f;
+				}
+				else
+				{
+					for (size_t f = 0; f < op.frames; f++)
+						for (size_t c = 0; c < op.channels; c++)
+							op.at(f, c) = 0.0f;
+				}
+				m_ratio.store(m_rs.ratio(), std::memory_order_relaxed);
+				m_fill.store(fill, std::memory_order_relaxed);
+				m_locked.store(m_running, std::memory_order_relaxed);
+				m_metrics.end(start, (unsigned int)frames, m_opRate, streamTime,
+					false, (status & RTAUDIO_OUTPUT_UNDERFLOW) != 0);
+				return ret;
+			}
+
+			// any thread
+			Stats stats() const
+			{
+				Stats ret;
+				ret.ratio = m_ratio.load(std::memory_order_relaxed);
+				ret.ppm = (ret.ratio - 1.0) * 1e6;
+				ret.fill = m_fill.load(std::memory_order_relaxed);
+				ret.target = m_target;
+				ret.underruns = m_underruns.load(std::memory_order_relaxed);
+				ret.overflows = m_overflows.load(std::memory_order_relaxed);
+				ret.locked = m_locked.load(std::memory_order_relaxed);
+				return ret;
+			}
+			// output callback timing
+			CallbackMetrics::Snapshot metrics() const
+			{
+				return m_metrics.snapshot();
+			}
+			//
+			unsigned int ipChannels() const { return m_ipChannels; }
+			unsigned int opChannels() const { return m_opChannels; }
+			unsigned int sampleRate() const { return m_opRate; }
+		};
+	}
+}
@@ -1,336 +1,741 @@
-/*
-
-
-
-
-
-*/
-
-#pragma once
-
-#include <cstdio>
-#include <cstdint>
-#include <string>
-#include <vector>
-
-namespace nv2
-{
-	//-----------------------------------------------------------------------------
-	namespace wav
-	{
-		//-----------------------------------------------------------------------------
-		// static const int WAVE_FORMAT_PCM = 1;
-		// documented in DDK MSVAD sample
-		// wave file header.
-		static const uint32_t RIFF_TAG = 0x46464952;
-		static const uint32_t WAVE_TAG = 0x45564157;
-		static const uint32_t FMT__TAG = 0x20746D66;
-		static const uint32_t DATA_TAG = 0x61746164;
-			
-		//-----------------------------------------------------------------------------
-		#define WAVE_FORMAT_PCM 1
-
-		//-----------------------------------------------------------------------------
-#pragma pack(push,1)
-
-		//-----------------------------------------------------------------------------
-		// documented in DDK MSVAD sample
-		// wave file header.
-		typedef struct _WAVE_RIFF_HEADER
-		{
-			uint32_t dwRiff;			// 'RIFF'
-			uint32_t dwFileSize;		// total file size excluding initial 8 bytes
-			uint32_t dwWave;			// 'WAVE'
-			uint32_t dwFormat;			// 'fmt ' 
-			uint32_t dwFormatLength;	// size of format 
-											// to follow. i.e.
-											// WAVE_FORMAT_HEADER (0x10)
-		} WAVE_RIFF_HEADER;
-
-		// there is also an extensible header which is larger
-		// and contains some flags for multi-channel (5.1/7.1)
-		// speaker assignments. So check dwFormatLength above
-		// to make sure it matches sizeof(WAVE_FORMAT_HEADER)
-		// https://learn.microsoft.com/en-gb/windows/win32/api/mmreg/ns-mmreg-waveformatextensible
-		typedef struct WAVEFORMATHEADER_TAG
-		{
-			uint16_t wFormat;		// WAVE_FORMAT_PCM
-			uint16_t nChannels;	// 1 for mono, 2 for stereo
-			uint32_t dwSampleRate;	// 22050,32000,44100,48000
-			uint32_t dwBytesPerSec;	// 88200 for 22K05
-			uint16_t wBlockAlign;	// always 4 ?
-			uint16_t wBitsPerSample;	// 16
-		} WAVE_FORMAT_HEADER;
-
-		typedef struct _WAVE_DATA_HEADER
-		{
-			uint32_t dwData;		// 'data' | DATA_TAG
-			uint32_t dwDataLength;	// number of bytes in PCM stream
-		} WAVE_DATA_HEADER;
-
-#pragma pack(pop)
-	}
-		
-	namespace u
-	{
-		//-----------------------------------------------------------------------------
-		inline void throw_if(bool failed, const std::string& msg)
-		{
-			if (failed)
-				throw std::runtime_error(msg.c_str());
-		}
-
-		//-----------------------------------------------------------------------------
-		// ensure FILE* is closed.
-		class FILECloser {
-			FILE* _fp = nullptr;
-		public: 
-			FILECloser(FILE* fp) : _fp(fp) {}
-			~FILECloser() {
-				if (_fp) {
-					fclose(_fp);
-					_fp = nullptr;
-				}
-			}
-		};
-
-		//-----------------------------------------------------------------------------
-		static constexpr float ratio = (1.0f / 32767.0f);
-		//-----------------------------------------------------------------------------
-		// short to float
-		inline float convert(const short& arg)
-		{
-			float s = float(arg) * ratio;
-			return s;
-		}
-		//-----------------------------------------------------------------------------
-		// float to short
-		inline short convert(const float& arg)
-		{
-			return static_cast<short>(arg * 32767.0f);
-		}
-	}
-
-	namespace audio
-	{
-		//-----------------------------------------------------------------------------
-		// interleaved sample data.
-		struct SampleData
-		{
-			// is this necessary?
-			uint32_t blockSize = 0;
-			uint32_t samples = 0;
-			uint32_t channels = 0;
-			uint32_t sampleRate = 0;
-			// thus samples * channels in size
-			std::vector<float> buffer;
-			//
-			const float* begin() const
-			{
-				return buffer.data();
-			}
-			//
-			const float* end() const
-			{
-				return begin() + samples;
-			}
-		};
-
-		//-----------------------------------------------------------------------------
-		struct SampleIterator
-		{
-		private:
-			const float* m_ps = nullptr;
-			const float* m_pc = nullptr;
-			const float* m_pe = nullptr;
-			//
-			uint32_t blockSize = 0;
-			// a single contiguous data block
-			// blockSize * channels
-			std::shared_ptr<float> ptr;
-			// vetor used to manage pointers into 
-			// de-interleaving block
-			std::vector<float*> buffer;
-		public:
-			//
-			SampleIterator(const SampleData& arg)
-			{
-				blockSize = arg.blockSize;
-				m_ps = arg.begin();
-				m_pe = arg.end();
-				m_pc = m_ps;
-				ptr = std::shared_ptr<float>(new float[blockSize * arg.channels]);
-				float* p = ptr.get();
-				for (size_t s = 0; s < arg.channels; s++)
-				{
-					buffer.push_back(p);
-					p += blockSize;
-				}
-				// copy the first block
-				// copy();
-			}
-			//
-			~SampleIterator() {}
-			//
-			void copy()
-			{
-				// can be optimized for common configurations!
-				for (size_t sample = 0;
-					sample < size() && more();
-					sample++)
-				{
-					for (size_t channel = 0; channel < buffer.size(); channel++)
-					{
-						buffer[channel][sample] = *m_pc++;
-					}
-				}
-			}
-			//
-			bool more() const
-			{
-				return (m_pc < m_pe);
-			}
-			//
-			const float* const* data() const { return &buffer[0]; }
-			//
-			size_t size() const { return blockSize; }
-		};
-
-		//-----------------------------------------------------------------------------
-		// de-interleaved sample block
-		// C0 S0S1...Sn
-		// C1 S0S1...Sn
-		struct SampleBlock
-		{
-		private:
-			//
-			uint32_t m_available = 0;
-			//
-			uint32_t m_blockSize = 0;
-			// a single contiguous data block
-			// blockSize * channels
-			std::shared_ptr<float> m_ptr;
-			// vector used to manage pointers into 
-			// de-interleaving block
-			// N channels in size, 1 pointer per channel
-			std::vector<float*> m_buffer;
-		public:
-			//
-			SampleBlock(int blockSize, int channels)
-			{
-				m_blockSize = blockSize;
-				m_ptr = std::shared_ptr<float>(new float[blockSize * channels]);
-				float* p = m_ptr.get();
-				for (int s = 0; s < channels; s++)
-				{
-					m_buffer.push_back(p);
-					p += m_blockSize;
-				}
-			}
-			//
-			~SampleBlock() {}
-			//
-			float* const* data() { return &m_buffer[0]; }
-			//
-			const float* const* data() const { return &m_buffer[0]; }
-			// get a channel buffer pointer
-			const float* begin_data(size_t channel) const { return m_buffer[channel]; }
-			const float* end_data(size_t channel) const { return (begin_data(channel) + blocksize()); }
-			//
-			size_t blocksize() const { return m_blockSize; }
-			// 
-			size_t available() const { return m_available; }
-			//
-			size_t channels() const { return m_buffer.size(); }
-		};
-
-		//-----------------------------------------------------------------------------
-		static
-			inline
-			nv2::audio::SampleData
-			interleave(const nv2::audio::SampleBlock& sb,
-				nv2::audio::SampleData& opData,
-				size_t samples
-			)
-		{
-			// re-interleave
-			const float* const* p = sb.data();
-			if (sb.channels() == 2)
-			{
-				const float* psl = sb.begin_data(0);
-				const float* pel = psl + samples;
-				const float* psr = sb.begin_data(1);
-				const float* per = psr + samples;
-				while (psl < pel && psr < per)
-				{
-					opData.buffer.push_back(*psl++);
-					opData.samples++;
-					opData.buffer.push_back(*psr++);
-					opData.samples++;
-				}
-			}
-			else
-			{
-				for (size_t s = 0; s < sb.available(); s++)
-				{
-					for (size_t c = 0; c < sb.channels(); c++)
-					{
-						opData.buffer.push_back(p[c][s]);
-						opData.samples++;
-					}
-				}
-			}
-			return opData;
-		}
-
-		//-----------------------------------------------------------------------------
-		static
-			inline
-			nv2::audio::SampleData make(const nv2::audio::SampleData& arg)
-		{
-			nv2::audio::SampleData ret;
-			ret.channels = arg.channels;
-			ret.sampleRate = arg.sampleRate;
-			ret.blockSize = arg.blockSize;
-			ret.buffer.reserve(ret.blockSize);
-			return ret;
-		}
-
-		//-----------------------------------------------------------------------------
-		// returns a vector of normalized thumbnail values (+/-1.0f)
-		// this is a positive peak peaker
-		static
-		std::vector<float> 
-			thumbNail(const SampleData& sd, size_t widthPixels = 100)
-		{
-			//size_t samples = sd.samples / sd.channels;
-			size_t samples = sd.samples;
-			size_t blockSize = samples / widthPixels;
-			const float* ps = &sd.buffer[0];
-			const float* po = ps;
-			const float* pi = po;
-			const float* pe = ps + (blockSize * widthPixels);
-			float peak = 0.0f;
-			std::vector<float> peaks;
-			for (/*po*/; po < pe; po += blockSize)
-			{
-				float fv = 0.0f;
-				const float* pb = std::min(po + blockSize, pe);
-				for (pi = po; pi < pb; pi += sd.channels)
-				{
-					// max only					
-					fv = std::max(fv, std::abs(*pi));
-				}
-				// track peak value for normalising
-				peak = std::max(peak, fv);
-				peaks.push_back(fv);
-			}
-			// normalize all data to +/-1.0f
-			float mul = powf(peak, -1);
-			for (size_t s = 0; s < peaks.size(); s++)
-				peaks[s] *= mul;
-			//
-			return peaks;
-		}
-	}
-}
+/*
+
+
+
+
+
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+// SSE paths on x86. define _RT_X86 as 0 to build the scalar ones
+#if !defined(_RT_X86) && (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+#define _RT_X86 1
+#endif
+#if _RT_X86
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+namespace nv2
+{
+	//-----------------------------------------------------------------------------
+	namespace wav
+	{
+		//-----------------------------------------------------------------------------
+		// static const int WAVE_FORMAT_PCM = 1;
+		// documented in DDK MSVAD sample
+		// wave file header.
+		static const uint32_t RIFF_TAG = 0x46464952;
+		static const uint32_t WAVE_TAG = 0x45564157;
+		static const uint32_t FMT__TAG = 0x20746D66;
+		static const uint32_t DATA_TAG = 0x61746164;
+			
+		//-----------------------------------------------------------------------------
+		#define WAVE_FORMAT_PCM 1
+
+		//-----------------------------------------------------------------------------
+#pragma pack(push,1)
+
+		//-----------------------------------------------------------------------------
+		// documented in DDK MSVAD sample
+		// wave file header.
+		typedef struct _WAVE_RIFF_HEADER
+		{
+			uint32_t dwRiff;			// 'RIFF'
+			uint32_t dwFileSize;		// total file size excluding initial 8 bytes
+			uint32_t dwWave;			// 'WAVE'
+			uint32_t dwFormat;			// 'fmt ' 
+			uint32_t dwFormatLength;	// size of format 
+											// to follow. i.e.
+											// WAVE_FORMAT_HEADER (0x10)
+		} WAVE_RIFF_HEADER;
+
+		// there is also an extensible header which is larger
+		// and contains some flags for multi-channel (5.1/7.1)
+		// speaker assignments. So check dwFormatLength above
+		// to make sure it matches sizeof(WAVE_FORMAT_HEADER)
+		// https://learn.microsoft.com/en-gb/windows/win32/api/mmreg/ns-mmreg-waveformatextensible
+		typedef struct WAVEFORMATHEADER_TAG
+		{
+			uint16_t wFormat;		// WAVE_FORMAT_PCM
+			uint16_t nChannels;	// 1 for mono, 2 for stereo
+			uint32_t dwSampleRate;	// 22050,32000,44100,48000
+			uint32_t dwBytesPerSec;	// 88200 for 22K05
+			uint16_t wBlockAlign;	// always 4 ?
+			uint16_t wBitsPerSample;	// 16
+		} WAVE_FORMAT_HEADER;
+
+		typedef struct _WAVE_DATA_HEADER
+		{
+			uint32_t dwData;		// 'data' | DATA_TAG
+			uint32_t dwDataLength;	// number of bytes in PCM stream
+		} WAVE_DATA_HEADER;
+
+#pragma pack(pop)
+	}
+		
+	namespace u
+	{
+		//-----------------------------------------------------------------------------
+		inline void throw_if(bool failed, const std::string& msg)
+		{
+			if (failed)
+				throw std::runtime_error(msg.c_str());
+		}
+
+		//-----------------------------------------------------------------------------
+		// ensure FILE* is closed.
+		class FILECloser {
+			FILE* _fp = nullptr;
+		public: 
+			FILECloser(FILE* fp) : _fp(fp) {}
+			~FILECloser() {
+				if (_fp) {
+					fclose(_fp);
+					_fp = nullptr;
+				}
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		static constexpr float ratio = (1.0f / 32767.0f);
+		//-----------------------------------------------------------------------------
+		// short to float
+		inline float convert(const short& arg)
+		{
+			float s = float(arg) * ratio;
+			return s;
+		}
+		//-----------------------------------------------------------------------------
+		// float to short
+		inline short convert(const float& arg)
+		{
+			return static_cast<short>(arg * 32767.0f);
+		}
+		//-----------------------------------------------------------------------------
+		// bulk short to float. simple enough for the compiler to vectorize
+		inline void convert(const short* ps, float* pd, size_t count)
+		{
+			for (size_t s = 0; s < count; s++)
+			{
+				pd[s] = float(ps[s]) * ratio;
+			}
+		}
+	}
+
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// smallest power of 2 >= arg
+		inline size_t pow2(size_t arg)
+		{
+			size_t ret = 1;
+			while (ret < arg)
+				ret <<= 1;
+			return ret;
+		}
+		// true if n is a power of 2
+		inline bool isPow2(size_t n)
+		{
+			return n && !(n & (n - 1));
+		}
+
+		//-----------------------------------------------------------------------------
+		// a pool of threads, the calling thread among them, pulling task
+		// indices from a shared counter until there are none left. 0
+		// threads uses every hardware thread, never more than there are
+		// tasks
+		class TaskPool
+		{
+			std::atomic<size_t> m_next{ 0 };
+			size_t m_tasks = 0;
+			size_t m_threads = 1;
+
+		public:
+			//
+			TaskPool(size_t tasks, size_t threads = 0) : m_tasks(tasks)
+			{
+				threads = (threads ? threads : std::max(1u, std::thread::hardware_concurrency()));
+				m_threads = std::max<size_t>(1, std::min(threads, tasks));
+			}
+			//
+			size_t threads() const { return m_threads; }
+			// the next task for a worker, false when they are all taken
+			bool take(size_t& task)
+			{
+				task = m_next.fetch_add(1);
+				return task < m_tasks;
+			}
+			// run worker() on every thread and wait for them all
+			template <typename F>
+			void run(const F& worker)
+			{
+				std::vector<std::thread> pool;
+				for (size_t t = 1; t < m_threads; t++)
+					pool.emplace_back(std::cref(worker));
+				worker();
+				for (auto& t : pool)
+					t.join();
+			}
+			// non-copyable
+			TaskPool(const TaskPool&) = delete;
+			TaskPool& operator=(const TaskPool&) = delete;
+		};
+
+		//-----------------------------------------------------------------------------
+		// non-owning view of interleaved data. stride is the distance in
+		// values between the start of consecutive frames, usually channels.
+		// use T = const float for read-only views
+		template <typename T>
+		struct InterleavedView
+		{
+			T* ptr = nullptr;
+			size_t frames = 0;
+			size_t channels = 0;
+			size_t stride = 0;
+			//
+			InterleavedView() {}
+			//
+			InterleavedView(T* p, size_t f, size_t c, size_t s = 0) :
+				ptr(p), frames(f), channels(c), stride(s ? s : c)
+			{
+			}
+			// allow float => const float
+			template <typename U>
+			InterleavedView(const InterleavedView<U>& arg) :
+				ptr(arg.ptr), frames(arg.frames), channels(arg.channels), stride(arg.stride)
+			{
+			}
+			//
+			T* frame(size_t f) const { return ptr + (f * stride); }
+			//
+			T& at(size_t f, size_t c) const { return ptr[(f * stride) + c]; }
+			// samples are contiguous with no gaps between frames
+			bool packed() const { return (stride == channels); }
+			//
+			bool empty() const { return (ptr == nullptr || frames == 0); }
+			// sub-range of frames
+			InterleavedView slice(size_t first, size_t count) const
+			{
+				first = std::min(first, frames);
+				count = std::min(count, frames - first);
+				return InterleavedView(frame(first), count, channels, stride);
+			}
+			// a single channel as a 1 channel view over the same memory
+			InterleavedView channel(size_t c) const
+			{
+				return InterleavedView(ptr + c, frames, 1, stride);
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		// non-owning view of de-interleaved data. one pointer per channel,
+		// offset frames into each. slicing only moves the offset.
+		template <typename T>
+		struct PlanarView
+		{
+			T* const* ptrs = nullptr;
+			size_t frames = 0;
+			size_t channels = 0;
+			size_t offset = 0;
+			//
+			PlanarView() {}
+			//
+			PlanarView(T* const* p, size_t f, size_t c, size_t o = 0) :
+				ptrs(p), frames(f), channels(c), offset(o)
+			{
+			}
+			// allow float => const float
+			template <typename U>
+			PlanarView(const PlanarView<U>& arg) :
+				ptrs(arg.ptrs), frames(arg.frames), channels(arg.channels), offset(arg.offset)
+			{
+			}
+			//
+			T* channel(size_t c) const { return ptrs[c] + offset; }
+			//
+			T& at(size_t f, size_t c) const { return ptrs[c][offset + f]; }
+			//
+			bool empty() const { return (ptrs == nullptr || frames == 0); }
+			// sub-range of frames
+			PlanarView slice(size_t first, size_t count) const
+			{
+				first = std::min(first, frames);
+				count = std::min(count, frames - first);
+				return PlanarView(ptrs, count, channels, offset + first);
+			}
+		};
+
+		//
+		using SampleView = InterleavedView<const float>;
+		using PlanarSampleView = PlanarView<const float>;
+
+		//-----------------------------------------------------------------------------
+		// interleaved sample data.
+		struct SampleData
+		{
+			// is this necessary?
+			uint32_t blockSize = 0;
+			uint32_t samples = 0;
+			uint32_t channels = 0;
+			uint32_t sampleRate = 0;
+			// thus samples * channels in size
+			std::vector<float> buffer;
+			// compact storage. native 16 bit PCM exactly as read from disk.
+			// when populated buffer is empty and floats are produced a
+			// block at a time by SampleIterator or BlockCache
+			std::vector<short> pcm;
+			//
+			const float* begin() const
+			{
+				return buffer.data();
+			}
+			//
+			const float* end() const
+			{
+				// no arithmetic on the null pointer of compact data
+				return (buffer.empty() ? begin() : begin() + samples);
+			}
+			//
+			const short* begin_pcm() const
+			{
+				return pcm.data();
+			}
+			//
+			const short* end_pcm() const
+			{
+				return (pcm.empty() ? begin_pcm() : begin_pcm() + samples);
+			}
+			// holding native integer data?
+			bool compact() const
+			{
+				return (buffer.empty() && !pcm.empty());
+			}
+			// resident size of the sample storage in bytes
+			size_t bytes() const
+			{
+				return (buffer.size() * sizeof(float)) + (pcm.size() * sizeof(short));
+			}
+			// convert compact data to float in place and release the PCM
+			void expand()
+			{
+				if (!compact())
+					return;
+				buffer.assign(pcm.size(), 0.0f);
+				u::convert(pcm.data(), buffer.data(), pcm.size());
+				std::vector<short>().swap(pcm);
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		// small LRU cache of interleaved float blocks. for compact SampleData
+		// blocks are converted on first use, otherwise they point straight
+		// into the float buffer. blocks are blockSize frames in length.
+		class BlockCache
+		{
+			struct Slot
+			{
+				size_t block = SIZE_MAX;
+				uint64_t used = 0;
+				std::vector<float> data;
+			};
+			//
+			const SampleData& m_sd;
+			//
+			std::vector<Slot> m_slots;
+			//
+			uint64_t m_tick = 0;
+			//
+			size_t m_misses = 0;
+			// non-copyable
+			BlockCache(const BlockCache&) = delete;
+			BlockCache& operator=(const BlockCache&) = delete;
+		public:
+			//
+			BlockCache(const SampleData& sd, size_t slots = 4) :
+				m_sd(sd),
+				m_slots(std::max<size_t>(slots, 1))
+			{
+			}
+			// interleaved values in a full block
+			size_t stride() const
+			{
+				return size_t(m_sd.blockSize) * m_sd.channels;
+			}
+			//
+			size_t blocks() const
+			{
+				size_t s = stride();
+				return (s ? (m_sd.samples + s - 1) / s : 0);
+			}
+			// how many conversions have been done
+			size_t misses() const { return m_misses; }
+			// get block 'index'. count receives the number of interleaved
+			// values in the block. pointer valid until the next call
+			const float* block(size_t index, size_t* count = nullptr)
+			{
+				const size_t s = stride();
+				const size_t offset = index * s;
+				if (offset >= m_sd.samples)
+				{
+					if (count)
+						*count = 0;
+					return nullptr;
+				}
+				const size_t n = std::min(s, m_sd.samples - offset);
+				if (count)
+					*count = n;
+				if (!m_sd.compact())
+					return m_sd.begin() + offset;
+				// already converted?
+				Slot* victim = &m_slots[0];
+				for (Slot& slot : m_slots)
+				{
+					if (slot.block == index)
+					{
+						slot.used = ++m_tick;
+						return slot.data.data();
+					}
+					if (slot.used < victim->used)
+						victim = &slot;
+				}
+				// convert into the least recently used slot
+				victim->data.resize(s);
+				u::convert(m_sd.begin_pcm() + offset, victim->data.data(), n);
+				victim->block = index;
+				victim->used = ++m_tick;
+				m_misses++;
+				return victim->data.data();
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		struct SampleIterator
+		{
+		private:
+			const float* m_ps = nullptr;
+			const float* m_pc = nullptr;
+			const float* m_pe = nullptr;
+			// compact source, converted as it is de-interleaved
+			const short* m_pss = nullptr;
+			const short* m_pcs = nullptr;
+			const short* m_pes = nullptr;
+			//
+			uint32_t blockSize = 0;
+			// a single contiguous data block
+			// blockSize * channels
+			std::shared_ptr<float> ptr;
+			// vetor used to manage pointers into 
+			// de-interleaving block
+			std::vector<float*> buffer;
+		public:
+			//
+			SampleIterator(const SampleData& arg)
+			{
+				blockSize = arg.blockSize;
+				m_ps = arg.begin();
+				m_pe = arg.end();
+				m_pc = m_ps;
+				if (arg.compact())
+				{
+					m_pss = arg.begin_pcm();
+					m_pes = arg.end_pcm();
+					m_pcs = m_pss;
+				}
+				ptr = std::shared_ptr<float>(new float[blockSize * arg.channels]);
+				float* p = ptr.get();
+				for (size_t s = 0; s < arg.channels; s++)
+				{
+					buffer.push_back(p);
+					p += blockSize;
+				}
+				// copy the first block
+				// copy();
+			}
+			//
+			~SampleIterator() {}
+			//
+			void copy()
+			{
+				if (m_pss)
+				{
+					for (size_t sample = 0;
+						sample < size() && more();
+						sample++)
+					{
+						for (size_t channel = 0; channel < buffer.size(); channel++)
+						{
+							buffer[channel][sample] = u::convert(*m_pcs++);
+						}
+					}
+					return;
+				}
+				// can be optimized for common configurations!
+				for (size_t sample = 0;
+					sample < size() && more();
+					sample++)
+				{
+					for (size_t channel = 0; channel < buffer.size(); channel++)
+					{
+						buffer[channel][sample] = *m_pc++;
+					}
+				}
+			}
+			//
+			bool more() const
+			{
+				if (m_pss)
+					return (m_pcs < m_pes);
+				return (m_pc < m_pe);
+			}
+			//
+			const float* const* data() const { return &buffer[0]; }
+			//
+			size_t size() const { return blockSize; }
+			//
+			size_t channels() const { return buffer.size(); }
+		};
+
+		//-----------------------------------------------------------------------------
+		// de-interleaved sample block
+		// C0 S0S1...Sn
+		// C1 S0S1...Sn
+		struct SampleBlock
+		{
+		private:
+			//
+			uint32_t m_available = 0;
+			//
+			uint32_t m_blockSize = 0;
+			// a single contiguous data block
+			// blockSize * channels
+			std::shared_ptr<float> m_ptr;
+			// vector used to manage pointers into 
+			// de-interleaving block
+			// N channels in size, 1 pointer per channel
+			std::vector<float*> m_buffer;
+		public:
+			//
+			SampleBlock(int blockSize, int channels)
+			{
+				m_blockSize = blockSize;
+				m_ptr = std::shared_ptr<float>(new float[blockSize * channels]);
+				float* p = m_ptr.get();
+				for (int s = 0; s < channels; s++)
+				{
+					m_buffer.push_back(p);
+					p += m_blockSize;
+				}
+			}
+			//
+			~SampleBlock() {}
+			//
+			float* const* data() { return &m_buffer[0]; }
+			//
+			const float* const* data() const { return &m_buffer[0]; }
+			// get a channel buffer pointer
+			const float* begin_data(size_t channel) const { return m_buffer[channel]; }
+			const float* end_data(size_t channel) const { return (begin_data(channel) + blocksize()); }
+			//
+			size_t blocksize() const { return m_blockSize; }
+			// 
+			size_t available() const { return m_available; }
+			//
+			size_t channels() const { return m_buffer.size(); }
+		};
+
+		//-----------------------------------------------------------------------------
+		// views over the owning types. SampleData views are float only,
+		// compact data gives an empty view so check compact() first
+		inline SampleView view(const SampleData& sd)
+		{
+			size_t channels = std::max<size_t>(sd.channels, 1);
+			return SampleView(sd.begin(), sd.buffer.size() / channels, channels);
+		}
+		//
+		inline PlanarView<float> view(SampleBlock& sb)
+		{
+			return PlanarView<float>(sb.data(), sb.blocksize(), sb.channels());
+		}
+		//
+		inline PlanarSampleView view(const SampleBlock& sb)
+		{
+			return PlanarSampleView(sb.data(), sb.blocksize(), sb.channels());
+		}
+		//
+		inline PlanarSampleView view(const SampleIterator& si)
+		{
+			return PlanarSampleView(si.data(), si.size(), si.channels());
+		}
+
+		//-----------------------------------------------------------------------------
+		// de-interleave. frames and channels are the smaller of the two views
+		template <typename T>
+		inline void deinterleave(const InterleavedView<const T>& ip, const PlanarView<T>& op)
+		{
+			const size_t frames = std::min(ip.frames, op.frames);
+			const size_t channels = std::min(ip.channels, op.channels);
+			for (size_t c = 0; c < channels; c++)
+			{
+				const T* ps = ip.ptr + c;
+				T* pd = op.channel(c);
+				for (size_t f = 0; f < frames; f++, ps += ip.stride)
+					pd[f] = *ps;
+			}
+		}
+
+		//-----------------------------------------------------------------------------
+		// re-interleave into existing memory. no allocation
+		template <typename T>
+		inline void interleave(const PlanarView<const T>& ip, const InterleavedView<T>& op)
+		{
+			const size_t frames = std::min(ip.frames, op.frames);
+			const size_t channels = std::min(ip.channels, op.channels);
+			for (size_t c = 0; c < channels; c++)
+			{
+				const T* ps = ip.channel(c);
+				T* pd = op.ptr + c;
+				for (size_t f = 0; f < frames; f++, pd += op.stride)
+					*pd = ps[f];
+			}
+		}
+
+		//-----------------------------------------------------------------------------
+		static
+			inline
+			nv2::audio::SampleData
+			interleave(const nv2::audio::SampleBlock& sb,
+				nv2::audio::SampleData& opData,
+				size_t samples
+			)
+		{
+			// appending floats to compact data would strand the PCM
+			opData.expand();
+			// re-interleave
+			const float* const* p = sb.data();
+			if (sb.channels() == 2)
+			{
+				const float* psl = sb.begin_data(0);
+				const float* pel = psl + samples;
+				const float* psr = sb.begin_data(1);
+				const float* per = psr + samples;
+				while (psl < pel && psr < per)
+				{
+					opData.buffer.push_back(*psl++);
+					opData.samples++;
+					opData.buffer.push_back(*psr++);
+					opData.samples++;
+				}
+			}
+			else
+			{
+				for (size_t s = 0; s < sb.available(); s++)
+				{
+					for (size_t c = 0; c < sb.channels(); c++)
+					{
+						opData.buffer.push_back(p[c][s]);
+						opData.samples++;
+					}
+				}
+			}
+			return opData;
+		}
+
+		//-----------------------------------------------------------------------------
+		static
+			inline
+			nv2::audio::SampleData make(const nv2::audio::SampleData& arg)
+		{
+			nv2::audio::SampleData ret;
+			ret.channels = arg.channels;
+			ret.sampleRate = arg.sampleRate;
+			ret.blockSize = arg.blockSize;
+			ret.buffer.reserve(ret.blockSize);
+			return ret;
+		}
+
+		//-----------------------------------------------------------------------------
+		// peak across all channels per pixel. float or compact sample storage
+		template <typename S>
+		static
+		std::vector<float>
+			peaks(const InterleavedView<const S>& sv, size_t widthPixels)
+		{
+			size_t blockSize = sv.frames / widthPixels;
+			std::vector<float> peaks;
+			if (blockSize == 0)
+				return peaks;
+			for (size_t px = 0; px < widthPixels; px++)
+			{
+				float fv = 0.0f;
+				const S* pi = sv.frame(px * blockSize);
+				const S* pb = pi + (blockSize * sv.stride);
+				for (/*pi*/; pi < pb; pi += sv.stride)
+				{
+					// max only					
+					for (size_t c = 0; c < sv.channels; c++)
+						fv = std::max(fv, float(std::abs(pi[c])));
+				}
+				peaks.push_back(fv);
+			}
+			return peaks;
+		}
+
+		//-----------------------------------------------------------------------------
+		// normalize all data to +/-1.0f
+		static
+		std::vector<float>
+			normalize(std::vector<float> peaks)
+		{
+			// track peak value for normalising
+			float peak = 0.0f;
+			for (float fv : peaks)
+				peak = std::max(peak, fv);
+			float mul = powf(peak, -1);
+			for (size_t s = 0; s < peaks.size(); s++)
+				peaks[s] *= mul;
+			//
+			return peaks;
+		}
+
+		//-----------------------------------------------------------------------------
+		// returns a vector of normalized thumbnail values (+/-1.0f)
+		// this is a positive peak peaker, so a window or slice of a larger
+		// buffer can be drawn without copying
+		static
+		std::vector<float>
+			thumbNail(const SampleView& sv, size_t widthPixels = 100)
+		{
+			return normalize(peaks(sv, widthPixels));
+		}
+
+		//-----------------------------------------------------------------------------
+		// returns a vector of normalized thumbnail values (+/-1.0f)
+		// this is a positive peak peaker
+		static
+		std::vector<float> 
+			thumbNail(const SampleData& sd, size_t widthPixels = 100)
+		{
+			// compact data needs no conversion, scale vanishes on normalizing
+			if (sd.compact())
+			{
+				size_t channels = std::max<size_t>(sd.channels, 1);
+				InterleavedView<const short> sv(sd.begin_pcm(), sd.pcm.size() / channels, channels);
+				return normalize(peaks(sv, widthPixels));
+			}
+			return thumbNail(view(sd), widthPixels);
+		}
+	}
+}
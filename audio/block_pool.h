@@ -0,0 +1,202 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <audio/audio_u.h>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// fixed capacity pool of identically sized SampleBlocks. everything
+		// is allocated up front, acquire and release only touch an atomic
+		// free list so are safe to call from the audio callback.
+		class SampleBlockPool
+		{
+		public:
+			//
+			struct Stats
+			{
+				size_t capacity = 0;
+				size_t inUse = 0;
+				size_t highWater = 0;
+				size_t failed = 0;
+			};
+
+			//-----------------------------------------------------------------------------
+			// move-only handle. returns the block to the pool when dropped
+			class Handle
+			{
+				SampleBlockPool* m_pool = nullptr;
+				uint32_t m_index = 0;
+				//
+				friend class SampleBlockPool;
+				Handle(SampleBlockPool* pool, uint32_t index) : m_pool(pool), m_index(index) {}
+			public:
+				//
+				Handle() {}
+				//
+				Handle(Handle&& arg) : m_pool(arg.m_pool), m_index(arg.m_index)
+				{
+					arg.m_pool = nullptr;
+				}
+				//
+				Handle& operator=(Handle&& arg)
+				{
+					if (this != &arg)
+					{
+						reset();
+						m_pool = arg.m_pool;
+						m_index = arg.m_index;
+						arg.m_pool = nullptr;
+					}
+					return (*this);
+				}
+				//
+				~Handle() { reset(); }
+				// non-copyable
+				Handle(const Handle&) = delete;
+				Handle& operator=(const Handle&) = delete;
+				// give the block back early
+				void reset()
+				{
+					if (m_pool)
+					{
+						m_pool->release(m_index);
+						m_pool = nullptr;
+					}
+				}
+				//
+				explicit operator bool() const { return (m_pool != nullptr); }
+				//
+				SampleBlock& operator*() const { return m_pool->m_blocks[m_index]; }
+				SampleBlock* operator->() const { return &m_pool->m_blocks[m_index]; }
+				SampleBlock* get() const { return (m_pool ? &m_pool->m_blocks[m_index] : nullptr); }
+			};
+
+		private:
+			//
+			static const uint32_t npos = 0xFFFFFFFF;
+			//
+			std::vector<SampleBlock> m_blocks;
+			// per-block link to the next free block
+			std::unique_ptr<std::atomic<uint32_t>[]> m_next;
+			// free list head. low 32 bits index, high 32 bits ABA tag
+			std::atomic<uint64_t> m_head{ npos };
+			//
+			std::atomic<size_t> m_inUse{ 0 };
+			std::atomic<size_t> m_highWater{ 0 };
+			std::atomic<size_t> m_failed{ 0 };
+			//
+			static uint64_t pack(uint32_t index, uint32_t tag)
+			{
+				return (uint64_t(tag) << 32) | index;
+			}
+			//
+			void release(uint32_t index)
+			{
+				uint64_t head = m_head.load(std::memory_order_relaxed);
+				uint64_t next = 0;
+				do
+				{
+					m_next[index].store(uint32_t(head), std::memory_order_relaxed);
+					next = pack(index, uint32_t(head >> 32) + 1);
+				} while (!m_head.compare_exchange_weak(head, next,
+							std::memory_order_release,
+							std::memory_order_relaxed));
+				m_inUse.fetch_sub(1, std::memory_order_relaxed);
+			}
+			// non-copyable
+			SampleBlockPool(const SampleBlockPool&) = delete;
+			SampleBlockPool& operator=(const SampleBlockPool&) = delete;
+
+		public:
+			//
+			SampleBlockPool(size_t capacity, int blockSize, int channels)
+			{
+				m_blocks.reserve(capacity);
+				m_next.reset(new std::atomic<uint32_t>[capacity]);
+				for (size_t b = 0; b < capacity; b++)
+				{
+					m_blocks.emplace_back(blockSize, channels);
+					// chain all blocks into the free list
+					uint32_t next = (b + 1 < capacity ? uint32_t(b + 1) : npos);
+					m_next[b].store(next, std::memory_order_relaxed);
+				}
+				m_head.store(pack(capacity ? 0 : npos, 0));
+			}
+			// all handles must have been dropped by now
+			~SampleBlockPool() {}
+			// get a block. empty handle if the pool is exhausted
+			Handle acquire()
+			{
+				uint64_t head = m_head.load(std::memory_order_acquire);
+				uint64_t next = 0;
+				do
+				{
+					uint32_t index = uint32_t(head);
+					if (index == npos)
+					{
+						m_failed.fetch_add(1, std::memory_order_relaxed);
+						return Handle();
+					}
+					next = pack(m_next[index].load(std::memory_order_relaxed), uint32_t(head >> 32) + 1);
+				} while (!m_head.compare_exchange_weak(head, next,
+							std::memory_order_acquire,
+							std::memory_order_acquire));
+				// track occupancy
+				size_t inUse = m_inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+				size_t hw = m_highWater.load(std::memory_order_relaxed);
+				while (inUse > hw && !m_highWater.compare_exchange_weak(hw, inUse, std::memory_order_relaxed)) {}
+				return Handle(this, uint32_t(head));
+			}
+			//
+			size_t capacity() const { return m_blocks.size(); }
+			//
+			size_t available() const { return capacity() - m_inUse.load(std::memory_order_relaxed); }
+			//
+			Stats stats() const
+			{
+				Stats ret;
+				ret.capacity = capacity();
+				ret.inUse = m_inUse.load(std::memory_order_relaxed);
+				ret.highWater = m_highWater.load(std::memory_order_relaxed);
+				ret.failed = m_failed.load(std::memory_order_relaxed);
+				return ret;
+			}
+		};
+	}
+}
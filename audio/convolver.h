@@ -0,0 +1,449 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <audio/audio_u.h>
+#include <audio/fft.h>
+#include <audio/rtaudio.hpp>
+#include <audio/worker_processor.h>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// acc += x * h over 'bins' interleaved complex values
+		inline void cmac(float* acc, const float* x, const float* h, size_t bins)
+		{
+			size_t k = 0;
+			for (; k + 2 <= bins; k += 2)
+				cx::store(acc + (2 * k), cx::add(cx::load(acc + (2 * k)), cx::mul(cx::load(x + (2 * k)), cx::load(h + (2 * k)))));
+			for (; k < bins; k++)
+			{
+				const float xr = x[2 * k], xi = x[(2 * k) + 1];
+				const float hr = h[2 * k], hi = h[(2 * k) + 1];
+				acc[2 * k] += (xr * hr) - (xi * hi);
+				acc[(2 * k) + 1] += (xr * hi) + (xi * hr);
+			}
+		}
+
+		//-----------------------------------------------------------------------------
+		// an impulse response cut into block sized partitions, each held as
+		// the spectrum of a 2 * block real FFT with the inverse scaling
+		// folded in. immutable once built, so one instance can be shared by
+		// any number of convolvers, e.g. one per stream or per voice
+		class ConvolutionIR
+		{
+			size_t m_block = 0;
+			size_t m_channels = 0;
+			size_t m_frames = 0;
+			size_t m_partitions = 0;
+			// [channel][partition][bin], interleaved complex
+			AlignedBuffer<float> m_spectra;
+			//
+			ConvolutionIR() {}
+
+		public:
+			// nullptr unless block is a power of two
+			static std::shared_ptr<const ConvolutionIR> create(const SampleView& ir, size_t block)
+			{
+				if (!isPow2(block) || ir.channels == 0 || ir.frames == 0)
+					return nullptr;
+				FFT fft(2 * block, FFTPlan::eReal);
+				if (!fft.valid())
+					return nullptr;
+				std::shared_ptr<ConvolutionIR> ret(new ConvolutionIR());
+				ret->m_block = block;
+				ret->m_channels = ir.channels;
+				ret->m_frames = ir.frames;
+				ret->m_partitions = (ir.frames + block - 1) / block;
+				ret->m_spectra.assign(ret->m_channels * ret->m_partitions * ret->stride());
+				const float scale = 1.0f / float(2 * block);
+				AlignedBuffer<float> time((2 * block) + 2);
+				for (size_t c = 0; c < ret->m_channels; c++)
+				{
+					for (size_t p = 0; p < ret->m_partitions; p++)
+					{
+						// partition in the first half, zeros after
+						std::fill(time.data(), time.data() + time.size(), 0.0f);
+						const size_t n = std::min(block, ir.frames - (p * block));
+						for (size_t f = 0; f < n; f++)
+							time[f] = ir.at((p * block) + f, c) * scale;
+						fft.forward(time.data(), ret->m_spectra.data() + (((c * ret->m_partitions) + p) * ret->stride()));
+					}
+				}
+				return ret;
+			}
+			// float or compact
+			static std::shared_ptr<const ConvolutionIR> create(const SampleData& sd, size_t block)
+			{
+				const size_t channels = std::max<size_t>(sd.channels, 1);
+				if (!sd.compact())
+					return create(view(sd), block);
+				std::vector<float> buffer(sd.pcm.size());
+				for (size_t s = 0; s < buffer.size(); s++)
+					buffer[s] = u::convert(sd.pcm[s]);
+				return create(SampleView(buffer.data(), buffer.size() / channels, channels), block);
+			}
+			//
+			size_t block() const { return m_block; }
+			size_t channels() const { return m_channels; }
+			size_t frames() const { return m_frames; }
+			size_t partitions() const { return m_partitions; }
+			// complex bins per partition
+			size_t bins() const { return m_block + 1; }
+			// floats per partition
+			size_t stride() const { return 2 * bins(); }
+			//
+			const float* spectrum(size_t channel, size_t partition) const
+			{
+				return m_spectra.data() + (((channel * m_partitions) + partition) * stride());
+			}
+			// bytes held
+			size_t memory() const { return m_spectra.size() * sizeof(float); }
+		};
+
+		//-----------------------------------------------------------------------------
+		// uniformly partitioned overlap-save convolution. each block of input
+		// is transformed once into a frequency-domain delay line, and every
+		// partition of the IR is a complex multiply-accumulate against it,
+		// so the cost of a long IR is one FFT pair per channel plus a MAC
+		// per partition. output comes out of the same call as its input:
+		// latency is the host buffer and nothing more. host buffers must be
+		// a whole number of blocks, see ReblockProcessor otherwise.
+		//
+		// output channel c convolves input channel c % inputs with IR
+		// channel c % IR channels, so a mono IR applies to every channel
+		// and an N channel IR pairs up with N channels. with threads the
+		// partitions are split between the callback and that many helpers,
+		// each with its own accumulators, which pays off for long IRs and
+		// many channels. the callback keeps partition 0, the only one that
+		// needs the current block. the helpers' partitions only need input
+		// already in the delay line, so each helper works a block ahead,
+		// through the period before its share is due, and adds no latency.
+		// the callback never waits: a share that is not ready in time is
+		// done inline instead, see late(). blocks after the first in one
+		// host buffer follow at once, so helpers pay off best when the
+		// host buffer is one block.
+		class ConvolutionProcessor : public IDuplexProcessor<float>
+		{
+		public:
+			//
+			using base_t = IDuplexProcessor<float>;
+			//
+			struct Options
+			{
+				// helper threads, 0 does everything on the callback thread
+				size_t threads = 0;
+				// applied to each helper thread on start up, off unless set
+				RtHardening hardening;
+			};
+
+		private:
+			//
+			struct Worker
+			{
+				std::thread thread;
+				Wakeup wakeup;
+				// what this helper applied
+				RtHardeningReport report;
+				// [output channel][bin]
+				AlignedBuffer<float> acc;
+				size_t first = 0;
+				size_t last = 0;
+				// delay line slot of the block posted, set before each post
+				size_t slot = 0;
+				// block posted and block finished, equal when idle
+				std::atomic<uint64_t> job{ 0 };
+				std::atomic<uint64_t> done{ 0 };
+			};
+			//
+			std::shared_ptr<const ConvolutionIR> m_ir;
+			size_t m_block = 0;
+			size_t m_ipChannels = 0;
+			size_t m_opChannels = 0;
+			size_t m_partitions = 0;
+			size_t m_stride = 0;
+			Options m_options;
+			FFT m_fft;
+			// per input channel, last two blocks of time
+			AlignedBuffer<float> m_time;
+			// per input channel, one spectrum per partition, a ring. with
+			// helpers one slot more, so a helper up to a period late never
+			// reads a slot being refilled
+			AlignedBuffer<float> m_fdl;
+			size_t m_slots = 0;
+			size_t m_slot = 0;
+			// blocks processed, numbers the helpers' jobs
+			uint64_t m_blocks = 0;
+			// callback's own accumulators, a late helper's share and the
+			// inverse scratch
+			AlignedBuffer<float> m_acc;
+			AlignedBuffer<float> m_share;
+			AlignedBuffer<float> m_out;
+			//
+			std::vector<std::unique_ptr<Worker>> m_workers;
+			std::atomic<bool> m_running{ false };
+			// host buffers that were not a whole number of blocks
+			std::atomic<uint64_t> m_mismatches{ 0 };
+			// helper shares done inline
+			std::atomic<uint64_t> m_late{ 0 };
+			// partitions [first, last) for every output channel into acc,
+			// for the block whose input is in 'slot'
+			void accumulate(float* acc, size_t slot, size_t first, size_t last) const
+			{
+				std::fill(acc, acc + (m_opChannels * m_stride), 0.0f);
+				for (size_t o = 0; o < m_opChannels; o++)
+				{
+					const size_t i = o % m_ipChannels;
+					const size_t c = o % m_ir->channels();
+					const float* fdl = m_fdl.data() + (i * m_slots * m_stride);
+					float* pa = acc + (o * m_stride);
+					for (size_t p = first; p < last; p++)
+					{
+						// partition p meets the input from p blocks ago
+						const size_t s = (slot + m_slots - p) % m_slots;
+						cmac(pa, fdl + (s * m_stride), m_ir->spectrum(c, p), m_ir->bins());
+					}
+				}
+			}
+			//
+			void work(Worker* w)
+			{
+				if (m_options.hardening.enabled())
+					rt::hardenThread(m_options.hardening, w->report);
+				for (;;)
+				{
+					w->wakeup.wait();
+					if (!m_running.load(std::memory_order_acquire))
+						break;
+					const uint64_t job = w->job.load(std::memory_order_acquire);
+					accumulate(w->acc.data(), w->slot, w->first, w->last);
+					w->done.store(job, std::memory_order_release);
+				}
+			}
+			// acc += share
+			void add(const float* share)
+			{
+				float* pa = m_acc.data();
+				const size_t n = m_opChannels * m_stride;
+				for (size_t k = 0; k + 4 <= n; k += 4)
+					cx::store(pa + k, cx::add(cx::load(pa + k), cx::load(share + k)));
+				for (size_t k = n & ~size_t(3); k < n; k++)
+					pa[k] += share[k];
+			}
+			// one block in, one block out
+			void block(const ipview_t& ip, const opview_t& op)
+			{
+				// new input spectra into the delay line
+				m_slot = (m_slot + 1) % m_slots;
+				m_blocks++;
+				for (size_t i = 0; i < m_ipChannels; i++)
+				{
+					float* pt = m_time.data() + (i * 2 * m_block);
+					std::memmove(pt, pt + m_block, m_block * sizeof(float));
+					for (size_t f = 0; f < m_block; f++)
+						pt[m_block + f] = (i < ip.channels ? ip.at(f, i) : 0.0f);
+					m_fft.forward(pt, m_fdl.data() + (((i * m_slots) + m_slot) * m_stride));
+				}
+				// the callback's share, then each helper's, posted last block
+				const size_t first = (m_workers.empty() ? m_partitions : m_workers.front()->first);
+				accumulate(m_acc.data(), m_slot, 0, first);
+				for (auto& w : m_workers)
+				{
+					if (w->done.load(std::memory_order_acquire) == m_blocks)
+						add(w->acc.data());
+					else
+					{
+						// late, or not posted yet. do it here, it only reads
+						accumulate(m_share.data(), m_slot, w->first, w->last);
+						add(m_share.data());
+						m_late.fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+				// the next block's shares, to idle helpers only
+				for (auto& w : m_workers)
+				{
+					if (w->done.load(std::memory_order_acquire) != w->job.load(std::memory_order_relaxed))
+						continue;
+					w->slot = (m_slot + 1) % m_slots;
+					w->job.store(m_blocks + 1, std::memory_order_release);
+					w->wakeup.post();
+				}
+				// the second half of each inverse is the valid part
+				for (size_t o = 0; o < m_opChannels && o < op.channels; o++)
+				{
+					m_fft.inverse(m_acc.data() + (o * m_stride), m_out.data());
+					for (size_t f = 0; f < m_block; f++)
+						op.at(f, o) = m_out[m_block + f];
+				}
+				for (size_t o = m_opChannels; o < op.channels; o++)
+					for (size_t f = 0; f < m_block; f++)
+						op.at(f, o) = 0.0f;
+			}
+			// non-copyable
+			ConvolutionProcessor(const ConvolutionProcessor&) = delete;
+			ConvolutionProcessor& operator=(const ConvolutionProcessor&) = delete;
+
+		public:
+			// everything is allocated, and any helpers started, here
+			ConvolutionProcessor(std::shared_ptr<const ConvolutionIR> ir,
+									unsigned int ipChannels,
+									unsigned int opChannels,
+									const Options& options) :
+				m_ir(ir),
+				m_block(ir ? ir->block() : 0),
+				m_ipChannels(std::max(ipChannels, 1u)),
+				m_opChannels(std::max(opChannels, 1u)),
+				m_partitions(ir ? ir->partitions() : 0),
+				m_stride(ir ? ir->stride() : 0),
+				m_options(options)
+			{
+				if (!m_ir)
+					return;
+				// contiguous shares, the callback keeps the most recent
+				const size_t shares = std::min(m_options.threads + 1, m_partitions);
+				m_slots = m_partitions + (shares > 1 ? 1 : 0);
+				m_fft.assign(2 * m_block, FFTPlan::eReal);
+				m_time.assign(m_ipChannels * 2 * m_block);
+				m_fdl.assign(m_ipChannels * m_slots * m_stride);
+				m_acc.assign(m_opChannels * m_stride);
+				if (shares > 1)
+					m_share.assign(m_opChannels * m_stride);
+				m_out.assign((2 * m_block) + 2);
+				m_running.store(true);
+				for (size_t s = 1; s < shares; s++)
+				{
+					std::unique_ptr<Worker> w(new Worker());
+					w->first = (m_partitions * s) / shares;
+					w->last = (m_partitions * (s + 1)) / shares;
+					w->acc.assign(m_opChannels * m_stride);
+					m_workers.push_back(std::move(w));
+				}
+				for (auto& w : m_workers)
+				{
+					Worker* pw = w.get();
+					pw->thread = std::thread([this, pw]() { work(pw); });
+				}
+			}
+			//
+			ConvolutionProcessor(std::shared_ptr<const ConvolutionIR> ir,
+									unsigned int ipChannels,
+									unsigned int opChannels) :
+				ConvolutionProcessor(ir, ipChannels, opChannels, Options())
+			{
+			}
+			//
+			virtual ~ConvolutionProcessor()
+			{
+				m_running.store(false, std::memory_order_release);
+				for (auto& w : m_workers)
+				{
+					w->wakeup.post();
+					if (w->thread.joinable())
+						w->thread.join();
+				}
+			}
+			//
+			bool valid() const { return (m_ir != nullptr); }
+			size_t block() const { return m_block; }
+			// helpers actually running
+			size_t threads() const { return m_workers.size(); }
+			const std::shared_ptr<const ConvolutionIR>& ir() const { return m_ir; }
+			// host buffers that were not a whole number of blocks, output as silence
+			uint64_t mismatches() const { return m_mismatches.load(std::memory_order_relaxed); }
+			// helper shares not ready when due and done on the callback.
+			// one per helper on the first block, after that a sign of
+			// helpers starved of CPU
+			uint64_t late() const { return m_late.load(std::memory_order_relaxed); }
+			// which hardening steps a helper applied, filled in once it has
+			// started
+			const RtHardeningReport& hardening(size_t helper) const
+			{
+				return m_workers[helper]->report;
+			}
+			// forget the input history. not while the stream runs. a
+			// share posted from the old history is done inline again
+			void reset()
+			{
+				std::fill(m_time.data(), m_time.data() + m_time.size(), 0.0f);
+				std::fill(m_fdl.data(), m_fdl.data() + m_fdl.size(), 0.0f);
+				m_blocks++;
+			}
+			//
+			virtual int process(const ipview_t& ip,
+								const opview_t& op,
+								unsigned int sampleRate,
+								double streamTime,
+								RtAudioStreamStatus status)
+			{
+				(void)sampleRate;
+				(void)streamTime;
+				(void)status;
+				const size_t frames = std::min(ip.frames, op.frames);
+				if (!m_ir || (frames % m_block) != 0)
+				{
+					m_mismatches.fetch_add(1, std::memory_order_relaxed);
+					for (size_t f = 0; f < op.frames; f++)
+						for (size_t c = 0; c < op.channels; c++)
+							op.at(f, c) = 0.0f;
+					return 0;
+				}
+				for (size_t pos = 0; pos < frames; pos += m_block)
+					block(ip.slice(pos, m_block), op.slice(pos, m_block));
+				return 0;
+			}
+			//
+			virtual int process(float* outputBuffer,
+								float* inputBuffer,
+								unsigned int samples,
+								unsigned int ipChannels,
+								unsigned int opChannels,
+								unsigned int sampleRate,
+								double streamTime,
+								RtAudioStreamStatus status)
+			{
+				return process(ipview_t(inputBuffer, samples, ipChannels),
+								opview_t(outputBuffer, samples, opChannels),
+								sampleRate,
+								streamTime,
+								status);
+			}
+			using base_t::process;
+		};
+	}
+}
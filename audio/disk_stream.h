@@ -0,0 +1,336 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <audio/audio_u.h>
+#include <audio/ring_buffer.h>
+#include <audio/wav_rdr.h>
+
+namespace nv2
+{
+	namespace audio
+	{
+		class DiskStreamEngine;
+
+		//-----------------------------------------------------------------------------
+		// one file played from disk. the first frames are preloaded so
+		// playback can start at once, the rest arrives through a ring kept
+		// topped up by the engine's I/O threads. read() is for the audio
+		// thread only.
+		class DiskStream
+		{
+			friend class DiskStreamEngine;
+			// I/O thread side
+			wav::Reader m_reader;
+			std::atomic<bool> m_busy{ false };
+			std::atomic<bool> m_eof{ false };
+			//
+			size_t m_channels = 0;
+			size_t m_sampleRate = 0;
+			// from the header, cut back if the data turns out shorter
+			std::atomic<size_t> m_frames{ 0 };
+			// preloaded head, then the ring carries on from m_headFrames
+			std::vector<float> m_head;
+			size_t m_headFrames = 0;
+			InterleavedRing<float> m_ring;
+			// consumer position
+			std::atomic<size_t> m_played{ 0 };
+			std::atomic<uint64_t> m_underruns{ 0 };
+			//
+			DiskStream(size_t channels, size_t headFrames, size_t ringFrames) :
+				m_ring(ringFrames, channels)
+			{
+				m_head.assign(headFrames * channels, 0.0f);
+			}
+			// frames the consumer can still take before it starves
+			size_t ahead() const
+			{
+				const size_t played = m_played.load(std::memory_order_relaxed);
+				return (played < m_headFrames ? m_headFrames - played : 0) + m_ring.size();
+			}
+			// the file ends here, whatever the header said
+			void truncate()
+			{
+				m_frames.store(std::min(m_frames.load(std::memory_order_relaxed), m_reader.position()), std::memory_order_relaxed);
+				m_eof.store(true, std::memory_order_release);
+			}
+			// I/O thread. one chunk into the ring. false at end of file
+			bool fill(size_t chunkFrames)
+			{
+				RingRegion<InterleavedView<float>> r = m_ring.write_region(chunkFrames);
+				size_t got = m_reader.read(r.first);
+				if (got == r.first.frames)
+					got += m_reader.read(r.second);
+				m_ring.commit_write(got);
+				// a short read before the end means the header claims more
+				// than the file holds, e.g. a recording cut off by a crash
+				if (got < r.first.frames + r.second.frames)
+					truncate();
+				if (m_reader.position() >= m_frames.load(std::memory_order_relaxed))
+					m_eof.store(true, std::memory_order_release);
+				return !m_eof.load(std::memory_order_relaxed);
+			}
+			// non-copyable
+			DiskStream(const DiskStream&) = delete;
+			DiskStream& operator=(const DiskStream&) = delete;
+
+		public:
+			//
+			size_t channels() const { return m_channels; }
+			size_t sampleRate() const { return m_sampleRate; }
+			size_t frames() const { return m_frames.load(std::memory_order_relaxed); }
+			// frames handed to the consumer so far
+			size_t position() const { return m_played.load(std::memory_order_relaxed); }
+			// frames in memory ahead of the consumer
+			size_t buffered() const { return ahead(); }
+			// reads that came up short before the end of the file
+			uint64_t underruns() const { return m_underruns.load(std::memory_order_relaxed); }
+			//
+			bool finished() const { return position() >= frames(); }
+
+			//-----------------------------------------------------------------------------
+			// audio thread. fills op, silence for anything not yet loaded.
+			// returns the frames that came from the file
+			size_t read(const InterleavedView<float>& op)
+			{
+				const size_t played = m_played.load(std::memory_order_relaxed);
+				size_t done = 0;
+				if (played < m_headFrames)
+				{
+					done = std::min(op.frames, m_headFrames - played);
+					InterleavedRing<float>::copy(InterleavedView<const float>(m_head.data() + (played * m_channels), done, m_channels), op.slice(0, done));
+				}
+				done += m_ring.read(op.slice(done, op.frames - done));
+				if (done < op.frames)
+				{
+					if (played + done < frames())
+						m_underruns.fetch_add(1, std::memory_order_relaxed);
+					for (size_t f = done; f < op.frames; f++)
+						for (size_t c = 0; c < op.channels; c++)
+							op.at(f, c) = 0.0f;
+				}
+				m_played.store(played + done, std::memory_order_relaxed);
+				return done;
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		// owns the streams and the I/O threads that feed them. each pass an
+		// I/O thread picks the stream with the least audio left ahead of its
+		// consumer and reads one chunk, so the nearest to starving is always
+		// served first. total memory is capped, open() fails past the cap.
+		class DiskStreamEngine
+		{
+		public:
+			//
+			struct Options
+			{
+				unsigned int threads = 2;
+				// preloaded on open(), covers the first refills
+				size_t headFrames = 32 * 1024;
+				// per stream ring, rounded up to a power of 2
+				size_t ringFrames = 64 * 1024;
+				// size of each disk read
+				size_t chunkFrames = 16 * 1024;
+				// heads, rings and I/O scratch for all open streams
+				size_t memoryBudget = 256 * 1024 * 1024;
+			};
+
+		private:
+			//
+			Options m_options;
+			std::vector<std::shared_ptr<DiskStream>> m_streams;
+			size_t m_memory = 0;
+			//
+			std::mutex m_mutex;
+			std::condition_variable m_cv;
+			bool m_exit = false;
+			std::vector<std::thread> m_threads;
+			//
+			size_t cost(size_t channels) const
+			{
+				const size_t ring = pow2(std::max<size_t>(m_options.ringFrames, 1));
+				return ((m_options.headFrames + ring) * sizeof(float) + m_options.chunkFrames * sizeof(short)) * channels;
+			}
+			// most starved stream with room for a chunk, claimed for this thread
+			std::shared_ptr<DiskStream> pick()
+			{
+				std::shared_ptr<DiskStream> ret;
+				size_t least = size_t(-1);
+				for (const std::shared_ptr<DiskStream>& s : m_streams)
+				{
+					// acquire pairs with the release in work(), the ring's
+					// producer side moves between I/O threads
+					if (s->m_eof.load(std::memory_order_relaxed) || s->m_busy.load(std::memory_order_acquire))
+						continue;
+					if (s->m_ring.writable() < std::min(m_options.chunkFrames, s->m_ring.capacity()))
+						continue;
+					const size_t ahead = s->ahead();
+					if (ahead < least)
+					{
+						least = ahead;
+						ret = s;
+					}
+				}
+				if (ret)
+					ret->m_busy.store(true, std::memory_order_relaxed);
+				return ret;
+			}
+			//
+			void work()
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				while (!m_exit)
+				{
+					std::shared_ptr<DiskStream> s = pick();
+					if (!s)
+					{
+						// everything is full, check again shortly
+						m_cv.wait_for(lock, std::chrono::milliseconds(2));
+						continue;
+					}
+					lock.unlock();
+					s->fill(m_options.chunkFrames);
+					s->m_busy.store(false, std::memory_order_release);
+					lock.lock();
+				}
+			}
+			// non-copyable
+			DiskStreamEngine(const DiskStreamEngine&) = delete;
+			DiskStreamEngine& operator=(const DiskStreamEngine&) = delete;
+
+		public:
+			//
+			DiskStreamEngine(const Options& options) :
+				m_options(options)
+			{
+				m_options.chunkFrames = std::max<size_t>(m_options.chunkFrames, 1);
+				for (unsigned int t = 0; t < std::max(m_options.threads, 1u); t++)
+					m_threads.emplace_back([this]() { work(); });
+			}
+			//
+			DiskStreamEngine() : DiskStreamEngine(Options()) {}
+			//
+			~DiskStreamEngine()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_exit = true;
+				}
+				m_cv.notify_all();
+				for (std::thread& t : m_threads)
+					t.join();
+			}
+			// control thread. null if the file cannot be read or the
+			// memory budget would be exceeded
+			std::shared_ptr<DiskStream> open(const std::string& filename)
+			{
+				// the ring shape depends on the channel count
+				wav::Reader probe;
+				if (!probe.open(filename))
+					return nullptr;
+				const size_t channels = probe.channels();
+				const size_t bytes = cost(channels);
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (m_memory + bytes > m_options.memoryBudget)
+						return nullptr;
+					// reserve now, the head is loaded outside the lock
+					m_memory += bytes;
+				}
+				probe.close();
+				std::shared_ptr<DiskStream> s(new DiskStream(channels, m_options.headFrames, m_options.ringFrames));
+				if (!s->m_reader.open(filename))
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_memory -= bytes;
+					return nullptr;
+				}
+				s->m_channels = channels;
+				s->m_sampleRate = s->m_reader.sampleRate();
+				s->m_frames.store(s->m_reader.frames());
+				s->m_headFrames = s->m_reader.read(InterleavedView<float>(s->m_head.data(), m_options.headFrames, channels));
+				if (s->m_headFrames < m_options.headFrames)
+					s->truncate();
+				s->m_eof.store(s->m_reader.position() >= s->m_frames.load());
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_streams.push_back(s);
+				}
+				m_cv.notify_all();
+				return s;
+			}
+			// control thread. stops refilling and returns the memory. the
+			// stream itself lives until the last reference goes, so drop it
+			// away from the audio thread
+			void close(const std::shared_ptr<DiskStream>& s)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				auto it = std::find(m_streams.begin(), m_streams.end(), s);
+				if (it == m_streams.end())
+					return;
+				m_memory -= cost(s->channels());
+				m_streams.erase(it);
+			}
+			// bytes reserved by open streams
+			size_t memory()
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				return m_memory;
+			}
+			//
+			size_t streams()
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				return m_streams.size();
+			}
+			// summed over open streams
+			uint64_t underruns()
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				uint64_t ret = 0;
+				for (const std::shared_ptr<DiskStream>& s : m_streams)
+					ret += s->underruns();
+				return ret;
+			}
+		};
+	}
+}
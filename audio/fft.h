@@ -0,0 +1,567 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <audio/audio_u.h>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// zeroed storage on a 64 byte boundary, for SIMD loads and so hot
+		// buffers do not share cache lines. movable, not copyable
+		template <typename T>
+		class AlignedBuffer
+		{
+			static const size_t alignment = 64;
+			std::unique_ptr<uint8_t[]> m_raw;
+			T* m_data = nullptr;
+			size_t m_size = 0;
+		public:
+			//
+			AlignedBuffer() {}
+			explicit AlignedBuffer(size_t size) { assign(size); }
+			AlignedBuffer(AlignedBuffer&&) = default;
+			AlignedBuffer& operator=(AlignedBuffer&&) = default;
+			//
+			void assign(size_t size)
+			{
+				m_raw.reset(new uint8_t[(size * sizeof(T)) + alignment]);
+				const uintptr_t p = (uintptr_t(m_raw.get()) + alignment - 1) & ~uintptr_t(alignment - 1);
+				m_data = reinterpret_cast<T*>(p);
+				m_size = size;
+				std::fill(m_data, m_data + size, T());
+			}
+			//
+			T* data() { return m_data; }
+			const T* data() const { return m_data; }
+			size_t size() const { return m_size; }
+			bool empty() const { return (m_size == 0); }
+			T& operator[](size_t i) { return m_data[i]; }
+			const T& operator[](size_t i) const { return m_data[i]; }
+		};
+
+		//-----------------------------------------------------------------------------
+		// two interleaved complex floats, re/im/re/im. SSE or plain arrays
+		namespace cx
+		{
+#if _RT_X86
+			typedef __m128 c2;
+			inline c2 load(const float* p) { return _mm_loadu_ps(p); }
+			inline void store(float* p, c2 v) { _mm_storeu_ps(p, v); }
+			// one complex in both halves
+			inline c2 dup(const float* p)
+			{
+				const __m128 v = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(p));
+				return _mm_movelh_ps(v, v);
+			}
+			inline c2 set(float re, float im) { return _mm_setr_ps(re, im, re, im); }
+			inline void storeLo(float* p, c2 v) { _mm_storel_pi(reinterpret_cast<__m64*>(p), v); }
+			inline void storeHi(float* p, c2 v) { _mm_storeh_pi(reinterpret_cast<__m64*>(p), v); }
+			inline c2 add(c2 a, c2 b) { return _mm_add_ps(a, b); }
+			inline c2 sub(c2 a, c2 b) { return _mm_sub_ps(a, b); }
+			inline c2 scale(c2 a, float f) { return _mm_mul_ps(a, _mm_set1_ps(f)); }
+			// complex product
+			inline c2 mul(c2 a, c2 w)
+			{
+				const __m128 wr = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+				const __m128 wi = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1));
+				const __m128 as = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+				return _mm_add_ps(_mm_mul_ps(a, wr), _mm_xor_ps(_mm_mul_ps(as, wi), _mm_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f)));
+			}
+			// a * conj(w)
+			inline c2 mulc(c2 a, c2 w)
+			{
+				const __m128 wr = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+				const __m128 wi = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1));
+				const __m128 as = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+				return _mm_add_ps(_mm_mul_ps(a, wr), _mm_xor_ps(_mm_mul_ps(as, wi), _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f)));
+			}
+			// times j, times -j
+			inline c2 mulj(c2 a) { return _mm_xor_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f)); }
+			inline c2 mulnj(c2 a) { return _mm_xor_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f)); }
+#else
+			struct c2 { float f[4]; };
+			inline c2 load(const float* p) { c2 r; for (int l = 0; l < 4; l++) r.f[l] = p[l]; return r; }
+			inline void store(float* p, c2 v) { for (int l = 0; l < 4; l++) p[l] = v.f[l]; }
+			inline c2 dup(const float* p) { c2 r = { { p[0], p[1], p[0], p[1] } }; return r; }
+			inline c2 set(float re, float im) { c2 r = { { re, im, re, im } }; return r; }
+			inline void storeLo(float* p, c2 v) { p[0] = v.f[0]; p[1] = v.f[1]; }
+			inline void storeHi(float* p, c2 v) { p[0] = v.f[2]; p[1] = v.f[3]; }
+			inline c2 add(c2 a, c2 b) { for (int l = 0; l < 4; l++) a.f[l] += b.f[l]; return a; }
+			inline c2 sub(c2 a, c2 b) { for (int l = 0; l < 4; l++) a.f[l] -= b.f[l]; return a; }
+			inline c2 scale(c2 a, float f) { for (int l = 0; l < 4; l++) a.f[l] *= f; return a; }
+			inline c2 mul(c2 a, c2 w)
+			{
+				c2 r;
+				for (int l = 0; l < 4; l += 2)
+				{
+					r.f[l] = (a.f[l] * w.f[l]) - (a.f[l + 1] * w.f[l + 1]);
+					r.f[l + 1] = (a.f[l] * w.f[l + 1]) + (a.f[l + 1] * w.f[l]);
+				}
+				return r;
+			}
+			inline c2 mulc(c2 a, c2 w)
+			{
+				c2 r;
+				for (int l = 0; l < 4; l += 2)
+				{
+					r.f[l] = (a.f[l] * w.f[l]) + (a.f[l + 1] * w.f[l + 1]);
+					r.f[l + 1] = (a.f[l + 1] * w.f[l]) - (a.f[l] * w.f[l + 1]);
+				}
+				return r;
+			}
+			inline c2 mulj(c2 a) { c2 r = { { -a.f[1], a.f[0], -a.f[3], a.f[2] } }; return r; }
+			inline c2 mulnj(c2 a) { c2 r = { { a.f[1], -a.f[0], a.f[3], -a.f[2] } }; return r; }
+#endif
+			// twiddle, conjugated for the inverse
+			template <bool inv>
+			inline c2 twiddle(c2 a, c2 w) { return (inv ? mulc(a, w) : mul(a, w)); }
+			// forward rotates by -j, inverse by +j
+			template <bool inv>
+			inline c2 rot(c2 a) { return (inv ? mulj(a) : mulnj(a)); }
+
+			//-----------------------------------------------------------------------------
+			// 4 point DFT in place
+			template <bool inv>
+			inline void dft4(c2& a, c2& b, c2& c, c2& d)
+			{
+				const c2 apc = add(a, c);
+				const c2 amc = sub(a, c);
+				const c2 bpd = add(b, d);
+				const c2 rbmd = rot<inv>(sub(b, d));
+				a = add(apc, bpd);
+				c = sub(apc, bpd);
+				b = add(amc, rbmd);
+				d = sub(amc, rbmd);
+			}
+
+			//-----------------------------------------------------------------------------
+			// one Stockham radix-4 pass, n points at stride s, natural order
+			// out. twiddles are W^p, W^2p, W^3p for p < n/4, one run each.
+			// vectorised along q, or along p on the first pass (s == 1)
+			template <bool inv>
+			inline void radix4(const float* x, float* y, size_t n, size_t s, const float* tw)
+			{
+				const size_t m = n / 4;
+				if (s == 1)
+				{
+					if (m == 1)
+					{
+						c2 a = dup(x), b = dup(x + 2), c = dup(x + 4), d = dup(x + 6);
+						dft4<inv>(a, b, c, d);
+						storeLo(y, a); storeLo(y + 2, b); storeLo(y + 4, c); storeLo(y + 6, d);
+						return;
+					}
+					for (size_t p = 0; p < m; p += 2)
+					{
+						c2 a = load(x + (2 * p));
+						c2 b = load(x + (2 * (p + m)));
+						c2 c = load(x + (2 * (p + (2 * m))));
+						c2 d = load(x + (2 * (p + (3 * m))));
+						dft4<inv>(a, b, c, d);
+						b = twiddle<inv>(b, load(tw + (2 * p)));
+						c = twiddle<inv>(c, load(tw + (2 * (m + p))));
+						d = twiddle<inv>(d, load(tw + (2 * ((2 * m) + p))));
+						float* y0 = y + (8 * p);
+						storeLo(y0, a); storeLo(y0 + 2, b); storeLo(y0 + 4, c); storeLo(y0 + 6, d);
+						storeHi(y0 + 8, a); storeHi(y0 + 10, b); storeHi(y0 + 12, c); storeHi(y0 + 14, d);
+					}
+					return;
+				}
+				for (size_t p = 0; p < m; p++)
+				{
+					const c2 w1 = dup(tw + (2 * p));
+					const c2 w2 = dup(tw + (2 * (m + p)));
+					const c2 w3 = dup(tw + (2 * ((2 * m) + p)));
+					const float* x0 = x + (2 * s * p);
+					float* y0 = y + (8 * s * p);
+					const size_t xs = 2 * s * m;
+					for (size_t q = 0; q < 2 * s; q += 4)
+					{
+						c2 a = load(x0 + q);
+						c2 b = load(x0 + xs + q);
+						c2 c = load(x0 + (2 * xs) + q);
+						c2 d = load(x0 + (3 * xs) + q);
+						dft4<inv>(a, b, c, d);
+						if (p)
+						{
+							b = twiddle<inv>(b, w1);
+							c = twiddle<inv>(c, w2);
+							d = twiddle<inv>(d, w3);
+						}
+						store(y0 + q, a);
+						store(y0 + (2 * s) + q, b);
+						store(y0 + (4 * s) + q, c);
+						store(y0 + (6 * s) + q, d);
+					}
+				}
+			}
+
+			//-----------------------------------------------------------------------------
+			// last pass when log2(size) is odd: 8 point DFTs at stride s,
+			// split into two 4 point DFTs and the W8 rotations
+			template <bool inv>
+			inline void radix8(const float* x, float* y, size_t s)
+			{
+				const float h = 0.70710678118654752f;
+				const c2 w1 = set(h, inv ? h : -h);
+				const c2 w3 = set(-h, inv ? h : -h);
+				const size_t step = (s == 1 ? 2 : 4);
+				for (size_t q = 0; q < 2 * s; q += step)
+				{
+					c2 a[8];
+					for (size_t k = 0; k < 8; k++)
+						a[k] = (s == 1 ? dup(x + (2 * k)) : load(x + (2 * s * k) + q));
+					dft4<inv>(a[0], a[2], a[4], a[6]);
+					dft4<inv>(a[1], a[3], a[5], a[7]);
+					const c2 o[4] = { a[1], mul(a[3], w1), rot<inv>(a[5]), mul(a[7], w3) };
+					const c2 e[4] = { a[0], a[2], a[4], a[6] };
+					for (size_t k = 0; k < 4; k++)
+					{
+						const c2 lo = add(e[k], o[k]);
+						const c2 hi = sub(e[k], o[k]);
+						if (s == 1)
+						{
+							storeLo(y + (2 * k), lo);
+							storeLo(y + (2 * (k + 4)), hi);
+						}
+						else
+						{
+							store(y + (2 * s * k) + q, lo);
+							store(y + (2 * s * (k + 4)) + q, hi);
+						}
+					}
+				}
+			}
+		}
+
+		//-----------------------------------------------------------------------------
+		// precomputed twiddles and pass layout for one power of two size.
+		// immutable once built and shared through a process wide cache, so
+		// any number of threads may run the same plan, each with its own
+		// work buffer. complex data is interleaved re/im. real transforms
+		// of n points produce n/2 + 1 bins and run as an n/2 point complex
+		// transform plus a split pass. the inverse is unscaled: forward
+		// then inverse multiplies by n
+		class FFTPlan
+		{
+		public:
+			//
+			enum Kind { eComplex, eReal };
+			//
+			static const size_t maxSize = size_t(1) << 24;
+
+		private:
+			//
+			struct Pass
+			{
+				size_t radix;
+				size_t n;
+				size_t s;
+				size_t twiddle;
+			};
+			//
+			size_t m_size = 0;
+			Kind m_kind = eComplex;
+			std::vector<Pass> m_passes;
+			AlignedBuffer<float> m_twiddles;
+			// real only, the n/2 complex plan and W^k for the split pass
+			std::shared_ptr<const FFTPlan> m_half;
+			AlignedBuffer<float> m_split;
+			//
+			FFTPlan(size_t size, Kind kind) : m_size(size), m_kind(kind) {}
+			//
+			void build()
+			{
+				const double pi = 3.14159265358979323846;
+				if (m_kind == eReal)
+				{
+					m_half = get(m_size / 2, eComplex);
+					m_split.assign(m_size);
+					for (size_t k = 0; k < m_size / 2; k++)
+					{
+						m_split[2 * k] = float(std::cos(2.0 * pi * double(k) / double(m_size)));
+						m_split[(2 * k) + 1] = float(-std::sin(2.0 * pi * double(k) / double(m_size)));
+					}
+					return;
+				}
+				size_t log2n = 0;
+				while ((size_t(1) << log2n) < m_size)
+					log2n++;
+				// radix-4 passes down to the last 4 or 8 points
+				std::vector<float> tw;
+				size_t n = m_size;
+				size_t s = 1;
+				while (n >= 4 && !(n == 8 && (log2n & 1)))
+				{
+					const size_t m = n / 4;
+					m_passes.push_back(Pass{ 4, n, s, tw.size() });
+					for (size_t k = 1; k <= 3; k++)
+					{
+						for (size_t p = 0; p < m; p++)
+						{
+							tw.push_back(float(std::cos(2.0 * pi * double(k * p) / double(n))));
+							tw.push_back(float(-std::sin(2.0 * pi * double(k * p) / double(n))));
+						}
+					}
+					n /= 4;
+					s *= 4;
+				}
+				if (n == 8)
+					m_passes.push_back(Pass{ 8, n, s, 0 });
+				else if (n == 2)
+					m_passes.push_back(Pass{ 2, n, s, 0 });
+				m_twiddles.assign(tw.size());
+				std::copy(tw.begin(), tw.end(), m_twiddles.data());
+			}
+			//
+			template <bool inv>
+			void run(const Pass& ps, const float* x, float* y) const
+			{
+				if (ps.radix == 4)
+					cx::radix4<inv>(x, y, ps.n, ps.s, m_twiddles.data() + ps.twiddle);
+				else if (ps.radix == 8)
+					cx::radix8<inv>(x, y, ps.s);
+				else
+				{
+					// only ever the whole of a 2 point transform
+					const float r0 = x[0], i0 = x[1], r1 = x[2], i1 = x[3];
+					y[0] = r0 + r1; y[1] = i0 + i1;
+					y[2] = r0 - r1; y[3] = i0 - i1;
+				}
+			}
+			// complex, passes ping-pong so the last one lands in out
+			template <bool inv>
+			void complex(const float* in, float* out, float* work) const
+			{
+				const size_t passes = m_passes.size();
+				if (passes == 0)
+				{
+					if (out != in)
+						std::memcpy(out, in, m_size * 2 * sizeof(float));
+					return;
+				}
+				float* w1 = work;
+				float* w2 = work + (m_size * 2);
+				const float* src = in;
+				for (size_t i = 0; i < passes; i++)
+				{
+					float* dst = (((passes - 1 - i) & 1) ? w1 : out);
+					// in place, the first pass must not write its own input
+					if (i == 0 && dst == in)
+						dst = w2;
+					run<inv>(m_passes[i], src, dst);
+					src = dst;
+				}
+				if (src != out)
+					std::memcpy(out, src, m_size * 2 * sizeof(float));
+			}
+			// n reals as n/2 complex, then split into n/2 + 1 bins
+			void realForward(const float* in, float* out, float* work) const
+			{
+				const size_t m = m_size / 2;
+				float* z = work;
+				m_half->forward(in, z, work + (m * 2));
+				const float* w = m_split.data();
+				for (size_t k = 0; k <= m / 2; k++)
+				{
+					const size_t j = (k == 0 ? 0 : m - k);
+					const float zr = z[2 * k], zi = z[(2 * k) + 1];
+					const float cr = z[2 * j], ci = -z[(2 * j) + 1];
+					// even and odd halves
+					const float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+					const float orr = 0.5f * (zi - ci), oi = -0.5f * (zr - cr);
+					const float wr = w[2 * k], wi = w[(2 * k) + 1];
+					const float tr = (orr * wr) - (oi * wi), ti = (orr * wi) + (oi * wr);
+					// bins k and m - k share the same pair of inputs
+					const size_t kk = m - k;
+					out[2 * k] = er + tr;
+					out[(2 * k) + 1] = ei + ti;
+					out[2 * kk] = er - tr;
+					out[(2 * kk) + 1] = -(ei - ti);
+				}
+				// DC and Nyquist are real
+				const float z0r = z[0], z0i = z[1];
+				out[0] = z0r + z0i;
+				out[1] = 0;
+				out[2 * m] = z0r - z0i;
+				out[(2 * m) + 1] = 0;
+			}
+			// n/2 + 1 bins merged to n/2 complex, then inverted as n reals
+			void realInverse(const float* in, float* out, float* work) const
+			{
+				const size_t m = m_size / 2;
+				float* z = work;
+				const float* w = m_split.data();
+				for (size_t k = 0; k <= m / 2; k++)
+				{
+					const size_t kk = m - k;
+					const float xr = in[2 * k], xi = in[(2 * k) + 1];
+					const float cr = in[2 * kk], ci = -in[(2 * kk) + 1];
+					const float er = xr + cr, ei = xi + ci;
+					// (x - conj) * conj(W^k)
+					const float dr = xr - cr, di = xi - ci;
+					const float wr = w[2 * k], wi = w[(2 * k) + 1];
+					const float orr = (dr * wr) + (di * wi), oi = (di * wr) - (dr * wi);
+					// z[k] = e + j o, z[m - k] = conj(e) + j conj(o)
+					z[2 * k] = er - oi;
+					z[(2 * k) + 1] = ei + orr;
+					if (kk < m && kk != k)
+					{
+						z[2 * kk] = er + oi;
+						z[(2 * kk) + 1] = -ei + orr;
+					}
+				}
+				m_half->inverse(z, out, work + (m * 2));
+			}
+
+		public:
+			// cached plan for a power of two size, nullptr otherwise.
+			// complex from 1 point, real from 2
+			static std::shared_ptr<const FFTPlan> get(size_t size, Kind kind = eComplex)
+			{
+				if (!isPow2(size) || size > maxSize || (kind == eReal && size < 2))
+					return nullptr;
+				static std::mutex mutex;
+				static std::map<std::pair<size_t, int>, std::shared_ptr<const FFTPlan>> plans;
+				const std::pair<size_t, int> key(size, int(kind));
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					auto it = plans.find(key);
+					if (it != plans.end())
+						return it->second;
+				}
+				// built unlocked, a real plan fetches its half size plan
+				std::shared_ptr<FFTPlan> plan(new FFTPlan(size, kind));
+				plan->build();
+				std::lock_guard<std::mutex> lock(mutex);
+				// first one in wins
+				return plans.insert(std::make_pair(key, std::shared_ptr<const FFTPlan>(plan))).first->second;
+			}
+			//
+			size_t size() const { return m_size; }
+			Kind kind() const { return m_kind; }
+			// complex values out of forward()
+			size_t bins() const { return (m_kind == eReal ? (m_size / 2) + 1 : m_size); }
+			// floats of scratch a caller must supply
+			size_t workSize() const { return (m_kind == eReal ? m_size * 3 : m_size * 4); }
+
+			// complex: n complex in and out. real: n floats in, n/2 + 1
+			// complex out. in and out may be the same buffer if it is big
+			// enough for both
+			void forward(const float* in, float* out, float* work) const
+			{
+				if (m_kind == eReal)
+					realForward(in, out, work);
+				else
+					complex<false>(in, out, work);
+			}
+			// the reverse shapes of forward(), unscaled
+			void inverse(const float* in, float* out, float* work) const
+			{
+				if (m_kind == eReal)
+					realInverse(in, out, work);
+				else
+					complex<true>(in, out, work);
+			}
+			// 'count' transforms 'inStride' and 'outStride' floats apart, run
+			// one after another. each is vectorised within itself, not across
+			// the batch, so this saves only the per call overhead of looking
+			// up the plan and work buffer
+			void forward(const float* in, size_t inStride, float* out, size_t outStride, size_t count, float* work) const
+			{
+				for (size_t i = 0; i < count; i++)
+					forward(in + (i * inStride), out + (i * outStride), work);
+			}
+			//
+			void inverse(const float* in, size_t inStride, float* out, size_t outStride, size_t count, float* work) const
+			{
+				for (size_t i = 0; i < count; i++)
+					inverse(in + (i * inStride), out + (i * outStride), work);
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		// a cached plan and its own aligned work buffer. one per thread, e.g.
+		// per processor. nothing is allocated after assign()
+		class FFT
+		{
+			std::shared_ptr<const FFTPlan> m_plan;
+			AlignedBuffer<float> m_work;
+		public:
+			//
+			FFT() {}
+			//
+			explicit FFT(size_t size, FFTPlan::Kind kind = FFTPlan::eComplex)
+			{
+				assign(size, kind);
+			}
+			// false unless size is a power of two
+			bool assign(size_t size, FFTPlan::Kind kind = FFTPlan::eComplex)
+			{
+				m_plan = FFTPlan::get(size, kind);
+				if (!m_plan)
+					return false;
+				m_work.assign(m_plan->workSize());
+				return true;
+			}
+			//
+			bool valid() const { return (m_plan != nullptr); }
+			size_t size() const { return (m_plan ? m_plan->size() : 0); }
+			size_t bins() const { return (m_plan ? m_plan->bins() : 0); }
+			const FFTPlan& plan() const { return *m_plan; }
+			// see FFTPlan
+			void forward(const float* in, float* out) { m_plan->forward(in, out, m_work.data()); }
+			void inverse(const float* in, float* out) { m_plan->inverse(in, out, m_work.data()); }
+			// batches, see FFTPlan
+			void forward(const float* in, size_t inStride, float* out, size_t outStride, size_t count)
+			{
+				m_plan->forward(in, inStride, out, outStride, count, m_work.data());
+			}
+			void inverse(const float* in, size_t inStride, float* out, size_t outStride, size_t count)
+			{
+				m_plan->inverse(in, inStride, out, outStride, count, m_work.data());
+			}
+		};
+	}
+}
@@ -0,0 +1,594 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include <audio/audio_u.h>
+#include <audio/rs4.h>
+#include <audio/rtaudio.hpp>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// 4 float lanes, SSE or plain arrays. one lane per channel
+		namespace lanes
+		{
+#if _RT_X86
+			typedef __m128 v4;
+			inline v4 load(const float* p) { return _mm_loadu_ps(p); }
+			inline void store(float* p, v4 v) { _mm_storeu_ps(p, v); }
+			inline v4 set1(float f) { return _mm_set1_ps(f); }
+			inline v4 vadd(v4 a, v4 b) { return _mm_add_ps(a, b); }
+			inline v4 vsub(v4 a, v4 b) { return _mm_sub_ps(a, b); }
+			inline v4 vmul(v4 a, v4 b) { return _mm_mul_ps(a, b); }
+			inline v4 vmax(v4 a, v4 b) { return _mm_max_ps(a, b); }
+			inline v4 vabs(v4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+#else
+			struct v4 { float f[4]; };
+			inline v4 load(const float* p) { v4 r; for (int l = 0; l < 4; l++) r.f[l] = p[l]; return r; }
+			inline void store(float* p, v4 v) { for (int l = 0; l < 4; l++) p[l] = v.f[l]; }
+			inline v4 set1(float f) { v4 r; for (int l = 0; l < 4; l++) r.f[l] = f; return r; }
+			inline v4 vadd(v4 a, v4 b) { for (int l = 0; l < 4; l++) a.f[l] += b.f[l]; return a; }
+			inline v4 vsub(v4 a, v4 b) { for (int l = 0; l < 4; l++) a.f[l] -= b.f[l]; return a; }
+			inline v4 vmul(v4 a, v4 b) { for (int l = 0; l < 4; l++) a.f[l] *= b.f[l]; return a; }
+			inline v4 vmax(v4 a, v4 b) { for (int l = 0; l < 4; l++) a.f[l] = std::max(a.f[l], b.f[l]); return a; }
+			inline v4 vabs(v4 a) { for (int l = 0; l < 4; l++) a.f[l] = std::fabs(a.f[l]); return a; }
+#endif
+		}
+
+		//-----------------------------------------------------------------------------
+		// EBU R128 / BS.1770 loudness, sample peak, RMS and true peak in one
+		// pass. each frame goes through the K-weighting biquads, the energy
+		// and peak accumulators and a 4x polyphase interpolator (the RS4
+		// filter design) together, four channels per SSE vector. energies
+		// are closed every 100ms: momentary is the last 4, short-term the
+		// last 30, and integrated is gated from a fixed 0.1 LU histogram of
+		// 400ms blocks, so memory does not grow with duration and add()
+		// never allocates.
+		class LoudnessMeter
+		{
+		public:
+			//
+			struct Options
+			{
+				// 4x oversampled true peak, the costliest part
+				bool truePeak = true;
+				// RS4 quality for the interpolator. 1 gives 16 taps a phase
+				size_t quality = 1;
+			};
+			// LUFS, dBFS and dBTP. -inf when there is nothing to measure
+			struct Result
+			{
+				double integrated = -std::numeric_limits<double>::infinity();
+				double momentary = -std::numeric_limits<double>::infinity();
+				double shortTerm = -std::numeric_limits<double>::infinity();
+				double maxMomentary = -std::numeric_limits<double>::infinity();
+				double maxShortTerm = -std::numeric_limits<double>::infinity();
+				// per channel
+				std::vector<double> peak;
+				std::vector<double> truePeak;
+				std::vector<double> rms;
+				uint64_t frames = 0;
+				// single line for logs
+				std::string str() const
+				{
+					std::string ret = nv2::sprintf("I %.1f LUFS M %.1f S %.1f max M %.1f S %.1f",
+						integrated, momentary, shortTerm, maxMomentary, maxShortTerm);
+					for (size_t c = 0; c < peak.size(); c++)
+						ret += nv2::sprintf(" [%llu peak %.2f tp %.2f rms %.2f]", (unsigned long long)c, peak[c], truePeak[c], rms[c]);
+					return ret;
+				}
+			};
+
+		private:
+			// 0.1 LU bins from -70 to +5 LUFS
+			static const size_t bins = 750;
+			// 100ms blocks in the short-term window
+			static const size_t history = 30;
+			//
+			size_t m_channels = 0;
+			size_t m_groups = 0;
+			size_t m_sampleRate = 0;
+			Options m_options;
+			std::vector<double> m_weights;
+			// K-weighting, pre-filter then RLB high-pass
+			float m_b[2][3];
+			float m_a[2][2];
+			// 4x interpolator, phase major
+			std::vector<float> m_poly;
+			size_t m_taps = 0;
+			size_t m_write = 0;
+			// per lane, m_groups * 4 each
+			std::vector<float> m_state;
+			std::vector<float> m_hist;
+			std::vector<float> m_peak;
+			std::vector<float> m_tp;
+			std::vector<float> m_ss;
+			std::vector<float> m_energy;
+			std::vector<double> m_rmsTotal;
+			// 100ms block
+			size_t m_blockLen = 0;
+			size_t m_blockFill = 0;
+			double m_blocks[history];
+			uint64_t m_count = 0;
+			uint64_t m_frames = 0;
+			// gated histogram of 400ms blocks
+			uint64_t m_histCount[bins];
+			double m_histEnergy[bins];
+			//
+			double m_momentary = 0;
+			double m_shortTerm = 0;
+			double m_maxMomentary = 0;
+			double m_maxShortTerm = 0;
+			// frame gather scratch
+			float m_frame[4];
+			//
+			static double lufs(double z)
+			{
+				return (z > 0 ? -0.691 + (10.0 * std::log10(z)) : -std::numeric_limits<double>::infinity());
+			}
+			static double dB(double v)
+			{
+				return (v > 0 ? 20.0 * std::log10(v) : -std::numeric_limits<double>::infinity());
+			}
+			// BS.1770 filters re-derived for the sample rate
+			void design()
+			{
+				const double pi = 3.14159265358979323846;
+				double K = std::tan(pi * 1681.974450955533 / m_sampleRate);
+				const double Q = 0.7071752369554196;
+				const double Vh = std::pow(10.0, 3.999843853973347 / 20.0);
+				const double Vb = std::pow(Vh, 0.4996667741545416);
+				double a0 = 1.0 + K / Q + K * K;
+				m_b[0][0] = float((Vh + Vb * K / Q + K * K) / a0);
+				m_b[0][1] = float(2.0 * (K * K - Vh) / a0);
+				m_b[0][2] = float((Vh - Vb * K / Q + K * K) / a0);
+				m_a[0][0] = float(2.0 * (K * K - 1.0) / a0);
+				m_a[0][1] = float((1.0 - K / Q + K * K) / a0);
+				K = std::tan(pi * 38.13547087602444 / m_sampleRate);
+				const double Q2 = 0.5003270373238773;
+				a0 = 1.0 + K / Q2 + K * K;
+				m_b[1][0] = 1.0f;
+				m_b[1][1] = -2.0f;
+				m_b[1][2] = 1.0f;
+				m_a[1][0] = float(2.0 * (K * K - 1.0) / a0);
+				m_a[1][1] = float((1.0 - K / Q2 + K * K) / a0);
+			}
+			// one 100ms block done
+			void close()
+			{
+				double z = 0;
+				for (size_t c = 0; c < m_channels; c++)
+				{
+					z += m_weights[c] * (double(m_energy[c]) / double(m_blockLen));
+					m_rmsTotal[c] += m_ss[c];
+					m_energy[c] = 0;
+					m_ss[c] = 0;
+				}
+				m_blocks[m_count % history] = z;
+				m_count++;
+				m_blockFill = 0;
+				// 400ms, 75% overlap
+				const size_t n = size_t(std::min<uint64_t>(m_count, 4));
+				double sum = 0;
+				for (size_t b = 0; b < n; b++)
+					sum += m_blocks[(m_count - 1 - b) % history];
+				m_momentary = sum / double(n);
+				if (m_count >= 4)
+				{
+					m_maxMomentary = std::max(m_maxMomentary, m_momentary);
+					const double l = lufs(m_momentary);
+					if (l > -70.0)
+					{
+						const size_t bin = std::min(bins - 1, size_t((l + 70.0) * 10.0));
+						m_histCount[bin]++;
+						m_histEnergy[bin] += m_momentary;
+					}
+				}
+				const size_t s = size_t(std::min<uint64_t>(m_count, history));
+				sum = 0;
+				for (size_t b = 0; b < s; b++)
+					sum += m_blocks[(m_count - 1 - b) % history];
+				m_shortTerm = sum / double(s);
+				if (m_count >= history)
+					m_maxShortTerm = std::max(m_maxShortTerm, m_shortTerm);
+			}
+			// the fused per-frame kernel for one group of 4 channels
+			void frame(size_t g)
+			{
+				using namespace lanes;
+				const size_t o = g * 4;
+				const v4 x = load(m_frame);
+				store(&m_peak[o], vmax(load(&m_peak[o]), vabs(x)));
+				store(&m_ss[o], vadd(load(&m_ss[o]), vmul(x, x)));
+				// K-weighting, transposed direct form II
+				float* st = &m_state[g * 16];
+				v4 y = x;
+				for (size_t k = 0; k < 2; k++)
+				{
+					const v4 s1 = load(st + (k * 8));
+					const v4 s2 = load(st + (k * 8) + 4);
+					const v4 out = vadd(vmul(set1(m_b[k][0]), y), s1);
+					store(st + (k * 8), vsub(vadd(vmul(set1(m_b[k][1]), y), s2), vmul(set1(m_a[k][0]), out)));
+					store(st + (k * 8) + 4, vsub(vmul(set1(m_b[k][2]), y), vmul(set1(m_a[k][1]), out)));
+					y = out;
+				}
+				store(&m_energy[o], vadd(load(&m_energy[o]), vmul(y, y)));
+				if (!m_options.truePeak)
+					return;
+				// history written twice so the window never wraps
+				float* h = &m_hist[g * m_taps * 8];
+				store(h + (m_write * 4), x);
+				store(h + ((m_write + m_taps) * 4), x);
+				const float* w = h + ((m_write + 1) * 4);
+				v4 tp = load(&m_tp[o]);
+				for (size_t p = 0; p < 4; p++)
+				{
+					const float* pc = &m_poly[p * m_taps];
+					v4 acc = set1(0.0f);
+					for (size_t j = 0; j < m_taps; j++)
+						acc = vadd(acc, vmul(set1(pc[j]), load(w + (j * 4))));
+					tp = vmax(tp, vabs(acc));
+				}
+				store(&m_tp[o], tp);
+			}
+			// interleaved or planar, anything with at(frame, channel)
+			template <typename V>
+			size_t append(const V& ip)
+			{
+				const uint64_t before = m_count;
+				const size_t channels = std::min(ip.channels, m_channels);
+				for (size_t f = 0; f < ip.frames; f++)
+				{
+					for (size_t g = 0; g < m_groups; g++)
+					{
+						for (size_t l = 0; l < 4; l++)
+						{
+							const size_t c = (g * 4) + l;
+							m_frame[l] = (c < channels ? sample(ip.at(f, c)) : 0.0f);
+						}
+						frame(g);
+					}
+					if (m_options.truePeak)
+						m_write = (m_write + 1 < m_taps ? m_write + 1 : 0);
+					m_frames++;
+					if (++m_blockFill == m_blockLen)
+						close();
+				}
+				return size_t(m_count - before);
+			}
+			static float sample(float v) { return v; }
+			static float sample(short v) { return u::convert(v); }
+
+		public:
+			//
+			LoudnessMeter(size_t channels, size_t sampleRate, const Options& options) :
+				m_channels(std::max<size_t>(channels, 1)),
+				m_groups((std::max<size_t>(channels, 1) + 3) / 4),
+				m_sampleRate(std::max<size_t>(sampleRate, 1)),
+				m_options(options)
+			{
+				// BS.1770 channel weights. surrounds are +1.5dB, LFE ignored
+				m_weights.assign(m_channels, 1.0);
+				if (m_channels == 5)
+					m_weights[3] = m_weights[4] = 1.41;
+				if (m_channels == 6)
+				{
+					m_weights[3] = 0.0;
+					m_weights[4] = m_weights[5] = 1.41;
+				}
+				design();
+				if (m_options.truePeak && !RS4::polyphase(4, m_options.quality, m_poly, m_taps))
+					m_options.truePeak = false;
+				m_state.assign(m_groups * 16, 0.0f);
+				m_hist.assign(m_groups * std::max<size_t>(m_taps, 1) * 8, 0.0f);
+				m_blockLen = std::max<size_t>(m_sampleRate / 10, 1);
+				reset();
+			}
+			//
+			LoudnessMeter(size_t channels, size_t sampleRate) :
+				LoudnessMeter(channels, sampleRate, Options())
+			{
+			}
+			// start again, keeps the channel weights
+			void reset()
+			{
+				const size_t lanes = m_groups * 4;
+				std::fill(m_state.begin(), m_state.end(), 0.0f);
+				std::fill(m_hist.begin(), m_hist.end(), 0.0f);
+				m_peak.assign(lanes, 0.0f);
+				m_tp.assign(lanes, 0.0f);
+				m_ss.assign(lanes, 0.0f);
+				m_energy.assign(lanes, 0.0f);
+				m_rmsTotal.assign(m_channels, 0.0);
+				m_write = 0;
+				m_blockFill = 0;
+				m_count = 0;
+				m_frames = 0;
+				for (size_t b = 0; b < history; b++)
+					m_blocks[b] = 0;
+				for (size_t b = 0; b < bins; b++)
+				{
+					m_histCount[b] = 0;
+					m_histEnergy[b] = 0;
+				}
+				m_momentary = m_shortTerm = m_maxMomentary = m_maxShortTerm = 0;
+			}
+			// BS.1770 weight for one channel, e.g. 0 for an LFE
+			void weight(size_t channel, double w)
+			{
+				if (channel < m_channels)
+					m_weights[channel] = w;
+			}
+			// frames in order. returns 100ms blocks completed
+			size_t add(const SampleView& ip) { return append(ip); }
+			size_t add(const InterleavedView<const short>& ip) { return append(ip); }
+			size_t add(const PlanarSampleView& ip) { return append(ip); }
+			// gated over everything so far
+			double integrated() const
+			{
+				uint64_t n = 0;
+				double e = 0;
+				for (size_t b = 0; b < bins; b++)
+				{
+					n += m_histCount[b];
+					e += m_histEnergy[b];
+				}
+				if (n == 0)
+					return -std::numeric_limits<double>::infinity();
+				// relative gate 10 LU below the absolute-gated mean
+				const double gate = lufs(e / double(n)) - 10.0;
+				const size_t first = size_t(std::max(0.0, std::ceil((gate + 70.0) * 10.0)));
+				n = 0;
+				e = 0;
+				for (size_t b = first; b < bins; b++)
+				{
+					n += m_histCount[b];
+					e += m_histEnergy[b];
+				}
+				return (n ? lufs(e / double(n)) : -std::numeric_limits<double>::infinity());
+			}
+			double momentary() const { return (m_count ? lufs(m_momentary) : -std::numeric_limits<double>::infinity()); }
+			double shortTerm() const { return (m_count ? lufs(m_shortTerm) : -std::numeric_limits<double>::infinity()); }
+			double maxMomentary() const { return lufs(m_maxMomentary); }
+			double maxShortTerm() const { return lufs(m_maxShortTerm); }
+			// dBFS / dBTP
+			double peak(size_t channel) const { return dB(m_peak[channel]); }
+			double truePeak(size_t channel) const { return dB(std::max(m_tp[channel], m_peak[channel])); }
+			double rms(size_t channel) const
+			{
+				return (m_frames ? dB(std::sqrt((m_rmsTotal[channel] + m_ss[channel]) / double(m_frames))) : -std::numeric_limits<double>::infinity());
+			}
+			//
+			size_t channels() const { return m_channels; }
+			uint64_t frames() const { return m_frames; }
+			//
+			Result result() const
+			{
+				Result ret;
+				ret.integrated = integrated();
+				ret.momentary = momentary();
+				ret.shortTerm = shortTerm();
+				ret.maxMomentary = maxMomentary();
+				ret.maxShortTerm = maxShortTerm();
+				ret.frames = m_frames;
+				for (size_t c = 0; c < m_channels; c++)
+				{
+					ret.peak.push_back(peak(c));
+					ret.truePeak.push_back(truePeak(c));
+					ret.rms.push_back(rms(c));
+				}
+				return ret;
+			}
+
+			// offline, float or compact storage
+			static Result measure(const SampleData& sd, const Options& options)
+			{
+				const size_t channels = std::max<size_t>(sd.channels, 1);
+				LoudnessMeter meter(channels, sd.sampleRate, options);
+				if (sd.compact())
+					meter.add(InterleavedView<const short>(sd.begin_pcm(), sd.pcm.size() / channels, channels));
+				else
+					meter.add(view(sd));
+				return meter.result();
+			}
+			//
+			static Result measure(const SampleData& sd)
+			{
+				return measure(sd, Options());
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		// live metering. runs the meter in the callback and publishes the
+		// readings every 100ms for any thread to read. optionally wraps
+		// another processor and meters its output
+		class LoudnessProcessor : public IDuplexProcessor<float>
+		{
+		public:
+			//
+			using base_t = IDuplexProcessor<float>;
+			//
+			enum Source { eInput, eOutput };
+			//
+			struct Options
+			{
+				Source source = eInput;
+				LoudnessMeter::Options meter;
+			};
+
+		private:
+			//
+			using f64 = std::atomic<double>;
+			//
+			LoudnessMeter m_meter;
+			Options m_options;
+			IDuplexProcessor<float>* m_processor = nullptr;
+			// published by the callback
+			f64 m_integrated{ 0 };
+			f64 m_momentary{ 0 };
+			f64 m_shortTerm{ 0 };
+			f64 m_maxMomentary{ 0 };
+			f64 m_maxShortTerm{ 0 };
+			std::unique_ptr<f64[]> m_peak;
+			std::unique_ptr<f64[]> m_truePeak;
+			std::unique_ptr<f64[]> m_rms;
+			std::atomic<uint64_t> m_frames{ 0 };
+			// requested by a reader, honoured by the callback
+			std::atomic<bool> m_reset{ false };
+			//
+			void publish()
+			{
+				m_integrated.store(m_meter.integrated(), std::memory_order_relaxed);
+				m_momentary.store(m_meter.momentary(), std::memory_order_relaxed);
+				m_shortTerm.store(m_meter.shortTerm(), std::memory_order_relaxed);
+				m_maxMomentary.store(m_meter.maxMomentary(), std::memory_order_relaxed);
+				m_maxShortTerm.store(m_meter.maxShortTerm(), std::memory_order_relaxed);
+				for (size_t c = 0; c < m_meter.channels(); c++)
+				{
+					m_peak[c].store(m_meter.peak(c), std::memory_order_relaxed);
+					m_truePeak[c].store(m_meter.truePeak(c), std::memory_order_relaxed);
+					m_rms[c].store(m_meter.rms(c), std::memory_order_relaxed);
+				}
+				m_frames.store(m_meter.frames(), std::memory_order_release);
+			}
+
+		public:
+			//
+			LoudnessProcessor(size_t channels, size_t sampleRate, const Options& options, IDuplexProcessor<float>* processor = nullptr) :
+				m_meter(channels, sampleRate, options.meter),
+				m_options(options),
+				m_processor(processor),
+				m_peak(new f64[m_meter.channels()]),
+				m_truePeak(new f64[m_meter.channels()]),
+				m_rms(new f64[m_meter.channels()])
+			{
+				publish();
+			}
+			//
+			LoudnessProcessor(size_t channels, size_t sampleRate, IDuplexProcessor<float>* processor = nullptr) :
+				LoudnessProcessor(channels, sampleRate, Options(), processor)
+			{
+			}
+			// any thread. cleared at the start of the next callback
+			void reset()
+			{
+				m_reset.store(true, std::memory_order_release);
+			}
+			// any thread. as of the last 100ms block
+			LoudnessMeter::Result result() const
+			{
+				LoudnessMeter::Result ret;
+				ret.frames = m_frames.load(std::memory_order_acquire);
+				ret.integrated = m_integrated.load(std::memory_order_relaxed);
+				ret.momentary = m_momentary.load(std::memory_order_relaxed);
+				ret.shortTerm = m_shortTerm.load(std::memory_order_relaxed);
+				ret.maxMomentary = m_maxMomentary.load(std::memory_order_relaxed);
+				ret.maxShortTerm = m_maxShortTerm.load(std::memory_order_relaxed);
+				for (size_t c = 0; c < m_meter.channels(); c++)
+				{
+					ret.peak.push_back(m_peak[c].load(std::memory_order_relaxed));
+					ret.truePeak.push_back(m_truePeak[c].load(std::memory_order_relaxed));
+					ret.rms.push_back(m_rms[c].load(std::memory_order_relaxed));
+				}
+				return ret;
+			}
+			// the wrapped processor sees the planar calls
+			virtual void reserve(size_t frames, unsigned int ipChannels, unsigned int opChannels)
+			{
+				if (m_processor)
+					m_processor->reserve(frames, ipChannels, opChannels);
+			}
+			//
+			virtual int process(const ipview_t& ip,
+								const opview_t& op,
+								unsigned int sampleRate,
+								double streamTime,
+								RtAudioStreamStatus status)
+			{
+				int ret = 0;
+				if (m_processor)
+					ret = m_processor->process(ip, op, sampleRate, streamTime, status);
+				if (m_reset.exchange(false, std::memory_order_acquire))
+				{
+					m_meter.reset();
+					publish();
+				}
+				if (m_meter.add(m_options.source == eInput ? ip : ipview_t(op)))
+					publish();
+				return ret;
+			}
+			//
+			virtual int process(float* outputBuffer,
+								float* inputBuffer,
+								unsigned int samples,
+								unsigned int ipChannels,
+								unsigned int opChannels,
+								unsigned int sampleRate,
+								double streamTime,
+								RtAudioStreamStatus status)
+			{
+				return process(ipview_t(inputBuffer, samples, ipChannels),
+								opview_t(outputBuffer, samples, opChannels),
+								sampleRate,
+								streamTime,
+								status);
+			}
+			// non-interleaved streams are metered in place
+			virtual int process(const ipplanar_t& ip,
+								const opplanar_t& op,
+								unsigned int sampleRate,
+								double streamTime,
+								RtAudioStreamStatus status)
+			{
+				int ret = 0;
+				if (m_processor)
+					ret = m_processor->process(ip, op, sampleRate, streamTime, status);
+				if (m_reset.exchange(false, std::memory_order_acquire))
+				{
+					m_meter.reset();
+					publish();
+				}
+				if (m_meter.add(m_options.source == eInput ? ip : ipplanar_t(op)))
+					publish();
+				return ret;
+			}
+		};
+	}
+}
@@ -0,0 +1,376 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+
+#pragma once
+
+#include <vector>
+#include <audio/audio_u.h>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// N inputs x M outputs gain matrix. only non-zero entries are visited
+		// when mixing, common layouts get dedicated kernels. one pass over
+		// the input, accumulating into the output.
+		template <typename T = float>
+		class MixMatrix
+		{
+		public:
+			//
+			struct Entry
+			{
+				unsigned int ip = 0;
+				unsigned int op = 0;
+				T gain = T(0);
+			};
+			// picked when the matrix changes
+			enum Kernel { eEmpty, eGeneric, eMonoStereo, eStereoMono, eSurround51, eSurround71 };
+
+		private:
+			//
+			unsigned int m_ipChannels = 0;
+			unsigned int m_opChannels = 0;
+			// dense, op major
+			std::vector<T> m_gains;
+			// non-zero entries of the above
+			std::vector<Entry> m_entries;
+			//
+			Kernel m_kernel = eEmpty;
+			//
+			void compile()
+			{
+				m_entries.clear();
+				for (unsigned int o = 0; o < m_opChannels; o++)
+				{
+					for (unsigned int i = 0; i < m_ipChannels; i++)
+					{
+						const T g = m_gains[(size_t(o) * m_ipChannels) + i];
+						if (g != T(0))
+						{
+							Entry e;
+							e.ip = i;
+							e.op = o;
+							e.gain = g;
+							m_entries.push_back(e);
+						}
+					}
+				}
+				if (m_entries.empty())
+					m_kernel = eEmpty;
+				else if (m_ipChannels == 1 && m_opChannels == 2)
+					m_kernel = eMonoStereo;
+				else if (m_ipChannels == 2 && m_opChannels == 1)
+					m_kernel = eStereoMono;
+				else if (m_ipChannels == 6 && m_opChannels == 2)
+					m_kernel = eSurround51;
+				else if (m_ipChannels == 8 && m_opChannels == 2)
+					m_kernel = eSurround71;
+				else
+					m_kernel = eGeneric;
+			}
+
+			//-----------------------------------------------------------------------------
+			// SSE versions for packed float. return frames done, the caller
+			// finishes the tail. the templates are the no-SIMD fallback
+			template <typename U>
+			static size_t sseMonoStereo(const U*, U*, size_t, U, U, U, U) { return 0; }
+			template <typename U>
+			static size_t sseStereoMono(const U*, U*, size_t, U, U, U, U) { return 0; }
+			template <typename U>
+			static size_t sseRamp(U*, size_t, size_t, const U*, const U*) { return 0; }
+#if _RT_X86
+			//
+			static size_t sseMonoStereo(const float* ps, float* pd, size_t frames, float gl, float gr, float l0, float dl)
+			{
+				const __m128 g = _mm_setr_ps(gl, gr, gl, gr);
+				const __m128 ramp = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+				const __m128 dl4 = _mm_set1_ps(dl * 4.0f);
+				__m128 l = _mm_add_ps(_mm_set1_ps(l0), _mm_mul_ps(ramp, _mm_set1_ps(dl)));
+				size_t f = 0;
+				for (; f + 4 <= frames; f += 4)
+				{
+					const __m128 x = _mm_mul_ps(_mm_loadu_ps(ps + f), l);
+					// x0 x0 x1 x1 and x2 x2 x3 x3
+					const __m128 lo = _mm_mul_ps(_mm_unpacklo_ps(x, x), g);
+					const __m128 hi = _mm_mul_ps(_mm_unpackhi_ps(x, x), g);
+					float* po = pd + (f * 2);
+					_mm_storeu_ps(po, _mm_add_ps(_mm_loadu_ps(po), lo));
+					_mm_storeu_ps(po + 4, _mm_add_ps(_mm_loadu_ps(po + 4), hi));
+					l = _mm_add_ps(l, dl4);
+				}
+				return f;
+			}
+			//
+			static size_t sseStereoMono(const float* ps, float* pd, size_t frames, float gl, float gr, float l0, float dl)
+			{
+				const __m128 vl = _mm_set1_ps(gl);
+				const __m128 vr = _mm_set1_ps(gr);
+				const __m128 ramp = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+				const __m128 dl4 = _mm_set1_ps(dl * 4.0f);
+				__m128 l = _mm_add_ps(_mm_set1_ps(l0), _mm_mul_ps(ramp, _mm_set1_ps(dl)));
+				size_t f = 0;
+				for (; f + 4 <= frames; f += 4)
+				{
+					const __m128 a = _mm_loadu_ps(ps + (f * 2));
+					const __m128 b = _mm_loadu_ps(ps + (f * 2) + 4);
+					// split L0 R0 L1 R1 | L2 R2 L3 R3
+					const __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+					const __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+					const __m128 y = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(left, vl), _mm_mul_ps(right, vr)), l);
+					_mm_storeu_ps(pd + f, _mm_add_ps(_mm_loadu_ps(pd + f), y));
+					l = _mm_add_ps(l, dl4);
+				}
+				return f;
+			}
+			// four frames of every channel per pass, which is 'channels'
+			// vectors. lane l of vector k is sample (k * 4) + l of the group
+			static size_t sseRamp(float* pd, size_t frames, size_t channels, const float* g, const float* dg)
+			{
+				static const size_t maxChannels = 16;
+				if (channels == 0 || channels > maxChannels)
+					return 0;
+				__m128 v[maxChannels];
+				__m128 dv[maxChannels];
+				for (size_t k = 0; k < channels; k++)
+				{
+					float a[4], b[4];
+					for (size_t l = 0; l < 4; l++)
+					{
+						const size_t i = (k * 4) + l;
+						const size_t c = i % channels;
+						a[l] = g[c] + (dg[c] * float(i / channels));
+						b[l] = dg[c] * 4.0f;
+					}
+					v[k] = _mm_loadu_ps(a);
+					dv[k] = _mm_loadu_ps(b);
+				}
+				size_t f = 0;
+				for (; f + 4 <= frames; f += 4)
+				{
+					float* po = pd + (f * channels);
+					for (size_t k = 0; k < channels; k++, po += 4)
+					{
+						_mm_storeu_ps(po, _mm_mul_ps(_mm_loadu_ps(po), v[k]));
+						v[k] = _mm_add_ps(v[k], dv[k]);
+					}
+				}
+				return f;
+			}
+#endif
+			// fixed channel counts so the compiler can unroll and vectorise
+			template <unsigned int IC, unsigned int OC>
+			void dense(const InterleavedView<const T>& ip, const InterleavedView<T>& op, T l0, T dl) const
+			{
+				T g[OC][IC];
+				for (unsigned int o = 0; o < OC; o++)
+					for (unsigned int i = 0; i < IC; i++)
+						g[o][i] = m_gains[(size_t(o) * IC) + i];
+				for (size_t f = 0; f < ip.frames; f++)
+				{
+					const T* ps = ip.frame(f);
+					T* pd = op.frame(f);
+					const T l = l0 + (dl * T(f));
+					for (unsigned int o = 0; o < OC; o++)
+					{
+						T acc = T(0);
+						for (unsigned int i = 0; i < IC; i++)
+							acc += ps[i] * g[o][i];
+						pd[o] += acc * l;
+					}
+				}
+			}
+
+		public:
+			//
+			MixMatrix() {}
+			// all zero
+			MixMatrix(unsigned int ipChannels, unsigned int opChannels) :
+				m_ipChannels(ipChannels),
+				m_opChannels(opChannels),
+				m_gains(size_t(ipChannels) * opChannels, T(0))
+			{
+			}
+			//
+			unsigned int ipChannels() const { return m_ipChannels; }
+			unsigned int opChannels() const { return m_opChannels; }
+			//
+			Kernel kernel() const { return m_kernel; }
+			//
+			const std::vector<Entry>& entries() const { return m_entries; }
+			// out of range is ignored
+			MixMatrix& set(unsigned int ip, unsigned int op, T gain)
+			{
+				if (ip < m_ipChannels && op < m_opChannels)
+				{
+					m_gains[(size_t(op) * m_ipChannels) + ip] = gain;
+					compile();
+				}
+				return (*this);
+			}
+			//
+			T get(unsigned int ip, unsigned int op) const
+			{
+				return ((ip < m_ipChannels && op < m_opChannels) ? m_gains[(size_t(op) * m_ipChannels) + ip] : T(0));
+			}
+
+			//-----------------------------------------------------------------------------
+			// sensible default for a pair of channel counts. mono is copied to
+			// every output, stereo folds to mono at -6dB, 5.1 and 7.1 fold to
+			// stereo with ITU-R BS.775 coefficients (LFE dropped), anything
+			// else maps channel to channel.
+			static MixMatrix standard(unsigned int ipChannels, unsigned int opChannels)
+			{
+				MixMatrix ret(ipChannels, opChannels);
+				const T k = T(0.70710678118654752);
+				if (ipChannels == 1)
+				{
+					for (unsigned int o = 0; o < opChannels; o++)
+						ret.set(0, o, T(1));
+				}
+				else if (ipChannels == 2 && opChannels == 1)
+				{
+					ret.set(0, 0, T(0.5)).set(1, 0, T(0.5));
+				}
+				else if ((ipChannels == 6 || ipChannels == 8) && opChannels == 2)
+				{
+					// L R C LFE Ls Rs [Lb Rb]
+					const T n = T(1) / (T(1) + k + k + (ipChannels == 8 ? k : T(0)));
+					ret.set(0, 0, n).set(1, 1, n);
+					ret.set(2, 0, k * n).set(2, 1, k * n);
+					ret.set(4, 0, k * n).set(5, 1, k * n);
+					if (ipChannels == 8)
+						ret.set(6, 0, k * n).set(7, 1, k * n);
+				}
+				else
+				{
+					for (unsigned int c = 0; c < std::min(ipChannels, opChannels); c++)
+						ret.set(c, c, T(1));
+				}
+				return ret;
+			}
+
+			//-----------------------------------------------------------------------------
+			// op += matrix * ip. the input is scaled by a level ramping from
+			// l0 by dl per frame. channel counts must match the matrix
+			void apply(const InterleavedView<const T>& ip, const InterleavedView<T>& op, T l0 = T(1), T dl = T(0)) const
+			{
+				if (ip.channels != m_ipChannels || op.channels != m_opChannels)
+					return;
+				const size_t frames = std::min(ip.frames, op.frames);
+				size_t done = 0;
+				switch (m_kernel)
+				{
+				case eEmpty:
+					return;
+				case eMonoStereo:
+					if (ip.packed() && op.packed())
+						done = sseMonoStereo(ip.ptr, op.ptr, frames, m_gains[0], m_gains[1], l0, dl);
+					for (size_t f = done; f < frames; f++)
+					{
+						const T x = ip.frame(f)[0] * (l0 + (dl * T(f)));
+						op.frame(f)[0] += x * m_gains[0];
+						op.frame(f)[1] += x * m_gains[1];
+					}
+					return;
+				case eStereoMono:
+					if (ip.packed() && op.packed())
+						done = sseStereoMono(ip.ptr, op.ptr, frames, m_gains[0], m_gains[1], l0, dl);
+					for (size_t f = done; f < frames; f++)
+					{
+						const T* ps = ip.frame(f);
+						op.frame(f)[0] += ((ps[0] * m_gains[0]) + (ps[1] * m_gains[1])) * (l0 + (dl * T(f)));
+					}
+					return;
+				case eSurround51:
+					dense<6, 2>(ip.slice(0, frames), op.slice(0, frames), l0, dl);
+					return;
+				case eSurround71:
+					dense<8, 2>(ip.slice(0, frames), op.slice(0, frames), l0, dl);
+					return;
+				case eGeneric:
+					break;
+				}
+				for (size_t f = 0; f < frames; f++)
+				{
+					const T* ps = ip.frame(f);
+					T* pd = op.frame(f);
+					const T l = l0 + (dl * T(f));
+					for (const Entry& e : m_entries)
+						pd[e.op] += ps[e.ip] * e.gain * l;
+				}
+			}
+			//-----------------------------------------------------------------------------
+			// op *= g[c] + (dg[c] * f), a per channel gain ramp across the block
+			static void ramp(const InterleavedView<T>& op, const T* g, const T* dg)
+			{
+				size_t done = 0;
+				if (op.packed())
+					done = sseRamp(op.ptr, op.frames, op.channels, g, dg);
+				for (size_t f = done; f < op.frames; f++)
+				{
+					T* pd = op.frame(f);
+					for (size_t c = 0; c < op.channels; c++)
+						pd[c] *= g[c] + (dg[c] * T(f));
+				}
+			}
+			// planar, each channel is a single contiguous ramp
+			static void ramp(const PlanarView<T>& op, const T* g, const T* dg)
+			{
+				for (size_t c = 0; c < op.channels; c++)
+				{
+					T* pd = op.channel(c);
+					size_t f = sseRamp(pd, op.frames, 1, g + c, dg + c);
+					for (; f < op.frames; f++)
+						pd[f] *= g[c] + (dg[c] * T(f));
+				}
+			}
+			// planar. each entry is a contiguous multiply-add over one channel
+			void apply(const PlanarView<const T>& ip, const PlanarView<T>& op, T l0 = T(1), T dl = T(0)) const
+			{
+				if (ip.channels != m_ipChannels || op.channels != m_opChannels)
+					return;
+				const size_t frames = std::min(ip.frames, op.frames);
+				for (const Entry& e : m_entries)
+				{
+					const T* ps = ip.channel(e.ip);
+					T* pd = op.channel(e.op);
+					const T g = e.gain * l0;
+					const T gs = e.gain * dl;
+					for (size_t f = 0; f < frames; f++)
+						pd[f] += ps[f] * (g + (gs * T(f)));
+				}
+			}
+		};
+	}
+}
@@ -0,0 +1,525 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <g40/nv2_util.h>
+#include <audio/audio_u.h>
+#include <audio/wav_rdr.h>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// fold min, max and sum of squares per channel into mn/mx/ss, in
+		// +/-1.0f units. SSE when the frames are packed and a vector holds a
+		// whole number of them (1, 2 or 4 channels)
+		inline void extents(const float* p, size_t frames, size_t channels, size_t stride, float* mn, float* mx, double* ss)
+		{
+			size_t done = 0;
+#if _RT_X86
+			if (stride == channels && (channels == 1 || channels == 2 || channels == 4))
+			{
+				const size_t n = (frames * channels) & ~size_t(3);
+				__m128 vmn = _mm_set1_ps(FLT_MAX);
+				__m128 vmx = _mm_set1_ps(-FLT_MAX);
+				__m128 vss = _mm_setzero_ps();
+				for (size_t i = 0; i < n; i += 4)
+				{
+					const __m128 v = _mm_loadu_ps(p + i);
+					vmn = _mm_min_ps(vmn, v);
+					vmx = _mm_max_ps(vmx, v);
+					vss = _mm_add_ps(vss, _mm_mul_ps(v, v));
+				}
+				float lmn[4], lmx[4], lss[4];
+				_mm_storeu_ps(lmn, vmn);
+				_mm_storeu_ps(lmx, vmx);
+				_mm_storeu_ps(lss, vss);
+				for (size_t l = 0; l < 4 && n; l++)
+				{
+					const size_t c = l % channels;
+					mn[c] = std::min(mn[c], lmn[l]);
+					mx[c] = std::max(mx[c], lmx[l]);
+					ss[c] += lss[l];
+				}
+				done = n / channels;
+			}
+#endif
+			for (size_t f = done; f < frames; f++)
+			{
+				const float* ps = p + (f * stride);
+				for (size_t c = 0; c < channels; c++)
+				{
+					mn[c] = std::min(mn[c], ps[c]);
+					mx[c] = std::max(mx[c], ps[c]);
+					ss[c] += double(ps[c]) * ps[c];
+				}
+			}
+		}
+
+		//-----------------------------------------------------------------------------
+		// as above for native 16 bit PCM, 8 lanes (1, 2, 4 or 8 channels)
+		inline void extents(const short* p, size_t frames, size_t channels, size_t stride, float* mn, float* mx, double* ss)
+		{
+			size_t done = 0;
+			const double r2 = double(u::ratio) * u::ratio;
+#if _RT_X86
+			if (stride == channels && (channels == 1 || channels == 2 || channels == 4 || channels == 8))
+			{
+				const size_t n = (frames * channels) & ~size_t(7);
+				__m128i vmn = _mm_set1_epi16(32767);
+				__m128i vmx = _mm_set1_epi16(-32768);
+				// squares for lanes 0-3 and 4-7
+				__m128 vlo = _mm_setzero_ps();
+				__m128 vhi = _mm_setzero_ps();
+				for (size_t i = 0; i < n; i += 8)
+				{
+					const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+					vmn = _mm_min_epi16(vmn, v);
+					vmx = _mm_max_epi16(vmx, v);
+					const __m128i lo = _mm_mullo_epi16(v, v);
+					const __m128i hi = _mm_mulhi_epi16(v, v);
+					vlo = _mm_add_ps(vlo, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, hi)));
+					vhi = _mm_add_ps(vhi, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, hi)));
+				}
+				short lmn[8], lmx[8];
+				float lss[8];
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(lmn), vmn);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(lmx), vmx);
+				_mm_storeu_ps(lss, vlo);
+				_mm_storeu_ps(lss + 4, vhi);
+				for (size_t l = 0; l < 8 && n; l++)
+				{
+					const size_t c = l % channels;
+					mn[c] = std::min(mn[c], u::convert(lmn[l]));
+					mx[c] = std::max(mx[c], u::convert(lmx[l]));
+					ss[c] += lss[l] * r2;
+				}
+				done = n / channels;
+			}
+#endif
+			for (size_t f = done; f < frames; f++)
+			{
+				const short* ps = p + (f * stride);
+				for (size_t c = 0; c < channels; c++)
+				{
+					mn[c] = std::min(mn[c], u::convert(ps[c]));
+					mx[c] = std::max(mx[c], u::convert(ps[c]));
+					ss[c] += (double(ps[c]) * ps[c]) * r2;
+				}
+			}
+		}
+
+		//-----------------------------------------------------------------------------
+		// shared by the index sidecar files
+		namespace sidecar
+		{
+			// file size and time, to tell when a sidecar is stale
+			inline bool stamp(const std::string& path, uint64_t& size, int64_t& time)
+			{
+#if _IS_WINDOWS
+				struct _stat64 st;
+				if (_stat64(path.c_str(), &st) != 0)
+					return false;
+#else
+				struct stat st;
+				if (stat(path.c_str(), &st) != 0)
+					return false;
+#endif
+				size = uint64_t(st.st_size);
+				time = int64_t(st.st_mtime);
+				return true;
+			}
+			//
+			inline FILE* open(const std::string& path, const char* mode)
+			{
+				FILE* fp = nullptr;
+#if _IS_WINDOWS
+				if (fopen_s(&fp, path.c_str(), mode) != 0)
+					fp = nullptr;
+#else
+				fp = fopen(path.c_str(), mode);
+#endif
+				return fp;
+			}
+		}
+
+		//-----------------------------------------------------------------------------
+		// multi-resolution min/max/RMS per channel. level 0 summarises
+		// blocks of 2^shift frames, each level above halves the count. built
+		// in one pass as audio is read, so the source never has to be in
+		// memory, and saved as a sidecar file of about 2.5% of the 16 bit
+		// source. a query picks the coarsest level no wider than a pixel, so
+		// any zoom is O(pixels).
+		class PeakIndex
+		{
+		public:
+			// one block of one channel, 6 bytes. min/max as 16 bit PCM, RMS
+			// scaled to 0..65535
+			struct Bin
+			{
+				int16_t min;
+				int16_t max;
+				uint16_t rms;
+			};
+			// one pixel, +/-1.0f
+			struct Peak
+			{
+				float min = 0;
+				float max = 0;
+				float rms = 0;
+			};
+
+		private:
+			// sidecar layout, followed by each level's bins
+			struct Header
+			{
+				uint32_t tag;
+				uint32_t version;
+				uint32_t channels;
+				uint32_t sampleRate;
+				uint32_t shift;
+				uint32_t levels;
+				uint64_t frames;
+				// size and modification time of the source when built
+				uint64_t sourceSize;
+				int64_t sourceTime;
+			};
+			static const uint32_t tag = 0x58494B50;	// 'PKIX'
+			static const uint32_t version = 1;
+			//
+			size_t m_channels = 0;
+			size_t m_sampleRate = 0;
+			size_t m_shift = 8;
+			size_t m_frames = 0;
+			// bins are channel interleaved within a level
+			std::vector<std::vector<Bin>> m_levels;
+			// block being built
+			size_t m_fill = 0;
+			std::vector<float> m_min;
+			std::vector<float> m_max;
+			std::vector<double> m_ss;
+			//
+			static Bin bin(float mn, float mx, double ss, size_t frames)
+			{
+				Bin ret;
+				ret.min = u::convert(std::max(-1.0f, std::min(1.0f, mn)));
+				ret.max = u::convert(std::max(-1.0f, std::min(1.0f, mx)));
+				const double rms = (frames ? std::sqrt(ss / double(frames)) : 0.0);
+				ret.rms = uint16_t(std::min(1.0, rms) * 65535.0 + 0.5);
+				return ret;
+			}
+			// close the block being built
+			void emit()
+			{
+				if (m_fill == 0)
+					return;
+				for (size_t c = 0; c < m_channels; c++)
+					m_levels[0].push_back(bin(m_min[c], m_max[c], m_ss[c], m_fill));
+				m_fill = 0;
+				m_min.assign(m_channels, FLT_MAX);
+				m_max.assign(m_channels, -FLT_MAX);
+				m_ss.assign(m_channels, 0.0);
+			}
+			//
+			template <typename S>
+			void append(const InterleavedView<const S>& ip)
+			{
+				const size_t block = size_t(1) << m_shift;
+				const size_t channels = std::min(ip.channels, m_channels);
+				size_t done = 0;
+				while (done < ip.frames)
+				{
+					const size_t n = std::min(block - m_fill, ip.frames - done);
+					extents(ip.frame(done), n, channels, ip.stride, m_min.data(), m_max.data(), m_ss.data());
+					m_fill += n;
+					m_frames += n;
+					done += n;
+					if (m_fill == block)
+						emit();
+				}
+			}
+
+		public:
+			//
+			PeakIndex() {}
+
+			// start building. frames, if known, reserves level 0
+			void begin(size_t channels, size_t sampleRate, size_t shift = 8, size_t frames = 0)
+			{
+				m_channels = channels;
+				m_sampleRate = sampleRate;
+				m_shift = std::max<size_t>(1, std::min<size_t>(shift, 24));
+				m_frames = 0;
+				m_levels.assign(1, std::vector<Bin>());
+				m_levels[0].reserve(((frames >> m_shift) + 1) * channels);
+				m_fill = 0;
+				m_min.assign(m_channels, FLT_MAX);
+				m_max.assign(m_channels, -FLT_MAX);
+				m_ss.assign(m_channels, 0.0);
+			}
+			// feed frames in order, any number at a time
+			void add(const SampleView& ip) { append(ip); }
+			void add(const InterleavedView<const short>& ip) { append(ip); }
+			// close the last block and build the levels above
+			void finish()
+			{
+				if (m_levels.empty())
+					return;
+				emit();
+				while (m_levels.back().size() > m_channels)
+				{
+					const std::vector<Bin>& lower = m_levels.back();
+					const size_t blocks = lower.size() / m_channels;
+					std::vector<Bin> upper;
+					upper.reserve(((blocks + 1) / 2) * m_channels);
+					for (size_t b = 0; b < blocks; b += 2)
+					{
+						for (size_t c = 0; c < m_channels; c++)
+						{
+							Bin a = lower[(b * m_channels) + c];
+							if (b + 1 < blocks)
+							{
+								const Bin& o = lower[((b + 1) * m_channels) + c];
+								const double r = std::sqrt(((double(a.rms) * a.rms) + (double(o.rms) * o.rms)) / 2.0);
+								a.min = std::min(a.min, o.min);
+								a.max = std::max(a.max, o.max);
+								a.rms = uint16_t(std::min(65535.0, r + 0.5));
+							}
+							upper.push_back(a);
+						}
+					}
+					m_levels.push_back(std::move(upper));
+				}
+				m_min.clear();
+				m_max.clear();
+				m_ss.clear();
+			}
+
+			// everything in memory, float or compact
+			void build(const SampleData& sd, size_t shift = 8)
+			{
+				const size_t channels = std::max<size_t>(sd.channels, 1);
+				if (sd.compact())
+				{
+					begin(channels, sd.sampleRate, shift, sd.pcm.size() / channels);
+					add(InterleavedView<const short>(sd.begin_pcm(), sd.pcm.size() / channels, channels));
+				}
+				else
+				{
+					begin(channels, sd.sampleRate, shift, sd.buffer.size() / channels);
+					add(view(sd));
+				}
+				finish();
+			}
+
+			// streams from the reader's position to the end, a chunk at a time
+			bool build(wav::Reader& rdr, size_t shift = 8, size_t chunkFrames = 64 * 1024)
+			{
+				if (!rdr.isOpen())
+					return false;
+				begin(rdr.channels(), rdr.sampleRate(), shift, rdr.frames() - rdr.position());
+				std::vector<short> pcm(chunkFrames * rdr.channels());
+				for (;;)
+				{
+					const size_t n = rdr.read(pcm.data(), chunkFrames);
+					if (n == 0)
+						break;
+					add(InterleavedView<const short>(pcm.data(), n, rdr.channels()));
+				}
+				finish();
+				return true;
+			}
+
+			// 'pixels' peaks of one channel over frames [first, first + frames).
+			// closer in than level 0, neighbouring pixels repeat a block and
+			// the caller may want the samples instead. returns pixels filled
+			size_t query(size_t channel, size_t first, size_t frames, Peak* out, size_t pixels) const
+			{
+				if (m_levels.empty() || channel >= m_channels || pixels == 0 || first >= m_frames)
+					return 0;
+				frames = std::min(frames, m_frames - first);
+				// coarsest level with blocks no wider than a pixel
+				const double spp = double(frames) / double(pixels);
+				size_t level = 0;
+				while (level + 1 < m_levels.size() && double(size_t(1) << (m_shift + level + 1)) <= spp)
+					level++;
+				const std::vector<Bin>& bins = m_levels[level];
+				const size_t shift = m_shift + level;
+				const size_t blocks = bins.size() / m_channels;
+				if (blocks == 0)
+					return 0;
+				for (size_t px = 0; px < pixels; px++)
+				{
+					const size_t start = first + size_t((double(px) * frames) / pixels);
+					const size_t end = std::max(start + 1, first + size_t((double(px + 1) * frames) / pixels));
+					const size_t b0 = std::min(start >> shift, blocks - 1);
+					const size_t b1 = std::min((end - 1) >> shift, blocks - 1);
+					int16_t mn = 32767;
+					int16_t mx = -32768;
+					double ss = 0;
+					// at most 3 bins
+					for (size_t b = b0; b <= b1; b++)
+					{
+						const Bin& bn = bins[(b * m_channels) + channel];
+						mn = std::min(mn, bn.min);
+						mx = std::max(mx, bn.max);
+						ss += double(bn.rms) * bn.rms;
+					}
+					out[px].min = u::convert(mn);
+					out[px].max = u::convert(mx);
+					out[px].rms = float(std::sqrt(ss / double(b1 - b0 + 1)) / 65535.0);
+				}
+				return pixels;
+			}
+			//
+			std::vector<Peak> query(size_t channel, size_t first, size_t frames, size_t pixels) const
+			{
+				std::vector<Peak> ret(pixels);
+				ret.resize(query(channel, first, frames, ret.data(), pixels));
+				return ret;
+			}
+			// whole file
+			std::vector<Peak> query(size_t channel, size_t pixels) const
+			{
+				return query(channel, 0, m_frames, pixels);
+			}
+
+			// write the sidecar. source names the file it describes, so load()
+			// can tell when it has changed
+			bool save(const std::string& path, const std::string& source = std::string()) const
+			{
+				if (m_levels.empty())
+					return false;
+				Header h{ tag, version, uint32_t(m_channels), uint32_t(m_sampleRate), uint32_t(m_shift), uint32_t(m_levels.size()), m_frames, 0, 0 };
+				if (!source.empty() && !sidecar::stamp(source, h.sourceSize, h.sourceTime))
+					return false;
+				FILE* fp = sidecar::open(path, "wb");
+				if (!fp)
+					return false;
+				u::FILECloser fc(fp);
+				bool ok = (fwrite(&h, sizeof(h), 1, fp) == 1);
+				for (size_t l = 0; ok && l < m_levels.size(); l++)
+				{
+					const uint64_t count = m_levels[l].size();
+					ok = (fwrite(&count, sizeof(count), 1, fp) == 1);
+					ok = ok && (count == 0 || fwrite(m_levels[l].data(), sizeof(Bin), size_t(count), fp) == count);
+				}
+				return ok;
+			}
+
+			// read a sidecar. false if it is damaged or, given the source,
+			// out of date
+			bool load(const std::string& path, const std::string& source = std::string())
+			{
+				FILE* fp = sidecar::open(path, "rb");
+				if (!fp)
+					return false;
+				u::FILECloser fc(fp);
+				Header h;
+				if (fread(&h, sizeof(h), 1, fp) != 1 || h.tag != tag || h.version != version ||
+					h.channels == 0 || h.levels == 0 || h.levels > 64 || h.shift == 0 || h.shift > 24)
+					return false;
+				if (!source.empty())
+				{
+					uint64_t size = 0;
+					int64_t time = 0;
+					if (!sidecar::stamp(source, size, time) || size != h.sourceSize || time != h.sourceTime)
+						return false;
+				}
+				std::vector<std::vector<Bin>> levels(h.levels);
+				// level 0 has a block per 2^shift frames, each level above
+				// half as many, rounded up
+				uint64_t blocks = (h.frames + ((uint64_t(1) << h.shift) - 1)) >> h.shift;
+				for (size_t l = 0; l < levels.size(); l++)
+				{
+					if (l)
+						blocks = (blocks + 1) / 2;
+					uint64_t count = 0;
+					if (fread(&count, sizeof(count), 1, fp) != 1 || count != blocks * h.channels)
+						return false;
+					levels[l].resize(size_t(count));
+					if (count && fread(levels[l].data(), sizeof(Bin), size_t(count), fp) != count)
+						return false;
+				}
+				m_channels = h.channels;
+				m_sampleRate = h.sampleRate;
+				m_shift = h.shift;
+				m_frames = size_t(h.frames);
+				m_levels = std::move(levels);
+				return true;
+			}
+
+			// index for a 16 bit wav file. from the sidecar when it is up to
+			// date, else built by streaming the file and saved. the sidecar
+			// defaults to the file name plus ".pkx"
+			bool cache(const std::string& filename, const std::string& sidecar = std::string(), size_t shift = 8)
+			{
+				const std::string path = (sidecar.empty() ? filename + ".pkx" : sidecar);
+				if (load(path, filename))
+					return true;
+				wav::Reader rdr;
+				if (!rdr.open(filename) || !build(rdr, shift))
+					return false;
+				rdr.close();
+				// a read-only location is not an error, just slower next time
+				save(path, filename);
+				return true;
+			}
+
+			//
+			size_t channels() const { return m_channels; }
+			size_t sampleRate() const { return m_sampleRate; }
+			size_t frames() const { return m_frames; }
+			size_t levels() const { return m_levels.size(); }
+			// frames per bin at a level
+			size_t block(size_t level) const { return size_t(1) << (m_shift + level); }
+			// raw bins, channel interleaved
+			const std::vector<Bin>& bins(size_t level) const { return m_levels[level]; }
+			// bytes held
+			size_t memory() const
+			{
+				size_t ret = 0;
+				for (const auto& l : m_levels)
+					ret += l.capacity() * sizeof(Bin);
+				return ret;
+			}
+		};
+	}
+}
@@ -0,0 +1,248 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <audio/audio_u.h>
+#include <audio/ring_buffer.h>
+#include <audio/rtaudio.hpp>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// presents a constant 'block' frames to the wrapped processor
+		// whatever the host delivers. while every host buffer is a whole
+		// number of blocks the processor runs in place on slices of the
+		// host buffers and nothing is added. the first buffer that does not
+		// divide evenly switches to FIFO mode for the rest of the stream:
+		// whole blocks are still taken straight from the host input, only
+		// the partial block at each boundary is copied, and output is
+		// delayed by one block (a single block of silence is inserted at the
+		// switch). latency() reports which applies.
+		template <typename T = float>
+		class ReblockProcessor : public IDuplexProcessor<T>
+		{
+		public:
+			//
+			using base_t = IDuplexProcessor<T>;
+			using typename base_t::ipview_t;
+			using typename base_t::opview_t;
+			using typename base_t::ipplanar_t;
+			using typename base_t::opplanar_t;
+
+		private:
+			//
+			base_t* m_processor = nullptr;
+			size_t m_block = 0;
+			unsigned int m_ipChannels = 0;
+			unsigned int m_opChannels = 0;
+			// host buffers larger than this are handled in pieces
+			size_t m_maxFrames = 0;
+			// set on the first uneven host buffer. written by the audio
+			// thread, read by latency() from any thread
+			std::atomic<bool> m_buffered{ false };
+			// partial input block. interleaved, or channel after channel
+			// for planar streams
+			std::vector<T> m_ip;
+			std::vector<T*> m_ipChannel;
+			size_t m_ipCount = 0;
+			// one block of output on its way to the queue, same layout
+			std::vector<T> m_op;
+			std::vector<T*> m_opChannel;
+			// processed output waiting for the host
+			InterleavedRing<T> m_queue;
+			// return value of the last inner call
+			int m_ret = 0;
+			// the partial input and output blocks in the host's layout
+			opview_t pending(const ipview_t&) { return opview_t(m_ip.data(), m_block, m_ipChannels); }
+			opplanar_t pending(const ipplanar_t&) { return opplanar_t(m_ipChannel.data(), m_block, m_ipChannels); }
+			opview_t output(const ipview_t&) { return opview_t(m_op.data(), m_block, m_opChannels); }
+			opplanar_t output(const ipplanar_t&) { return opplanar_t(m_opChannel.data(), m_block, m_opChannels); }
+			//
+			static void copy(const ipview_t& ip, const opview_t& op) { InterleavedRing<T>::copy(ip, op); }
+			static void copy(const ipplanar_t& ip, const opplanar_t& op) { PlanarRing<T>::copy(ip, op); }
+			// one block through the wrapped processor, output queued
+			template <typename IV>
+			void run(const IV& ip, unsigned int sampleRate, double streamTime, RtAudioStreamStatus status)
+			{
+				const auto op = output(ip);
+				std::fill(m_op.begin(), m_op.end(), T(0));
+				m_ret = m_processor->process(ip, op, sampleRate, streamTime, status);
+				m_queue.write(IV(op));
+			}
+			// FIFO mode for up to m_maxFrames
+			template <typename IV, typename OV>
+			void buffered(const IV& ip, const OV& op, unsigned int sampleRate, double streamTime, RtAudioStreamStatus status)
+			{
+				const double frameTime = (sampleRate ? 1.0 / sampleRate : 0.0);
+				size_t pos = 0;
+				// complete the partial block first
+				if (m_ipCount)
+				{
+					const size_t n = std::min(m_block - m_ipCount, ip.frames);
+					copy(ip.slice(0, n), pending(ip).slice(m_ipCount, n));
+					m_ipCount += n;
+					pos = n;
+					if (m_ipCount == m_block)
+					{
+						run(IV(pending(ip)), sampleRate, streamTime - (double(m_block - n) * frameTime), status);
+						m_ipCount = 0;
+					}
+				}
+				// whole blocks straight from the host buffer
+				for (; pos + m_block <= ip.frames; pos += m_block)
+					run(ip.slice(pos, m_block), sampleRate, streamTime + (double(pos) * frameTime), status);
+				// keep the tail for next time
+				if (pos < ip.frames)
+				{
+					const size_t n = ip.frames - pos;
+					copy(ip.slice(pos, n), pending(ip).slice(m_ipCount, n));
+					m_ipCount += n;
+				}
+				// always at least a block ahead so this cannot come up short
+				const size_t got = m_queue.read(op);
+				for (size_t f = got; f < op.frames; f++)
+					for (size_t c = 0; c < op.channels; c++)
+						op.at(f, c) = T(0);
+			}
+			// either layout, the views decide which inner entry point runs
+			template <typename IV, typename OV>
+			int reblock(const IV& ip, const OV& op, unsigned int sampleRate, double streamTime, RtAudioStreamStatus status)
+			{
+				const size_t frames = std::min(ip.frames, op.frames);
+				bool queued = m_buffered.load(std::memory_order_relaxed);
+				if (!queued && (frames % m_block) != 0)
+				{
+					// one block of silence buys the FIFO its headroom
+					queued = true;
+					m_buffered.store(true, std::memory_order_relaxed);
+					std::fill(m_op.begin(), m_op.end(), T(0));
+					m_queue.write(ipview_t(m_op.data(), m_block, m_opChannels));
+				}
+				const double frameTime = (sampleRate ? 1.0 / sampleRate : 0.0);
+				for (size_t pos = 0; pos < frames; )
+				{
+					if (!queued)
+					{
+						// in place, no copies
+						m_ret = m_processor->process(ip.slice(pos, m_block), op.slice(pos, m_block), sampleRate, streamTime + (double(pos) * frameTime), status);
+						pos += m_block;
+						continue;
+					}
+					const size_t n = std::min(frames - pos, m_maxFrames);
+					buffered(ip.slice(pos, n), op.slice(pos, n), sampleRate, streamTime + (double(pos) * frameTime), status);
+					pos += n;
+				}
+				return m_ret;
+			}
+			// non-copyable
+			ReblockProcessor(const ReblockProcessor&) = delete;
+			ReblockProcessor& operator=(const ReblockProcessor&) = delete;
+
+		public:
+			// maxFrames bounds the work per piece, larger host buffers are
+			// split. nothing is allocated after construction
+			ReblockProcessor(base_t* processor,
+								size_t block,
+								unsigned int ipChannels,
+								unsigned int opChannels,
+								size_t maxFrames = 8192) :
+				m_processor(processor),
+				m_block(std::max<size_t>(block, 1)),
+				m_ipChannels(ipChannels),
+				m_opChannels(opChannels),
+				m_maxFrames(std::max(maxFrames, m_block)),
+				m_ip(m_block * ipChannels, T(0)),
+				m_op(m_block * opChannels, T(0)),
+				m_queue((m_block * 2) + m_maxFrames, opChannels)
+			{
+				for (size_t c = 0; c < ipChannels; c++)
+					m_ipChannel.push_back(m_ip.data() + (c * m_block));
+				for (size_t c = 0; c < opChannels; c++)
+					m_opChannel.push_back(m_op.data() + (c * m_block));
+			}
+			//
+			size_t block() const { return m_block; }
+			// frames of delay added, 0 until a host buffer did not divide evenly
+			size_t latency() const { return (m_buffered.load(std::memory_order_relaxed) ? m_block : 0); }
+			//
+			virtual void prefault()
+			{
+				m_processor->prefault();
+			}
+			// the wrapped processor sees a block at a time
+			virtual void reserve(size_t, unsigned int ipChannels, unsigned int opChannels)
+			{
+				m_processor->reserve(m_block, ipChannels, opChannels);
+			}
+			//
+			virtual int process(const ipview_t& ip,
+								const opview_t& op,
+								unsigned int sampleRate,
+								double streamTime,
+								RtAudioStreamStatus status)
+			{
+				return reblock(ip, op, sampleRate, streamTime, status);
+			}
+			//
+			virtual int process(T* outputBuffer,
+								T* inputBuffer,
+								unsigned int samples,
+								unsigned int ipChannels,
+								unsigned int opChannels,
+								unsigned int sampleRate,
+								double streamTime,
+								RtAudioStreamStatus status)
+			{
+				return process(ipview_t(inputBuffer, samples, ipChannels),
+								opview_t(outputBuffer, samples, opChannels),
+								sampleRate,
+								streamTime,
+								status);
+			}
+			// planar streams reblock on the channel pointers, the wrapped
+			// processor sees its own planar entry point
+			virtual int process(const ipplanar_t& ip,
+								const opplanar_t& op,
+								unsigned int sampleRate,
+								double streamTime,
+								RtAudioStreamStatus status)
+			{
+				return reblock(ip, op, sampleRate, streamTime, status);
+			}
+		};
+	}
+}
@@ -0,0 +1,346 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <audio/audio_u.h>
+#include <audio/ring_buffer.h>
+#include <audio/wav_wri.h>
+#include <audio/rtaudio.hpp>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// records the duplex stream to a 16 bit WAV file. the callback only
+		// copies into a preallocated ring, a background thread drains it to
+		// disk in large writes. with pre-roll the most recent audio is kept
+		// while idle and lands at the start of the next recording.
+		// optionally wraps another processor and records its output.
+		class RecorderProcessor : public IDuplexProcessor<float>
+		{
+		public:
+			//
+			using base_t = IDuplexProcessor<float>;
+			//
+			enum Source { eInput, eOutput };
+			//
+			struct Options
+			{
+				// what the callback sees before or after the wrapped processor
+				Source source = eInput;
+				// how long the disk can stall before frames are dropped
+				double ringSeconds = 2.0;
+				// kept while idle, written ahead of each recording
+				double preroll = 0.0;
+				// size of each disk write
+				size_t writeBytes = 256 * 1024;
+			};
+			//
+			struct Stats
+			{
+				// written to the current or last file
+				size_t frames = 0;
+				// lost because the ring was full
+				uint64_t dropped = 0;
+				// most frames the ring has held
+				size_t highWater = 0;
+				// a disk write failed
+				bool failed = false;
+			};
+
+		private:
+			//
+			base_t* m_processor = nullptr;
+			unsigned int m_channels = 0;
+			unsigned int m_sampleRate = 0;
+			Options m_options;
+			//
+			InterleavedRing<float> m_ring;
+			// audio thread copies while either is set
+			std::atomic<bool> m_capture{ false };
+			std::atomic<bool> m_recording{ false };
+			std::atomic<uint64_t> m_dropped{ 0 };
+			std::atomic<size_t> m_highWater{ 0 };
+			std::atomic<size_t> m_frames{ 0 };
+			std::atomic<bool> m_failed{ false };
+			// worker only
+			wav::Writer m_writer;
+			std::vector<float> m_history;
+			size_t m_historyPos = 0;
+			size_t m_historyFrames = 0;
+			// control <-> worker
+			std::mutex m_mutex;
+			std::condition_variable m_cv;
+			std::string m_filename;
+			bool m_start = false;
+			bool m_stop = false;
+			bool m_exit = false;
+			std::thread m_thread;
+			// keep the newest pre-roll frames, oldest are overwritten
+			void remember(const InterleavedView<float>& v)
+			{
+				const size_t capacity = m_history.size() / m_channels;
+				for (size_t f = 0; f < v.frames; f++)
+				{
+					std::copy(v.frame(f), v.frame(f) + m_channels, m_history.begin() + (m_historyPos * m_channels));
+					m_historyPos = (m_historyPos + 1) % capacity;
+				}
+				m_historyFrames = std::min(capacity, m_historyFrames + v.frames);
+			}
+			// pre-roll in time order
+			void replay()
+			{
+				// nothing kept, or no pre-roll at all
+				if (m_historyFrames == 0)
+					return;
+				const size_t capacity = m_history.size() / m_channels;
+				const size_t first = (m_historyPos + capacity - m_historyFrames) % capacity;
+				const size_t n = std::min(m_historyFrames, capacity - first);
+				m_writer.write(SampleView(m_history.data() + (first * m_channels), n, m_channels));
+				m_writer.write(SampleView(m_history.data(), m_historyFrames - n, m_channels));
+				m_historyFrames = 0;
+			}
+			// everything the callback has queued goes to disk or pre-roll
+			void drain()
+			{
+				const size_t readable = m_ring.readable();
+				if (readable > m_highWater.load(std::memory_order_relaxed))
+					m_highWater.store(readable, std::memory_order_relaxed);
+				RingRegion<InterleavedView<float>> r = m_ring.read_region(readable);
+				if (m_writer.isOpen())
+				{
+					m_writer.write(r.first);
+					m_writer.write(r.second);
+					m_frames.store(m_writer.frames(), std::memory_order_relaxed);
+					if (!m_writer.ok())
+						m_failed.store(true, std::memory_order_relaxed);
+				}
+				else if (!m_history.empty())
+				{
+					remember(r.first);
+					remember(r.second);
+				}
+				m_ring.commit_read(r.frames());
+			}
+			//
+			void work()
+			{
+				// wake often enough to keep the ring under a quarter full
+				const double period = std::min(0.02, m_options.ringSeconds / 4);
+				const auto wait = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::duration<double>(period));
+				std::unique_lock<std::mutex> lock(m_mutex);
+				for (;;)
+				{
+					m_cv.wait_for(lock, wait, [this]() { return m_start || m_stop || m_exit; });
+					if (m_start)
+					{
+						m_start = false;
+						// audio already queued belongs before the new file
+						drain();
+						m_failed.store(false, std::memory_order_relaxed);
+						m_frames.store(0, std::memory_order_relaxed);
+						if (m_writer.open(m_filename, m_channels, m_sampleRate, m_options.writeBytes))
+							replay();
+						else
+							m_failed.store(true, std::memory_order_relaxed);
+						m_cv.notify_all();
+					}
+					drain();
+					if (m_stop || m_exit)
+					{
+						m_stop = false;
+						if (m_writer.isOpen() && !m_writer.close())
+							m_failed.store(true, std::memory_order_relaxed);
+						m_cv.notify_all();
+					}
+					if (m_exit)
+						break;
+				}
+			}
+			// non-copyable
+			RecorderProcessor(const RecorderProcessor&) = delete;
+			RecorderProcessor& operator=(const RecorderProcessor&) = delete;
+
+		public:
+			// channels and sampleRate describe the file. wrap 'processor' to
+			// record what it produces
+			RecorderProcessor(unsigned int channels,
+								unsigned int sampleRate,
+								const Options& options,
+								base_t* processor = nullptr) :
+				m_processor(processor),
+				m_channels(std::max(channels, 1u)),
+				m_sampleRate(sampleRate),
+				m_options(options),
+				m_ring(size_t(options.ringSeconds * sampleRate) + 1, std::max(channels, 1u)),
+				m_history(size_t(options.preroll * sampleRate) * std::max(channels, 1u), 0.0f)
+			{
+				m_capture.store(!m_history.empty());
+				m_thread = std::thread([this]() { work(); });
+			}
+			// default options
+			RecorderProcessor(unsigned int channels, unsigned int sampleRate, base_t* processor = nullptr) :
+				RecorderProcessor(channels, sampleRate, Options(), processor)
+			{
+			}
+			//
+			virtual ~RecorderProcessor()
+			{
+				m_recording.store(false);
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_exit = true;
+				}
+				m_cv.notify_all();
+				if (m_thread.joinable())
+					m_thread.join();
+			}
+			// control thread. begin a new file, pre-roll first
+			bool Start(const std::string& filename)
+			{
+				Stop();
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_filename = filename;
+				m_start = true;
+				m_recording.store(true);
+				m_capture.store(true);
+				m_cv.notify_all();
+				m_cv.wait(lock, [this]() { return !m_start; });
+				if (!m_writer.isOpen())
+				{
+					m_recording.store(false);
+					m_capture.store(!m_history.empty());
+					return false;
+				}
+				return true;
+			}
+			// control thread. flush what has been captured and close the file
+			bool Stop()
+			{
+				if (!m_recording.exchange(false))
+					return false;
+				m_capture.store(!m_history.empty());
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_stop = true;
+				m_cv.notify_all();
+				m_cv.wait(lock, [this]() { return !m_stop; });
+				return !m_failed.load();
+			}
+			//
+			bool isRecording() const { return m_recording.load(); }
+			// any thread
+			Stats stats() const
+			{
+				Stats ret;
+				ret.frames = m_frames.load(std::memory_order_relaxed);
+				ret.dropped = m_dropped.load(std::memory_order_relaxed);
+				ret.highWater = m_highWater.load(std::memory_order_relaxed);
+				ret.failed = m_failed.load(std::memory_order_relaxed);
+				return ret;
+			}
+			//
+			virtual void prefault()
+			{
+				if (m_processor)
+					m_processor->prefault();
+			}
+			// the wrapped processor sees the planar calls
+			virtual void reserve(size_t frames, unsigned int ipChannels, unsigned int opChannels)
+			{
+				if (m_processor)
+					m_processor->reserve(frames, ipChannels, opChannels);
+			}
+			// audio thread. no allocation, no locks, no system calls
+			virtual int process(const ipview_t& ip,
+								const opview_t& op,
+								unsigned int sampleRate,
+								double streamTime,
+								RtAudioStreamStatus status)
+			{
+				int ret = 0;
+				if (m_processor)
+					ret = m_processor->process(ip, op, sampleRate, streamTime, status);
+				if (m_capture.load(std::memory_order_relaxed))
+				{
+					const ipview_t v = (m_options.source == eInput ? ip : ipview_t(op));
+					const size_t written = m_ring.write(v);
+					if (written < v.frames)
+						m_dropped.fetch_add(v.frames - written, std::memory_order_relaxed);
+				}
+				return ret;
+			}
+			//
+			virtual int process(float* outputBuffer,
+								float* inputBuffer,
+								unsigned int samples,
+								unsigned int ipChannels,
+								unsigned int opChannels,
+								unsigned int sampleRate,
+								double streamTime,
+								RtAudioStreamStatus status)
+			{
+				return process(ipview_t(inputBuffer, samples, ipChannels),
+								opview_t(outputBuffer, samples, opChannels),
+								sampleRate,
+								streamTime,
+								status);
+			}
+			// non-interleaved streams are interleaved once, into the ring
+			virtual int process(const ipplanar_t& ip,
+								const opplanar_t& op,
+								unsigned int sampleRate,
+								double streamTime,
+								RtAudioStreamStatus status)
+			{
+				int ret = 0;
+				if (m_processor)
+					ret = m_processor->process(ip, op, sampleRate, streamTime, status);
+				if (m_capture.load(std::memory_order_relaxed))
+				{
+					const ipplanar_t v = (m_options.source == eInput ? ip : ipplanar_t(op));
+					const size_t written = m_ring.write(v);
+					if (written < v.frames)
+						m_dropped.fetch_add(v.frames - written, std::memory_order_relaxed);
+				}
+				return ret;
+			}
+		};
+	}
+}
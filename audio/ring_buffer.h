@@ -0,0 +1,416 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <audio/audio_u.h>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// keep producer and consumer state on separate lines
+		static const size_t cache_line = 64;
+
+		//-----------------------------------------------------------------------------
+		// single producer/single consumer positions for a ring of 'capacity'
+		// frames. counters run freely and are masked to get offsets. each side
+		// caches the other's counter so the shared line is only read when the
+		// cached value cannot satisfy a request. wait-free both sides.
+		class SpscIndex
+		{
+		public:
+			// up to 2 contiguous pieces, the second wraps to offset 0
+			struct Region
+			{
+				size_t offset[2] = { 0, 0 };
+				size_t count[2] = { 0, 0 };
+				//
+				size_t size() const { return count[0] + count[1]; }
+			};
+
+		private:
+			// producer owned
+			std::atomic<size_t> m_write{ 0 };
+			size_t m_readCache = 0;
+			char m_pad0[cache_line - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+			// consumer owned
+			std::atomic<size_t> m_read{ 0 };
+			size_t m_writeCache = 0;
+			char m_pad1[cache_line - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+			// read-only after construction
+			size_t m_capacity = 0;
+			size_t m_mask = 0;
+			//
+			Region region(size_t start, size_t n) const
+			{
+				Region ret;
+				ret.offset[0] = start & m_mask;
+				ret.count[0] = std::min(n, m_capacity - ret.offset[0]);
+				ret.count[1] = n - ret.count[0];
+				return ret;
+			}
+
+		public:
+			//
+			explicit SpscIndex(size_t capacity) :
+				m_capacity(pow2(std::max<size_t>(capacity, 1))),
+				m_mask(m_capacity - 1)
+			{
+			}
+			//
+			size_t capacity() const { return m_capacity; }
+
+			// producer side
+			size_t writable()
+			{
+				m_readCache = m_read.load(std::memory_order_acquire);
+				return m_capacity - (m_write.load(std::memory_order_relaxed) - m_readCache);
+			}
+			//
+			Region write_region(size_t want)
+			{
+				size_t free = m_capacity - (m_write.load(std::memory_order_relaxed) - m_readCache);
+				if (free < want)
+					free = writable();
+				return region(m_write.load(std::memory_order_relaxed), std::min(want, free));
+			}
+			//
+			void commit_write(size_t n)
+			{
+				m_write.store(m_write.load(std::memory_order_relaxed) + n, std::memory_order_release);
+			}
+
+			// consumer side
+			size_t readable()
+			{
+				m_writeCache = m_write.load(std::memory_order_acquire);
+				return m_writeCache - m_read.load(std::memory_order_relaxed);
+			}
+			//
+			Region read_region(size_t want)
+			{
+				size_t used = m_writeCache - m_read.load(std::memory_order_relaxed);
+				if (used < want)
+					used = readable();
+				return region(m_read.load(std::memory_order_relaxed), std::min(want, used));
+			}
+			//
+			void commit_read(size_t n)
+			{
+				m_read.store(m_read.load(std::memory_order_relaxed) + n, std::memory_order_release);
+			}
+
+			// either side, approximate
+			size_t size() const
+			{
+				return m_write.load(std::memory_order_acquire) - m_read.load(std::memory_order_acquire);
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		// a write or read region as 2 views straight into ring memory
+		template <typename V>
+		struct RingRegion
+		{
+			V first;
+			V second;
+			//
+			size_t frames() const { return first.frames + second.frames; }
+		};
+
+		//-----------------------------------------------------------------------------
+		// SPSC ring of interleaved frames
+		template <typename T = float>
+		class InterleavedRing
+		{
+			SpscIndex m_index;
+			size_t m_channels = 0;
+			std::vector<T> m_buffer;
+			//
+			RingRegion<InterleavedView<T>> map(const SpscIndex::Region& r)
+			{
+				RingRegion<InterleavedView<T>> ret;
+				ret.first = InterleavedView<T>(m_buffer.data() + (r.offset[0] * m_channels), r.count[0], m_channels);
+				ret.second = InterleavedView<T>(m_buffer.data() + (r.offset[1] * m_channels), r.count[1], m_channels);
+				return ret;
+			}
+			// non-copyable
+			InterleavedRing(const InterleavedRing&) = delete;
+			InterleavedRing& operator=(const InterleavedRing&) = delete;
+		public:
+			// capacity in frames, rounded up to a power of 2
+			InterleavedRing(size_t frames, size_t channels) :
+				m_index(frames),
+				m_channels(channels),
+				m_buffer(m_index.capacity() * channels, T(0))
+			{
+			}
+			//
+			size_t channels() const { return m_channels; }
+			size_t capacity() const { return m_index.capacity(); }
+			size_t size() const { return m_index.size(); }
+			size_t writable() { return m_index.writable(); }
+			size_t readable() { return m_index.readable(); }
+			// zero copy producer. fill the regions then commit
+			RingRegion<InterleavedView<T>> write_region(size_t frames) { return map(m_index.write_region(frames)); }
+			void commit_write(size_t frames) { m_index.commit_write(frames); }
+			// zero copy consumer. drain the regions then commit
+			RingRegion<InterleavedView<T>> read_region(size_t frames) { return map(m_index.read_region(frames)); }
+			void commit_read(size_t frames) { m_index.commit_read(frames); }
+			// copy in as many frames as fit. returns frames written
+			size_t write(const InterleavedView<const T>& ip)
+			{
+				RingRegion<InterleavedView<T>> r = write_region(ip.frames);
+				copy(ip.slice(0, r.first.frames), r.first);
+				copy(ip.slice(r.first.frames, r.second.frames), r.second);
+				commit_write(r.frames());
+				return r.frames();
+			}
+			// planar producer, e.g. straight from a non-interleaved callback
+			size_t write(const PlanarView<const T>& ip)
+			{
+				RingRegion<InterleavedView<T>> r = write_region(ip.frames);
+				interleave(ip.slice(0, r.first.frames), r.first);
+				interleave(ip.slice(r.first.frames, r.second.frames), r.second);
+				commit_write(r.frames());
+				return r.frames();
+			}
+			// copy out as many frames as are available. returns frames read
+			size_t read(const InterleavedView<T>& op)
+			{
+				RingRegion<InterleavedView<T>> r = read_region(op.frames);
+				copy(r.first, op.slice(0, r.first.frames));
+				copy(r.second, op.slice(r.first.frames, r.second.frames));
+				commit_read(r.frames());
+				return r.frames();
+			}
+			// planar consumer
+			size_t read(const PlanarView<T>& op)
+			{
+				RingRegion<InterleavedView<T>> r = read_region(op.frames);
+				deinterleave(InterleavedView<const T>(r.first), op.slice(0, r.first.frames));
+				deinterleave(InterleavedView<const T>(r.second), op.slice(r.first.frames, r.second.frames));
+				commit_read(r.frames());
+				return r.frames();
+			}
+			// strided copy, memcpy when both sides are packed
+			static void copy(const InterleavedView<const T>& ip, const InterleavedView<T>& op)
+			{
+				const size_t channels = std::min(ip.channels, op.channels);
+				if (ip.packed() && op.packed() && ip.channels == op.channels)
+				{
+					if (ip.frames)
+						memcpy(op.ptr, ip.ptr, ip.frames * channels * sizeof(T));
+					return;
+				}
+				for (size_t f = 0; f < ip.frames; f++)
+				{
+					const T* ps = ip.frame(f);
+					T* pd = op.frame(f);
+					for (size_t c = 0; c < channels; c++)
+						pd[c] = ps[c];
+				}
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		// SPSC ring of de-interleaved frames. one buffer per channel sharing
+		// a single pair of positions
+		template <typename T = float>
+		class PlanarRing
+		{
+			SpscIndex m_index;
+			std::vector<T> m_buffer;
+			std::vector<T*> m_channels;
+			//
+			RingRegion<PlanarView<T>> map(const SpscIndex::Region& r)
+			{
+				RingRegion<PlanarView<T>> ret;
+				ret.first = PlanarView<T>(m_channels.data(), r.count[0], m_channels.size(), r.offset[0]);
+				ret.second = PlanarView<T>(m_channels.data(), r.count[1], m_channels.size(), r.offset[1]);
+				return ret;
+			}
+			// non-copyable
+			PlanarRing(const PlanarRing&) = delete;
+			PlanarRing& operator=(const PlanarRing&) = delete;
+		public:
+			// capacity in frames, rounded up to a power of 2
+			PlanarRing(size_t frames, size_t channels) :
+				m_index(frames),
+				m_buffer(m_index.capacity() * channels, T(0))
+			{
+				for (size_t c = 0; c < channels; c++)
+					m_channels.push_back(m_buffer.data() + (c * m_index.capacity()));
+			}
+			//
+			size_t channels() const { return m_channels.size(); }
+			size_t capacity() const { return m_index.capacity(); }
+			size_t size() const { return m_index.size(); }
+			size_t writable() { return m_index.writable(); }
+			size_t readable() { return m_index.readable(); }
+			// zero copy producer. fill the regions then commit
+			RingRegion<PlanarView<T>> write_region(size_t frames) { return map(m_index.write_region(frames)); }
+			void commit_write(size_t frames) { m_index.commit_write(frames); }
+			// zero copy consumer. drain the regions then commit
+			RingRegion<PlanarView<T>> read_region(size_t frames) { return map(m_index.read_region(frames)); }
+			void commit_read(size_t frames) { m_index.commit_read(frames); }
+			// copy in as many frames as fit. returns frames written
+			size_t write(const PlanarView<const T>& ip)
+			{
+				RingRegion<PlanarView<T>> r = write_region(ip.frames);
+				copy(ip.slice(0, r.first.frames), r.first);
+				copy(ip.slice(r.first.frames, r.second.frames), r.second);
+				commit_write(r.frames());
+				return r.frames();
+			}
+			// interleaved producer, e.g. straight from the duplex callback
+			size_t write(const InterleavedView<const T>& ip)
+			{
+				RingRegion<PlanarView<T>> r = write_region(ip.frames);
+				deinterleave(ip.slice(0, r.first.frames), r.first);
+				deinterleave(ip.slice(r.first.frames, r.second.frames), r.second);
+				commit_write(r.frames());
+				return r.frames();
+			}
+			// copy out as many frames as are available. returns frames read
+			size_t read(const PlanarView<T>& op)
+			{
+				RingRegion<PlanarView<T>> r = read_region(op.frames);
+				copy(r.first, op.slice(0, r.first.frames));
+				copy(r.second, op.slice(r.first.frames, r.second.frames));
+				commit_read(r.frames());
+				return r.frames();
+			}
+			//
+			static void copy(const PlanarView<const T>& ip, const PlanarView<T>& op)
+			{
+				const size_t channels = std::min(ip.channels, op.channels);
+				if (ip.frames == 0)
+					return;
+				for (size_t c = 0; c < channels; c++)
+					memcpy(op.channel(c), ip.channel(c), ip.frames * sizeof(T));
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		// bounded multi producer/multi consumer queue of elements. a sequence
+		// number per cell, producers and consumers each claim a slot with a
+		// single CAS. lock-free, use to pass pooled blocks between threads.
+		template <typename T>
+		class MpmcQueue
+		{
+			struct Cell
+			{
+				std::atomic<size_t> sequence;
+				T data;
+			};
+			//
+			std::unique_ptr<Cell[]> m_cells;
+			size_t m_mask = 0;
+			char m_pad0[cache_line - sizeof(std::unique_ptr<Cell[]>) - sizeof(size_t)];
+			std::atomic<size_t> m_enqueue{ 0 };
+			char m_pad1[cache_line - sizeof(std::atomic<size_t>)];
+			std::atomic<size_t> m_dequeue{ 0 };
+			char m_pad2[cache_line - sizeof(std::atomic<size_t>)];
+			// non-copyable
+			MpmcQueue(const MpmcQueue&) = delete;
+			MpmcQueue& operator=(const MpmcQueue&) = delete;
+		public:
+			// capacity rounded up to a power of 2
+			explicit MpmcQueue(size_t capacity)
+			{
+				size_t size = pow2(std::max<size_t>(capacity, 2));
+				m_cells.reset(new Cell[size]);
+				m_mask = size - 1;
+				for (size_t i = 0; i < size; i++)
+					m_cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+			//
+			size_t capacity() const { return m_mask + 1; }
+			// false if full, arg is untouched
+			bool push(T& arg)
+			{
+				Cell* cell = nullptr;
+				size_t pos = m_enqueue.load(std::memory_order_relaxed);
+				for (;;)
+				{
+					cell = &m_cells[pos & m_mask];
+					size_t seq = cell->sequence.load(std::memory_order_acquire);
+					intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+					if (diff == 0)
+					{
+						if (m_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+							break;
+					}
+					else if (diff < 0)
+						return false;
+					else
+						pos = m_enqueue.load(std::memory_order_relaxed);
+				}
+				cell->data = std::move(arg);
+				cell->sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+			//
+			bool push(T&& arg) { return push(arg); }
+			// false if empty
+			bool pop(T& arg)
+			{
+				Cell* cell = nullptr;
+				size_t pos = m_dequeue.load(std::memory_order_relaxed);
+				for (;;)
+				{
+					cell = &m_cells[pos & m_mask];
+					size_t seq = cell->sequence.load(std::memory_order_acquire);
+					intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+					if (diff == 0)
+					{
+						if (m_dequeue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+							break;
+					}
+					else if (diff < 0)
+						return false;
+					else
+						pos = m_dequeue.load(std::memory_order_relaxed);
+				}
+				arg = std::move(cell->data);
+				cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+				return true;
+			}
+		};
+	}
+}
@@ -0,0 +1,246 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <g40/nv2_util.h>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// per-callback timing for a duplex stream. the audio thread is the
+		// only writer and never waits. readers take a consistent snapshot
+		// via a sequence lock, retrying if they overlap a callback.
+		class CallbackMetrics
+		{
+		public:
+			// histogram of callback duration as a fraction of the buffer
+			// period. 10% per bucket, the last collects everything >= 190%
+			static const size_t buckets = 20;
+			//
+			using clock_t = std::chrono::steady_clock;
+
+			//
+			struct Snapshot
+			{
+				uint64_t callbacks = 0;
+				uint64_t frames = 0;
+				uint64_t ipOverflows = 0;
+				uint64_t opUnderflows = 0;
+				// callbacks that took longer than the buffer period
+				uint64_t overruns = 0;
+				// DSP load, percentage of the buffer period
+				double load = 0;
+				double meanLoad = 0;
+				double peakLoad = 0;
+				// sum over every callback. the mean between two snapshots
+				// is the difference over the callbacks between them
+				double totalLoad = 0;
+				// seconds
+				double maxDuration = 0;
+				// streamTime delta against the expected buffer period
+				double meanJitter = 0;
+				double maxJitter = 0;
+				//
+				uint64_t histogram[buckets] = { 0 };
+
+				// single line for logs
+				std::string str() const
+				{
+					std::string ret = nv2::sprintf("callbacks %llu frames %llu overflow %llu underflow %llu overrun %llu load %.1f%% mean %.1f%% peak %.1f%% max %.3fms jitter %.3fms/%.3fms [",
+						(unsigned long long)callbacks,
+						(unsigned long long)frames,
+						(unsigned long long)ipOverflows,
+						(unsigned long long)opUnderflows,
+						(unsigned long long)overruns,
+						load, meanLoad, peakLoad,
+						maxDuration * 1000.0,
+						meanJitter * 1000.0, maxJitter * 1000.0);
+					for (size_t b = 0; b < buckets; b++)
+						ret += nv2::sprintf(b ? " %llu" : "%llu", (unsigned long long)histogram[b]);
+					ret += "]";
+					return ret;
+				}
+			};
+
+		private:
+			//
+			using u64 = std::atomic<uint64_t>;
+			using f64 = std::atomic<double>;
+			// odd while the audio thread is updating
+			std::atomic<uint32_t> m_seq{ 0 };
+			//
+			u64 m_callbacks{ 0 };
+			u64 m_frames{ 0 };
+			u64 m_ipOverflows{ 0 };
+			u64 m_opUnderflows{ 0 };
+			u64 m_overruns{ 0 };
+			f64 m_load{ 0 };
+			f64 m_meanLoad{ 0 };
+			f64 m_peakLoad{ 0 };
+			f64 m_totalLoad{ 0 };
+			f64 m_maxDuration{ 0 };
+			f64 m_meanJitter{ 0 };
+			f64 m_maxJitter{ 0 };
+			u64 m_histogram[buckets];
+			// audio thread only
+			double m_lastStreamTime = -1;
+			// requested by a reader, honoured by the writer
+			std::atomic<bool> m_reset{ false };
+			// smoothing for the running means
+			static constexpr double alpha = 0.05;
+			// single writer, so no read-modify-write needed
+			template <typename A, typename V>
+			static void put(A& a, V v) { a.store(v, std::memory_order_relaxed); }
+			template <typename A>
+			static auto get(const A& a) -> decltype(a.load()) { return a.load(std::memory_order_relaxed); }
+			//
+			void clear()
+			{
+				put(m_callbacks, 0); put(m_frames, 0);
+				put(m_ipOverflows, 0); put(m_opUnderflows, 0); put(m_overruns, 0);
+				put(m_load, 0.0); put(m_meanLoad, 0.0); put(m_peakLoad, 0.0); put(m_totalLoad, 0.0);
+				put(m_maxDuration, 0.0); put(m_meanJitter, 0.0); put(m_maxJitter, 0.0);
+				for (size_t b = 0; b < buckets; b++)
+					put(m_histogram[b], 0);
+				m_lastStreamTime = -1;
+			}
+			// non-copyable
+			CallbackMetrics(const CallbackMetrics&) = delete;
+			CallbackMetrics& operator=(const CallbackMetrics&) = delete;
+
+		public:
+			//
+			CallbackMetrics()
+			{
+				for (size_t b = 0; b < buckets; b++)
+					m_histogram[b].store(0);
+			}
+
+			// audio thread. call on entry to the callback
+			clock_t::time_point begin() const
+			{
+				return clock_t::now();
+			}
+
+			// audio thread. call on exit from the callback
+			void end(clock_t::time_point start,
+				unsigned int samples,
+				unsigned int sampleRate,
+				double streamTime,
+				bool ipOverflow,
+				bool opUnderflow)
+			{
+				const double duration = std::chrono::duration<double>(clock_t::now() - start).count();
+				const double period = (sampleRate ? double(samples) / sampleRate : 0.0);
+				const double load = (period > 0 ? 100.0 * duration / period : 0.0);
+				// enter
+				const uint32_t seq = m_seq.load(std::memory_order_relaxed);
+				m_seq.store(seq + 1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+				if (m_reset.exchange(false, std::memory_order_acquire))
+					clear();
+				//
+				const uint64_t callbacks = get(m_callbacks) + 1;
+				put(m_callbacks, callbacks);
+				put(m_frames, get(m_frames) + samples);
+				if (ipOverflow)
+					put(m_ipOverflows, get(m_ipOverflows) + 1);
+				if (opUnderflow)
+					put(m_opUnderflows, get(m_opUnderflows) + 1);
+				if (load > 100.0)
+					put(m_overruns, get(m_overruns) + 1);
+				//
+				put(m_load, load);
+				put(m_meanLoad, callbacks == 1 ? load : get(m_meanLoad) + alpha * (load - get(m_meanLoad)));
+				put(m_peakLoad, std::max(get(m_peakLoad), load));
+				put(m_totalLoad, get(m_totalLoad) + load);
+				put(m_maxDuration, std::max(get(m_maxDuration), duration));
+				//
+				size_t bucket = std::min(size_t(load / 10.0), buckets - 1);
+				put(m_histogram[bucket], get(m_histogram[bucket]) + 1);
+				// compare the stream clock advance with the nominal period
+				if (m_lastStreamTime >= 0)
+				{
+					double jitter = std::fabs((streamTime - m_lastStreamTime) - period);
+					put(m_meanJitter, get(m_meanJitter) + alpha * (jitter - get(m_meanJitter)));
+					put(m_maxJitter, std::max(get(m_maxJitter), jitter));
+				}
+				m_lastStreamTime = streamTime;
+				// leave
+				m_seq.store(seq + 2, std::memory_order_release);
+			}
+
+			// any thread. consistent copy of the counters
+			Snapshot snapshot() const
+			{
+				Snapshot ret;
+				for (;;)
+				{
+					const uint32_t seq = m_seq.load(std::memory_order_acquire);
+					if (seq & 1)
+						continue;
+					ret.callbacks = get(m_callbacks);
+					ret.frames = get(m_frames);
+					ret.ipOverflows = get(m_ipOverflows);
+					ret.opUnderflows = get(m_opUnderflows);
+					ret.overruns = get(m_overruns);
+					ret.load = get(m_load);
+					ret.meanLoad = get(m_meanLoad);
+					ret.peakLoad = get(m_peakLoad);
+					ret.totalLoad = get(m_totalLoad);
+					ret.maxDuration = get(m_maxDuration);
+					ret.meanJitter = get(m_meanJitter);
+					ret.maxJitter = get(m_maxJitter);
+					for (size_t b = 0; b < buckets; b++)
+						ret.histogram[b] = get(m_histogram[b]);
+					std::atomic_thread_fence(std::memory_order_acquire);
+					if (m_seq.load(std::memory_order_relaxed) == seq)
+						break;
+				}
+				return ret;
+			}
+
+			// any thread. cleared at the start of the next callback
+			void reset()
+			{
+				m_reset.store(true, std::memory_order_release);
+			}
+		};
+	}
+}
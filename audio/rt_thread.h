@@ -0,0 +1,267 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <g40/nv2_util.h>
+#include <audio/audio_u.h>
+
+#if !_IS_WINDOWS
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// opt-in set up for a real-time audio thread. everything is off
+		// until asked for, e.g. denormals = true, prefaultStack = 64K
+		struct RtHardening
+		{
+			// flush-to-zero/denormals-are-zero on the callback thread
+			bool denormals = false;
+			// lock all current and future pages (process wide), see
+			// rt::lockMemory() for windows
+			bool lockMemory = false;
+			// touch this much stack on the callback thread
+			size_t prefaultStack = 0;
+			// SCHED_FIFO or time critical priority on the callback thread
+			bool realtime = false;
+			// 0 picks the policy maximum
+			int priority = 0;
+			// pin the callback thread, empty leaves it alone
+			std::vector<int> cpus;
+			//
+			bool enabled() const
+			{
+				return denormals || lockMemory || prefaultStack || realtime || !cpus.empty();
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		// which steps were tried and which succeeded. published by whichever
+		// thread applies them, readable from any thread
+		class RtHardeningReport
+		{
+		public:
+			//
+			enum Step : uint32_t
+			{
+				eDenormals = 0x01,
+				eLockMemory = 0x02,
+				ePrefault = 0x04,
+				eRealtime = 0x08,
+				eAffinity = 0x10,
+			};
+		private:
+			std::atomic<uint32_t> m_tried{ 0 };
+			std::atomic<uint32_t> m_ok{ 0 };
+		public:
+			//
+			void set(Step step, bool ok)
+			{
+				m_tried.fetch_or(step, std::memory_order_relaxed);
+				if (ok)
+					m_ok.fetch_or(step, std::memory_order_release);
+				else
+					m_ok.fetch_and(~uint32_t(step), std::memory_order_release);
+			}
+			//
+			void clear()
+			{
+				m_tried.store(0);
+				m_ok.store(0);
+			}
+			//
+			bool tried(Step step) const { return (m_tried.load(std::memory_order_acquire) & step) != 0; }
+			bool ok(Step step) const { return (m_ok.load(std::memory_order_acquire) & step) != 0; }
+			// e.g. "denormals:ok lock:failed realtime:failed"
+			std::string str() const
+			{
+				static const struct { Step step; const char* name; } names[] = {
+					{ eDenormals, "denormals" },
+					{ eLockMemory, "lock" },
+					{ ePrefault, "prefault" },
+					{ eRealtime, "realtime" },
+					{ eAffinity, "affinity" },
+				};
+				std::string ret;
+				for (const auto& n : names)
+				{
+					if (!tried(n.step))
+						continue;
+					if (!ret.empty())
+						ret += " ";
+					ret += n.name;
+					ret += (ok(n.step) ? ":ok" : ":failed");
+				}
+				return ret;
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		// individual steps. thread specific ones act on the calling thread
+		namespace rt
+		{
+			//-----------------------------------------------------------------------------
+			// FTZ/DAZ so decaying IIR tails do not fall into slow denormal maths
+			inline bool disableDenormals()
+			{
+#if _RT_X86
+				// FTZ bit 15, DAZ bit 6
+				_mm_setcsr(_mm_getcsr() | 0x8040);
+				return true;
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+				// FZ bit 24
+				uint64_t fpcr = 0;
+				asm volatile("mrs %0, fpcr" : "=r"(fpcr));
+				asm volatile("msr fpcr, %0" : : "r"(fpcr | (uint64_t(1) << 24)));
+				return true;
+#else
+				return false;
+#endif
+			}
+
+			//-----------------------------------------------------------------------------
+			// avoid page faults on cold buffers. windows has no process wide
+			// lock: the working set minimum is raised by 'headroom' instead,
+			// which keeps touched pages resident and gives lock() below the
+			// quota it needs
+			inline bool lockMemory(size_t headroom = 64 * 1024 * 1024)
+			{
+#if _IS_WINDOWS
+				SIZE_T mn = 0;
+				SIZE_T mx = 0;
+				HANDLE process = GetCurrentProcess();
+				if (!GetProcessWorkingSetSize(process, &mn, &mx))
+					return false;
+				mn += headroom;
+				return (SetProcessWorkingSetSize(process, mn, (std::max)(mx, mn + headroom)) != 0);
+#else
+				(void)headroom;
+				return (mlockall(MCL_CURRENT | MCL_FUTURE) == 0);
+#endif
+			}
+
+			//-----------------------------------------------------------------------------
+			// lock one range, e.g. a processor's buffers from its prefault()
+			inline bool lock(const void* p, size_t bytes)
+			{
+				if (!p || !bytes)
+					return false;
+#if _IS_WINDOWS
+				return (VirtualLock(const_cast<void*>(p), bytes) != 0);
+#else
+				return (mlock(p, bytes) == 0);
+#endif
+			}
+
+			//-----------------------------------------------------------------------------
+			// touch one byte per page so the memory is resident
+			inline void prefault(void* p, size_t bytes)
+			{
+				const size_t page = 4096;
+				volatile char* pc = reinterpret_cast<volatile char*>(p);
+				for (size_t b = 0; b < bytes; b += page)
+					pc[b] = pc[b];
+			}
+
+			//-----------------------------------------------------------------------------
+			// grow the calling thread's stack ahead of time
+			inline bool prefaultStack(size_t bytes)
+			{
+				const size_t chunk = 4096;
+				volatile char buffer[chunk];
+				for (size_t b = 0; b < chunk; b += 64)
+					buffer[b] = 0;
+				// read back after the call so the frame cannot be reused
+				bool ok = (bytes > chunk ? prefaultStack(bytes - chunk) : true);
+				return ok && (buffer[0] == 0);
+			}
+
+			//-----------------------------------------------------------------------------
+			// SCHED_FIFO, usually needs rtprio limits or CAP_SYS_NICE
+			inline bool setRealtime(int priority = 0)
+			{
+#if _IS_WINDOWS
+				(void)priority;
+				return (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0);
+#else
+				sched_param sp;
+				sp.sched_priority = (priority > 0 ? priority : sched_get_priority_max(SCHED_FIFO));
+				return (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0);
+#endif
+			}
+
+			//-----------------------------------------------------------------------------
+			// pin the calling thread to a set of CPUs
+			inline bool setAffinity(const std::vector<int>& cpus)
+			{
+				if (cpus.empty())
+					return false;
+#if _IS_WINDOWS
+				DWORD_PTR mask = 0;
+				for (int cpu : cpus)
+					mask |= (DWORD_PTR(1) << cpu);
+				return (SetThreadAffinityMask(GetCurrentThread(), mask) != 0);
+#elif defined(__linux__)
+				cpu_set_t set;
+				CPU_ZERO(&set);
+				for (int cpu : cpus)
+					CPU_SET(cpu, &set);
+				return (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0);
+#else
+				return false;
+#endif
+			}
+
+			//-----------------------------------------------------------------------------
+			// steps that must run on the audio thread itself
+			inline void hardenThread(const RtHardening& opts, RtHardeningReport& report)
+			{
+				if (opts.denormals)
+					report.set(RtHardeningReport::eDenormals, disableDenormals());
+				if (opts.prefaultStack)
+					report.set(RtHardeningReport::ePrefault, prefaultStack(opts.prefaultStack));
+				if (opts.realtime)
+					report.set(RtHardeningReport::eRealtime, setRealtime(opts.priority));
+				if (!opts.cpus.empty())
+					report.set(RtHardeningReport::eAffinity, setAffinity(opts.cpus));
+			}
+		}
+	}
+}
@@ -1,333 +1,996 @@
-/*
-
-	The PACH project: https://github.com/g40/pach
-
-	Copyright (c) 2011-2023, Jerry Evans
-
-	Redistribution and use in source and binary forms, with or without
-	modification, are permitted provided that the following conditions are
-	met:
-
-	1. Redistributions of source code must retain the above copyright notice,
-	this list of conditions and the following disclaimer.
-
-	2. Redistributions in binary form must reproduce the above copyright
-	notice, this list of conditions and the following disclaimer in the
-	documentation and/or other materials provided with the distribution.
-
-	3. The name of the author may not be used to endorse or promote products
-	derived from this software without specific prior written permission.
-
-	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
-	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
-	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
-	DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
-	INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
-	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
-	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
-	HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
-	STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
-	ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
-	POSSIBILITY OF SUCH DAMAGE.
-
-*/
-
-#pragma once
-
-#include <rtaudio/RtAudio.h>
-
-//-----------------------------------------------------------------------------
-class RtAudioEnumerator
-{
-public:
-	//
-	typedef unsigned int DeviceId;
-	typedef std::map<DeviceId, RtAudio::DeviceInfo>::iterator iterator;
-	typedef std::map<DeviceId, RtAudio::DeviceInfo>::const_iterator const_iterator;
-
-private:
-	//
-	std::map<DeviceId, RtAudio::DeviceInfo> m_mapper;
-	std::map<std::string, DeviceId> m_idMapper;
-	//
-	DeviceId m_ipId { 0 };
-	DeviceId m_opId{ 0 };
-public:
-	//
-	RtAudioEnumerator() {}
-	// add options ... ?
-	size_t enumerate()
-	{
-		//
-		m_mapper.clear();
-		m_idMapper.clear();
-		//
-		RtAudio rta;
-		//
-		std::vector<DeviceId> deviceIds = rta.getDeviceIds();
-		if (deviceIds.empty()) {
-			return 0;
-		}
-		//
-		for (auto id : deviceIds)
-		{
-			RtAudio::DeviceInfo di = rta.getDeviceInfo(id);
-			m_mapper[id] = di;
-			// reverse map name to ID
-			m_idMapper[di.name] = id;
-			// std::cout << c::sprintf("0x%x %s %d %d %s %s\n", id, di.name.c_str(), di.inputChannels, di.outputChannels, di.isDefaultInput ? "true" : "false", di.isDefaultOutput ? "true" : "false");
-			if (di.isDefaultInput)
-				m_ipId = id;
-			if (di.isDefaultOutput)
-				m_opId = id;
-		}
-		//
-		return m_mapper.size();
-	}
-	//
-	iterator find(DeviceId key) { return m_mapper.find(key); }
-	iterator begin() { return m_mapper.begin(); }
-	iterator end() { return m_mapper.end(); }
-	const_iterator find(DeviceId key) const { return m_mapper.find(key); }
-	const_iterator begin() const { return m_mapper.begin();  }
-	const_iterator end() const { return m_mapper.end(); }
-	DeviceId ipId() const { return m_ipId; }
-	DeviceId opId() const { return m_opId; }
-	DeviceId key(const std::string& name)
-	{
-		DeviceId id = 0xFFFF;
-		std::map<std::string, DeviceId>::iterator it = m_idMapper.find(name);
-		if (it != m_idMapper.end())
-			id = it->second;
-		return id;
-	}
-};
-
-//-----------------------------------------------------------------------------
-// abstract interface to allow for composition
-// of various processing units
-template <typename T = float>
-class IDuplexProcessor
-{
-public:
-	virtual ~IDuplexProcessor() {}
-	virtual int process(T* inputBuffer,
-						T* outputBuffer, 	
-						unsigned int samples,
-						unsigned int ipChannels,
-						unsigned int opChannels,
-						unsigned int sampleRate,
-						double streamTime, 
-						RtAudioStreamStatus status) = 0;
-};
-
-//-----------------------------------------------------------------------------
-// duplex device wrapper
-template <typename T = float>
-class RtAudioDuplex
-{
-	//
-	bool m_mute = false;
-	//
-	IDuplexProcessor<T>* m_processor { nullptr };
-	//
-	std::unique_ptr<RtAudio> m_device;
-	//
-	unsigned int m_ipChannels { 0 };
-	unsigned int m_opChannels{ 0 };
-	// track time ?
-	double m_time { 0 };
-	//
-	T m_level = T(1);
-	// private QRT callback
-	static int callback(void* outputBuffer, void* inputBuffer, unsigned int samples,
-		double streamTime, RtAudioStreamStatus status, void* userdata)
-	{
-		RtAudioDuplex* instance = reinterpret_cast<RtAudioDuplex*>(userdata);
-		return instance->process(reinterpret_cast<T*>(outputBuffer),
-							reinterpret_cast<T*>(inputBuffer),
-							samples,
-							instance->ipChannels(),
-							instance->opChannels(),
-							instance->sampleRate(),
-							streamTime,
-							status);
-	}
-	// non-copyable
-	RtAudioDuplex(const RtAudioDuplex&) = delete;
-	RtAudioDuplex& operator=(const RtAudioDuplex&) = delete;
-public:
-	//
-	RtAudioDuplex() {}
-	//
-	virtual ~RtAudioDuplex() { Close(); }
-	// open a duplex device with the specified parameters
-	bool Open(	RtAudioEnumerator::DeviceId ipId, 
-				RtAudioEnumerator::DeviceId opId,
-				IDuplexProcessor<T>* processor = nullptr,
-				int ipChannels = 2,
-				int opChannels = 2,
-				int sampleRate = 44100, unsigned int samples = 512) 
-	{ 
-		if (m_device)
-			return false; 
-		//
-		m_ipChannels = m_opChannels = 0;
-		m_processor = nullptr;
-		//
-		m_device = std::unique_ptr<RtAudio>(new RtAudio());
-		//
-		RtAudio::StreamParameters ipParams;
-		ipParams.deviceId = ipId;
-		ipParams.nChannels = ipChannels;
-		ipParams.firstChannel = 0;
-		RtAudio::StreamParameters opParams;
-		opParams.deviceId = opId;
-		opParams.nChannels = opChannels;
-		opParams.firstChannel = 0;
-		// we always have interleaved data ... [L0][R0][L1][R1][...][...][Ln][Rn]
-		RtAudio::StreamOptions options;
-		// options.flags |= RTAUDIO_NONINTERLEAVED
-		//
-		void* userdata = reinterpret_cast<void*>(this);
-		if (m_device->openStream(&opParams, &ipParams, RTAUDIO_FLOAT32, sampleRate, &samples, &callback, userdata, &options))
-			return false;
-		//
-		if (m_device->isStreamOpen() == false)
-			return false;			
-		//
-		m_ipChannels = ipChannels;
-		m_opChannels = opChannels;
-		m_processor = processor;
-		//
-		return true;
-	}
-
-	// close and clean up
-	bool Close()
-	{
-		//
-		Stop();
-		//
-		m_device = nullptr;
-		//
-		return true;
-	}
-
-	// start streaming
-	bool Start() 
-	{ 
-		if (!m_device)
-			return false;
-		if (m_device->startStream())
-			return false;
-		return true;
-	}
-
-	// stop streaming
-	bool Stop() 
-	{ 
-		if (!m_device)
-			return false;
-		if (m_device->isStreamRunning())
-			m_device->stopStream();
-		return true;
-	}
-
-	// close and clean up
-	bool Mute(bool arg)
-	{
-		//
-		m_mute = arg;
-		//
-		m_device = nullptr;
-		//
-		return true;
-	}
-	//
-	bool isRunning() const
-	{
-		return (m_device && m_device->isStreamRunning());
-	}
-	//
-	unsigned int sampleRate() const
-	{
-		if (!m_device)
-			return 0;
-		return m_device->getStreamSampleRate();
-	}
-	//
-	unsigned int ipChannels() const
-	{
-		return m_ipChannels;
-	}
-	//
-	unsigned int opChannels() const
-	{
-		return m_opChannels;
-	}
-	//
-	virtual 
-	int process(T* outputBuffer, 
-		T* inputBuffer, 
-		unsigned int samples,
-		unsigned int ipChannels,
-		unsigned int opChannels,
-		unsigned int sampleRate,
-		double streamTime, RtAudioStreamStatus status)
-	{
-		//
-		int ret = 0;
-		// Since the number of input and output channels is equal, we can do
-		// a simple buffer copy operation here.
-		if (status)
-		{
-			// Stream over/underflow detected.
-		}
-		//
-		if (m_mute)
-		{
-			// canonical copy for now
-			T* ps = inputBuffer;
-			T* pd = outputBuffer;
-			T* pe = ps + (samples * ipChannels);
-			// T* pe = ps + (samples);
-			for (T* pc = ps; pc < pe; pc++, pd++)
-			{
-				*pd = 0.0f;
-			}
-		}
-		else
-		{
-			if (m_processor)
-			{
-				ret = m_processor->process(
-					outputBuffer,
-					inputBuffer,
-					samples,
-					ipChannels,
-					opChannels,
-					sampleRate,
-					streamTime,
-					status);
-			}
-
-			// mix in the incoming audio - settings.
-			if (true)
-			{
-				// canonical copy for now
-				T* ps = inputBuffer;
-				T* pd = outputBuffer;
-				T* pe = ps + (samples * ipChannels);
-				// T* pe = ps + (samples);
-				for (T* pc = ps; pc < pe; pc++, pd++)
-				{
-					*pd += (*pc * m_level);
-					*pd /= 2.0f;
-				}
-			}
-		}
-		return ret;
-	}
-};
-
+/*
+
+	The PACH project: https://github.com/g40/pach
+
+	Copyright (c) 2011-2023, Jerry Evans
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are
+	met:
+
+	1. Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+	3. The name of the author may not be used to endorse or promote products
+	derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+	INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+	STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+	ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <rtaudio/RtAudio.h>
+#include <audio/audio_u.h>
+#include <audio/rt_metrics.h>
+#include <audio/rt_thread.h>
+#include <audio/ring_buffer.h>
+#include <audio/mix_matrix.h>
+
+//-----------------------------------------------------------------------------
+// device list cache. probing can take seconds on systems with many
+// devices, so it can run on a background thread that keeps its own RtAudio
+// instance and only asks for info on devices it has not seen before. the
+// accessors answer from the cache and never probe. results from the
+// background are adopted by poll(), wait() or enumerate(), so iterators
+// stay valid in between.
+class RtAudioEnumerator
+{
+public:
+	//
+	typedef unsigned int DeviceId;
+	typedef std::map<DeviceId, RtAudio::DeviceInfo>::iterator iterator;
+	typedef std::map<DeviceId, RtAudio::DeviceInfo>::const_iterator const_iterator;
+	// called on the background thread when the device list changes
+	typedef std::function<void(const std::vector<DeviceId>& added, const std::vector<DeviceId>& removed)> Listener;
+
+private:
+	// one complete probe
+	struct Snapshot
+	{
+		std::map<DeviceId, RtAudio::DeviceInfo> devices;
+		std::map<std::string, DeviceId> names;
+		DeviceId ipId = 0;
+		DeviceId opId = 0;
+	};
+	//
+	std::map<DeviceId, RtAudio::DeviceInfo> m_mapper;
+	std::map<std::string, DeviceId> m_idMapper;
+	//
+	DeviceId m_ipId { 0 };
+	DeviceId m_opId{ 0 };
+	// background refresh
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::shared_ptr<Snapshot> m_staged;
+	uint64_t m_version = 0;
+	uint64_t m_adopted = 0;
+	bool m_exit = false;
+	bool m_rescan = false;
+	std::thread m_thread;
+	Listener m_listener;
+	// only ask for info on ids missing from 'previous'. the defaults are
+	// read every time, they can move without the device list changing
+	static void probe(RtAudio& rta, const Snapshot* previous, Snapshot& next,
+						std::vector<DeviceId>& added, std::vector<DeviceId>& removed)
+	{
+		std::vector<DeviceId> deviceIds = rta.getDeviceIds();
+		next.ipId = rta.getDefaultInputDevice();
+		next.opId = rta.getDefaultOutputDevice();
+		for (auto id : deviceIds)
+		{
+			std::map<DeviceId, RtAudio::DeviceInfo>::const_iterator it;
+			if (previous && (it = previous->devices.find(id)) != previous->devices.end())
+			{
+				next.devices[id] = it->second;
+			}
+			else
+			{
+				next.devices[id] = rta.getDeviceInfo(id);
+				added.push_back(id);
+			}
+			RtAudio::DeviceInfo& di = next.devices[id];
+			// cached flags may be stale
+			di.isDefaultInput = (id == next.ipId);
+			di.isDefaultOutput = (id == next.opId);
+			// reverse map name to ID
+			next.names[di.name] = id;
+		}
+		if (previous)
+		{
+			for (const auto& d : previous->devices)
+				if (next.devices.find(d.first) == next.devices.end())
+					removed.push_back(d.first);
+		}
+	}
+	// foreground copy of the latest background probe
+	bool adopt()
+	{
+		std::shared_ptr<Snapshot> staged;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_version == m_adopted)
+				return false;
+			m_adopted = m_version;
+			staged = m_staged;
+		}
+		m_mapper = staged->devices;
+		m_idMapper = staged->names;
+		m_ipId = staged->ipId;
+		m_opId = staged->opId;
+		return true;
+	}
+	// background thread. first probe at once, then every 'interval'
+	void refresh(std::chrono::milliseconds interval)
+	{
+		RtAudio rta;
+		std::shared_ptr<Snapshot> current;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (!m_exit)
+		{
+			m_rescan = false;
+			lock.unlock();
+			std::shared_ptr<Snapshot> next = std::make_shared<Snapshot>();
+			std::vector<DeviceId> added;
+			std::vector<DeviceId> removed;
+			probe(rta, current.get(), *next, added, removed);
+			const bool changed = (!current || !added.empty() || !removed.empty() ||
+									next->ipId != current->ipId || next->opId != current->opId);
+			lock.lock();
+			if (changed)
+			{
+				current = next;
+				m_staged = next;
+				m_version++;
+				m_cv.notify_all();
+				if (m_listener)
+				{
+					Listener listener = m_listener;
+					lock.unlock();
+					listener(added, removed);
+					lock.lock();
+				}
+			}
+			if (interval.count() <= 0)
+				break;
+			m_cv.wait_for(lock, interval, [this]() { return m_exit || m_rescan; });
+		}
+		// wake anyone in wait() even if nothing was found
+		if (!m_version)
+		{
+			m_staged = std::make_shared<Snapshot>();
+			m_version++;
+		}
+		m_cv.notify_all();
+	}
+	// non-copyable
+	RtAudioEnumerator(const RtAudioEnumerator&) = delete;
+	RtAudioEnumerator& operator=(const RtAudioEnumerator&) = delete;
+public:
+	//
+	RtAudioEnumerator() {}
+	//
+	~RtAudioEnumerator() { stop(); }
+	// probe on the calling thread. with a background refresh running this
+	// waits for its first result instead
+	size_t enumerate()
+	{
+		if (m_thread.joinable())
+			return wait();
+		//
+		RtAudio rta;
+		Snapshot next;
+		std::vector<DeviceId> added;
+		std::vector<DeviceId> removed;
+		probe(rta, nullptr, next, added, removed);
+		m_mapper.swap(next.devices);
+		m_idMapper.swap(next.names);
+		m_ipId = next.ipId;
+		m_opId = next.opId;
+		//
+		return m_mapper.size();
+	}
+	// probe in the background and return at once. interval > 0 keeps
+	// re-probing to pick up devices being added or removed. listener is
+	// optional and runs on the background thread
+	void enumerateAsync(std::chrono::milliseconds interval = std::chrono::milliseconds(0), Listener listener = nullptr)
+	{
+		stop();
+		{
+			// wait() must not return the previous run's result
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exit = false;
+			m_version = 0;
+			m_adopted = 0;
+			m_staged.reset();
+		}
+		m_listener = listener;
+		m_thread = std::thread([this, interval]() { refresh(interval); });
+	}
+	// ask a periodic background refresh to probe now, e.g. on an OS
+	// device change notification
+	void rescan()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_rescan = true;
+		m_cv.notify_all();
+	}
+	// adopt the latest background result. true if the cache changed
+	bool poll()
+	{
+		return adopt();
+	}
+	// block until the background has probed at least once
+	size_t wait()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cv.wait(lock, [this]() { return m_version != 0; });
+		}
+		adopt();
+		return m_mapper.size();
+	}
+	// false until the first background probe has been adopted
+	bool ready() const
+	{
+		return (m_adopted != 0 || !m_mapper.empty());
+	}
+	//
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exit = true;
+		}
+		m_cv.notify_all();
+		if (m_thread.joinable())
+			m_thread.join();
+	}
+	//
+	iterator find(DeviceId key) { return m_mapper.find(key); }
+	iterator begin() { return m_mapper.begin(); }
+	iterator end() { return m_mapper.end(); }
+	const_iterator find(DeviceId key) const { return m_mapper.find(key); }
+	const_iterator begin() const { return m_mapper.begin();  }
+	const_iterator end() const { return m_mapper.end(); }
+	size_t size() const { return m_mapper.size(); }
+	DeviceId ipId() const { return m_ipId; }
+	DeviceId opId() const { return m_opId; }
+	DeviceId key(const std::string& name)
+	{
+		DeviceId id = 0xFFFF;
+		std::map<std::string, DeviceId>::iterator it = m_idMapper.find(name);
+		if (it != m_idMapper.end())
+			id = it->second;
+		return id;
+	}
+};
+
+//-----------------------------------------------------------------------------
+// abstract interface to allow for composition
+// of various processing units
+template <typename T = float>
+class IDuplexProcessor
+{
+public:
+	//
+	using ipview_t = nv2::audio::InterleavedView<const T>;
+	using opview_t = nv2::audio::InterleavedView<T>;
+	using ipplanar_t = nv2::audio::PlanarView<const T>;
+	using opplanar_t = nv2::audio::PlanarView<T>;
+private:
+	// only used by the default planar adapter below
+	std::vector<T> m_ipScratch;
+	std::vector<T> m_opScratch;
+public:
+	//
+	virtual ~IDuplexProcessor() {}
+	// called from RtAudioDuplex::Start(), and from Swap() for a processor
+	// installed later, when hardening is enabled. touch any buffers the
+	// callback will use, e.g. with nv2::audio::rt::prefault
+	virtual void prefault() {}
+	// size the planar adapter's scratch for the largest callback. called by
+	// RtAudioDuplex for planar streams before the processor can be reached,
+	// call it first when driving the planar entry point directly. a
+	// wrapper that hands planar calls on forwards this to what it wraps
+	virtual void reserve(size_t frames, unsigned int ipChannels, unsigned int opChannels)
+	{
+		if (m_ipScratch.size() < frames * ipChannels)
+			m_ipScratch.assign(frames * ipChannels, T(0));
+		if (m_opScratch.size() < frames * opChannels)
+			m_opScratch.assign(frames * opChannels, T(0));
+	}
+	// n.b. output first, matching the order RtAudio hands to the callback
+	virtual int process(T* outputBuffer,
+						T* inputBuffer, 	
+						unsigned int samples,
+						unsigned int ipChannels,
+						unsigned int opChannels,
+						unsigned int sampleRate,
+						double streamTime, 
+						RtAudioStreamStatus status) = 0;
+	// view entry point. override to work on slices or strided data without
+	// copying. by default forwards to the raw version above
+	virtual int process(const ipview_t& ip,
+						const opview_t& op,
+						unsigned int sampleRate,
+						double streamTime,
+						RtAudioStreamStatus status)
+	{
+		return process(op.ptr,
+						const_cast<T*>(ip.ptr),
+						(unsigned int)op.frames,
+						(unsigned int)ip.channels,
+						(unsigned int)op.channels,
+						sampleRate,
+						streamTime,
+						status);
+	}
+	// planar entry point, used when RtAudioDuplex is opened non-interleaved.
+	// channel pointers come straight from the RtAudio buffers. the default
+	// interleaves through the scratch sized by reserve() so existing
+	// processors still work, override to avoid both passes. never allocates,
+	// a callback larger than reserved is silenced instead
+	virtual int process(const ipplanar_t& ip,
+						const opplanar_t& op,
+						unsigned int sampleRate,
+						double streamTime,
+						RtAudioStreamStatus status)
+	{
+		if (m_ipScratch.size() < ip.frames * ip.channels ||
+			m_opScratch.size() < op.frames * op.channels)
+		{
+			for (size_t c = 0; c < op.channels; c++)
+				std::fill(op.channel(c), op.channel(c) + op.frames, T(0));
+			return 0;
+		}
+		opview_t ops(m_opScratch.data(), op.frames, op.channels);
+		nv2::audio::interleave(ip, opview_t(m_ipScratch.data(), ip.frames, ip.channels));
+		nv2::audio::interleave(ipplanar_t(op), ops);
+		int ret = process(ipview_t(m_ipScratch.data(), ip.frames, ip.channels),
+							ops,
+							sampleRate,
+							streamTime,
+							status);
+		nv2::audio::deinterleave(ipview_t(ops), op);
+		return ret;
+	}
+};
+
+//-----------------------------------------------------------------------------
+// duplex device wrapper
+template <typename T = float>
+class RtAudioDuplex
+{
+	// published by the control thread, ramped to by the callback
+	std::atomic<bool> m_mute{ false };
+	//
+	IDuplexProcessor<T>* m_processor { nullptr };
+	//
+	std::unique_ptr<RtAudio> m_device;
+	//
+	unsigned int m_ipChannels { 0 };
+	unsigned int m_opChannels{ 0 };
+	// track time ?
+	double m_time { 0 };
+	// input monitor level
+	std::atomic<T> m_level{ T(1) };
+	// per output channel, sized in Configure()
+	std::unique_ptr<std::atomic<T>[]> m_gains;
+	// what the callback applied at the end of the last block. gains
+	// include the 50% blend
+	T m_levelNow = T(1);
+	std::vector<T> m_gainNow;
+	std::vector<T> m_gainStep;
+	// where this block's gain ramps end, exactly
+	std::vector<T> m_gainEnd;
+	// input to output routing. the callback owns m_matrix, Route()
+	// publishes a replacement and keeps its own copy in m_route
+	std::unique_ptr<nv2::audio::MixMatrix<T>> m_matrix;
+	std::atomic<nv2::audio::MixMatrix<T>*> m_pendingMatrix{ nullptr };
+	nv2::audio::MpmcQueue<nv2::audio::MixMatrix<T>*> m_retiredMatrices{ 16 };
+	nv2::audio::MixMatrix<T> m_route;
+	// RTAUDIO_NONINTERLEAVED. processors get per-channel pointers
+	bool m_planar = false;
+	// channel pointer tables for planar mode, sized in Open()
+	std::vector<T*> m_ipPtrs;
+	std::vector<T*> m_opPtrs;
+	// largest callback processors are sized for, planar adapter scratch
+	size_t m_maxFrames = 0;
+	// callback timing, xruns and DSP load
+	nv2::audio::CallbackMetrics m_metrics;
+	// cached from the stream on Open()
+	unsigned int m_sampleRate { 0 };
+	// opt-in real-time thread set up
+	nv2::audio::RtHardening m_hardening;
+	nv2::audio::RtHardeningReport m_report;
+	bool m_harden = false;
+	// audio thread only, reset by Start()
+	bool m_hardened = false;
+	// hot swap. control thread publishes, callback picks up
+	std::atomic<IDuplexProcessor<T>*> m_pending{ nullptr };
+	std::atomic<unsigned int> m_pendingFade{ 0 };
+	// stands in for 'no processor' in m_pending
+	char m_bypass = 0;
+	// outgoing processor while crossfading, audio thread only
+	IDuplexProcessor<T>* m_fadeOut{ nullptr };
+	unsigned int m_fadePos = 0;
+	unsigned int m_fadeLen = 0;
+	// crossfade scratch, sized in Configure()
+	std::vector<T> m_fadeIp;
+	std::vector<T> m_fadeOp;
+	// finished with by the callback, drained by Collect()
+	nv2::audio::MpmcQueue<IDuplexProcessor<T>*> m_retired{ 64 };
+	// processors handed over by Swap(), control thread only
+	std::vector<std::unique_ptr<IDuplexProcessor<T>>> m_owned;
+	// retired processors not owned here, waiting for Collect(released)
+	std::vector<IDuplexProcessor<T>*> m_released;
+	// retirements that found m_retired full
+	std::atomic<uint64_t> m_unreported{ 0 };
+	//
+	IDuplexProcessor<T>* bypass() { return reinterpret_cast<IDuplexProcessor<T>*>(&m_bypass); }
+	// audio thread. cannot block, Collect() must keep up
+	void retire(IDuplexProcessor<T>* processor)
+	{
+		if (processor && !m_retired.push(processor))
+			m_unreported.fetch_add(1, std::memory_order_relaxed);
+	}
+	// control thread. destroy it if owned, else keep it for the caller
+	void release(IDuplexProcessor<T>* processor)
+	{
+		for (auto it = m_owned.begin(); it != m_owned.end(); ++it)
+		{
+			if (it->get() == processor)
+			{
+				m_owned.erase(it);
+				return;
+			}
+		}
+		m_released.push_back(processor);
+	}
+	// run one processor over the callback buffers
+	int run(IDuplexProcessor<T>* processor,
+		T* outputBuffer,
+		T* inputBuffer,
+		unsigned int samples,
+		unsigned int ipChannels,
+		unsigned int opChannels,
+		unsigned int sampleRate,
+		double streamTime, RtAudioStreamStatus status)
+	{
+		if (m_planar)
+		{
+			// RtAudio lays channels end to end
+			for (unsigned int c = 0; c < ipChannels; c++)
+				m_ipPtrs[c] = inputBuffer + (c * samples);
+			for (unsigned int c = 0; c < opChannels; c++)
+				m_opPtrs[c] = outputBuffer + (c * samples);
+			return processor->process(
+				nv2::audio::PlanarView<const T>(m_ipPtrs.data(), samples, ipChannels),
+				nv2::audio::PlanarView<T>(m_opPtrs.data(), samples, opChannels),
+				sampleRate,
+				streamTime,
+				status);
+		}
+		return processor->process(
+			nv2::audio::InterleavedView<const T>(inputBuffer, samples, ipChannels),
+			nv2::audio::InterleavedView<T>(outputBuffer, samples, opChannels),
+			sampleRate,
+			streamTime,
+			status);
+	}
+	// callback boundary. adopt a newly published processor
+	void adopt()
+	{
+		nv2::audio::MixMatrix<T>* matrix = m_pendingMatrix.exchange(nullptr, std::memory_order_acq_rel);
+		if (matrix)
+		{
+			// Route() collects before publishing so there is always room
+			m_retiredMatrices.push(m_matrix.release());
+			m_matrix.reset(matrix);
+		}
+		IDuplexProcessor<T>* next = m_pending.exchange(nullptr, std::memory_order_acq_rel);
+		if (next == nullptr)
+			return;
+		if (next == bypass())
+			next = nullptr;
+		// a fade in progress is cut short
+		retire(m_fadeOut);
+		m_fadeOut = nullptr;
+		m_fadeLen = m_pendingFade.load(std::memory_order_relaxed);
+		m_fadePos = 0;
+		if (m_fadeLen && m_processor && next)
+			m_fadeOut = m_processor;
+		else
+			retire(m_processor);
+		m_processor = next;
+	}
+	// both processors, outgoing into scratch, then a linear crossfade
+	int fade(T* outputBuffer,
+		T* inputBuffer,
+		unsigned int samples,
+		unsigned int ipChannels,
+		unsigned int opChannels,
+		unsigned int sampleRate,
+		double streamTime, RtAudioStreamStatus status)
+	{
+		const size_t ipCount = size_t(samples) * ipChannels;
+		const size_t opCount = size_t(samples) * opChannels;
+		// processors may work in place on the input
+		std::copy(inputBuffer, inputBuffer + ipCount, m_fadeIp.begin());
+		std::copy(outputBuffer, outputBuffer + opCount, m_fadeOp.begin());
+		run(m_fadeOut, m_fadeOp.data(), m_fadeIp.data(), samples, ipChannels, opChannels, sampleRate, streamTime, status);
+		int ret = run(m_processor, outputBuffer, inputBuffer, samples, ipChannels, opChannels, sampleRate, streamTime, status);
+		const T step = T(1) / T(m_fadeLen);
+		for (unsigned int f = 0; f < samples; f++)
+		{
+			const T g = std::min(T(1), T(m_fadePos + f) * step);
+			for (unsigned int c = 0; c < opChannels; c++)
+			{
+				const size_t i = (m_planar ? (size_t(c) * samples) + f : (size_t(f) * opChannels) + c);
+				outputBuffer[i] = (m_fadeOp[i] * (T(1) - g)) + (outputBuffer[i] * g);
+			}
+		}
+		m_fadePos += samples;
+		if (m_fadePos >= m_fadeLen)
+		{
+			retire(m_fadeOut);
+			m_fadeOut = nullptr;
+		}
+		return ret;
+	}
+	// output gain for channel c this block, mute and the 50% blend folded in
+	T target(unsigned int c) const
+	{
+		return (m_mute.load(std::memory_order_relaxed) ? T(0) : m_gains[c].load(std::memory_order_relaxed) * T(0.5));
+	}
+	// nothing to ramp and nothing to hear
+	bool silent(unsigned int opChannels) const
+	{
+		for (unsigned int c = 0; c < opChannels; c++)
+			if (m_gainNow[c] != T(0) || target(c) != T(0))
+				return false;
+		return true;
+	}
+	// route the monitored input into the processor output through the mix
+	// matrix, then apply the output gains with the 50% blend folded in.
+	// level and gains ramp linearly across the block from the previous
+	// values so changes do not click. both ramps are vectorised by
+	// MixMatrix.
+	void mix(T* outputBuffer,
+		T* inputBuffer,
+		unsigned int samples,
+		unsigned int ipChannels,
+		unsigned int opChannels)
+	{
+		const T scale = T(1) / T(std::max(samples, 1u));
+		const T level = m_level.load(std::memory_order_relaxed);
+		const T levelStep = (level - m_levelNow) * scale;
+		for (unsigned int c = 0; c < opChannels; c++)
+		{
+			m_gainEnd[c] = target(c);
+			m_gainStep[c] = (m_gainEnd[c] - m_gainNow[c]) * scale;
+		}
+		if (m_planar)
+		{
+			for (unsigned int c = 0; c < ipChannels; c++)
+				m_ipPtrs[c] = inputBuffer + (size_t(c) * samples);
+			for (unsigned int c = 0; c < opChannels; c++)
+				m_opPtrs[c] = outputBuffer + (size_t(c) * samples);
+			m_matrix->apply(nv2::audio::PlanarView<const T>(m_ipPtrs.data(), samples, ipChannels),
+							nv2::audio::PlanarView<T>(m_opPtrs.data(), samples, opChannels),
+							m_levelNow, levelStep);
+			nv2::audio::MixMatrix<T>::ramp(nv2::audio::PlanarView<T>(m_opPtrs.data(), samples, opChannels),
+											m_gainNow.data(), m_gainStep.data());
+		}
+		else
+		{
+			m_matrix->apply(nv2::audio::InterleavedView<const T>(inputBuffer, samples, ipChannels),
+							nv2::audio::InterleavedView<T>(outputBuffer, samples, opChannels),
+							m_levelNow, levelStep);
+			nv2::audio::MixMatrix<T>::ramp(nv2::audio::InterleavedView<T>(outputBuffer, samples, opChannels),
+											m_gainNow.data(), m_gainStep.data());
+		}
+		// the ends themselves, not now + step * samples, so a ramp to
+		// zero lands on zero and silent() can see it
+		m_levelNow = level;
+		for (unsigned int c = 0; c < opChannels; c++)
+			m_gainNow[c] = m_gainEnd[c];
+	}
+	// processors reached through the planar adapter need scratch before
+	// the callback can see them
+	void reserve(IDuplexProcessor<T>* processor)
+	{
+		if (processor && m_planar)
+			processor->reserve(m_maxFrames, m_ipChannels, m_opChannels);
+	}
+	// non-copyable
+	RtAudioDuplex(const RtAudioDuplex&) = delete;
+	RtAudioDuplex& operator=(const RtAudioDuplex&) = delete;
+protected:
+	// set up the stream state shared by all backends
+	void Configure(IDuplexProcessor<T>* processor,
+					unsigned int ipChannels,
+					unsigned int opChannels,
+					unsigned int sampleRate,
+					bool planar,
+					unsigned int samples = 0)
+	{
+		// anything left over from a previous stream can go
+		retire(m_pending.exchange(nullptr));
+		retire(m_fadeOut);
+		m_fadeOut = nullptr;
+		retire(m_processor);
+		Collect();
+		// room for twice the requested buffer size before fades are skipped
+		m_fadeIp.assign(size_t(samples) * 2 * ipChannels, T(0));
+		m_fadeOp.assign(size_t(samples) * 2 * opChannels, T(0));
+		m_processor = processor;
+		m_ipChannels = ipChannels;
+		m_opChannels = opChannels;
+		m_sampleRate = sampleRate;
+		m_planar = planar;
+		m_maxFrames = size_t(samples) * 2;
+		reserve(processor);
+		m_ipPtrs.assign(ipChannels, nullptr);
+		m_opPtrs.assign(opChannels, nullptr);
+		// unity on every output channel
+		m_gains.reset(new std::atomic<T>[opChannels]);
+		for (unsigned int c = 0; c < opChannels; c++)
+			m_gains[c].store(T(1));
+		m_gainStep.assign(opChannels, T(0));
+		m_gainEnd.assign(opChannels, T(0));
+		m_gainNow.assign(opChannels, m_mute.load() ? T(0) : T(0.5));
+		m_levelNow = m_level.load();
+		// default routing for the channel counts
+		delete m_pendingMatrix.exchange(nullptr);
+		m_route = nv2::audio::MixMatrix<T>::standard(ipChannels, opChannels);
+		m_matrix.reset(new nv2::audio::MixMatrix<T>(m_route));
+	}
+	// process wide hardening, run before the stream starts. the per-thread
+	// steps are applied on the next callback
+	void Prepare()
+	{
+		m_hardened = false;
+		if (!m_harden)
+			return;
+		if (m_hardening.lockMemory)
+			m_report.set(nv2::audio::RtHardeningReport::eLockMemory, nv2::audio::rt::lockMemory());
+		if (m_processor)
+			m_processor->prefault();
+	}
+	// QRT callback. also driven directly by device-less backends
+	static int callback(void* outputBuffer, void* inputBuffer, unsigned int samples,
+		double streamTime, RtAudioStreamStatus status, void* userdata)
+	{
+		RtAudioDuplex* instance = reinterpret_cast<RtAudioDuplex*>(userdata);
+		return instance->process(reinterpret_cast<T*>(outputBuffer),
+							reinterpret_cast<T*>(inputBuffer),
+							samples,
+							instance->ipChannels(),
+							instance->opChannels(),
+							instance->sampleRate(),
+							streamTime,
+							status);
+	}
+public:
+	//
+	RtAudioDuplex() {}
+	//
+	virtual ~RtAudioDuplex()
+	{
+		Close();
+		delete m_pendingMatrix.exchange(nullptr);
+	}
+	// open a duplex device with the specified parameters
+	bool Open(	RtAudioEnumerator::DeviceId ipId, 
+				RtAudioEnumerator::DeviceId opId,
+				IDuplexProcessor<T>* processor = nullptr,
+				int ipChannels = 2,
+				int opChannels = 2,
+				int sampleRate = 44100, unsigned int samples = 512,
+				bool planar = false) 
+	{ 
+		if (m_device)
+			return false; 
+		//
+		Configure(nullptr, 0, 0, 0, planar);
+		//
+		m_device = std::unique_ptr<RtAudio>(new RtAudio());
+		//
+		RtAudio::StreamParameters ipParams;
+		ipParams.deviceId = ipId;
+		ipParams.nChannels = ipChannels;
+		ipParams.firstChannel = 0;
+		RtAudio::StreamParameters opParams;
+		opParams.deviceId = opId;
+		opParams.nChannels = opChannels;
+		opParams.firstChannel = 0;
+		// interleaved data ... [L0][R0][L1][R1][...][...][Ln][Rn]
+		// or planar ... [L0][L1][...][Ln][R0][R1][...][Rn]
+		RtAudio::StreamOptions options;
+		if (m_planar)
+			options.flags |= RTAUDIO_NONINTERLEAVED;
+		//
+		void* userdata = reinterpret_cast<void*>(this);
+		if (m_device->openStream(&opParams, &ipParams, RTAUDIO_FLOAT32, sampleRate, &samples, &callback, userdata, &options))
+			return false;
+		//
+		if (m_device->isStreamOpen() == false)
+			return false;			
+		//
+		Configure(processor, ipChannels, opChannels, m_device->getStreamSampleRate(), planar, samples);
+		//
+		return true;
+	}
+
+	// close and clean up
+	bool Close()
+	{
+		//
+		Stop();
+		//
+		m_device = nullptr;
+		// nothing can be in flight now
+		Collect();
+		//
+		return true;
+	}
+
+	// start streaming
+	bool Start() 
+	{ 
+		if (!m_device)
+			return false;
+		Prepare();
+		if (m_device->startStream())
+			return false;
+		return true;
+	}
+
+	// stop streaming
+	bool Stop() 
+	{ 
+		if (!m_device)
+			return false;
+		if (m_device->isStreamRunning())
+			m_device->stopStream();
+		return true;
+	}
+
+	// any thread. fades the output over the next buffer, the stream
+	// keeps running
+	bool Mute(bool arg)
+	{
+		//
+		m_mute.store(arg, std::memory_order_relaxed);
+		//
+		return true;
+	}
+	//
+	bool isMuted() const
+	{
+		return m_mute.load(std::memory_order_relaxed);
+	}
+	// any thread. input monitor level, ramped over the next buffer
+	void Level(T arg)
+	{
+		m_level.store(arg, std::memory_order_relaxed);
+	}
+	//
+	T level() const
+	{
+		return m_level.load(std::memory_order_relaxed);
+	}
+	// any thread. output gain per channel, ramped over the next buffer
+	bool Gain(unsigned int channel, T arg)
+	{
+		if (channel >= m_opChannels)
+			return false;
+		m_gains[channel].store(arg, std::memory_order_relaxed);
+		return true;
+	}
+	//
+	T gain(unsigned int channel) const
+	{
+		return (channel < m_opChannels ? m_gains[channel].load(std::memory_order_relaxed) : T(0));
+	}
+	//
+	bool isRunning() const
+	{
+		return (m_device && m_device->isStreamRunning());
+	}
+	//
+	unsigned int sampleRate() const
+	{
+		return m_sampleRate;
+	}
+	//
+	unsigned int ipChannels() const
+	{
+		return m_ipChannels;
+	}
+	//
+	unsigned int opChannels() const
+	{
+		return m_opChannels;
+	}
+	//
+	bool isPlanar() const
+	{
+		return m_planar;
+	}
+	// replace the processor without stopping the stream. the callback picks
+	// it up at the next buffer boundary, optionally crossfading from the
+	// current one. ownership passes to this object. the outgoing processor
+	// is destroyed by a later Swap() or Collect(), never on the audio thread.
+	// call from one control thread only.
+	void Swap(std::unique_ptr<IDuplexProcessor<T>> processor, unsigned int crossfadeFrames = 0)
+	{
+		IDuplexProcessor<T>* p = processor.get();
+		if (processor)
+			m_owned.push_back(std::move(processor));
+		Swap(p, crossfadeFrames);
+	}
+	// non-owning version, the caller keeps the processor alive until
+	// Collect(released) hands it back
+	void Swap(IDuplexProcessor<T>* processor, unsigned int crossfadeFrames = 0)
+	{
+		Collect();
+		reserve(processor);
+		// first touch here, not on the audio thread
+		if (m_harden && processor)
+			processor->prefault();
+		m_pendingFade.store(crossfadeFrames, std::memory_order_relaxed);
+		// never seen by the callback if it was replaced before pick up
+		IDuplexProcessor<T>* skipped = m_pending.exchange(processor ? processor : bypass(), std::memory_order_acq_rel);
+		if (skipped && skipped != bypass())
+			release(skipped);
+	}
+	// any thread but one at a time. replace the input to output routing,
+	// picked up at the next buffer. channel counts must match the stream
+	bool Route(const nv2::audio::MixMatrix<T>& matrix)
+	{
+		if (matrix.ipChannels() != m_ipChannels || matrix.opChannels() != m_opChannels)
+			return false;
+		Collect();
+		m_route = matrix;
+		// not yet picked up, so never seen by the callback
+		delete m_pendingMatrix.exchange(new nv2::audio::MixMatrix<T>(matrix), std::memory_order_acq_rel);
+		return true;
+	}
+	// last matrix passed to Route(), or the default
+	const nv2::audio::MixMatrix<T>& route() const
+	{
+		return m_route;
+	}
+	// destroy owned processors and routing the callback has finished with.
+	// processors not owned here are kept until Collect(released). returns
+	// the number of processors retired, owned or not
+	size_t Collect()
+	{
+		nv2::audio::MixMatrix<T>* matrix = nullptr;
+		while (m_retiredMatrices.pop(matrix))
+			delete matrix;
+		size_t ret = 0;
+		IDuplexProcessor<T>* p = nullptr;
+		while (m_retired.pop(p))
+		{
+			release(p);
+			ret++;
+		}
+		return ret;
+	}
+	// as above, then hands every processor not owned here that the
+	// callback has finished with to 'released', once. the caller may
+	// free it from then on
+	size_t Collect(const std::function<void(IDuplexProcessor<T>*)>& released)
+	{
+		const size_t ret = Collect();
+		for (IDuplexProcessor<T>* p : m_released)
+			released(p);
+		m_released.clear();
+		return ret;
+	}
+	// retirements the callback could not queue because Collect() fell
+	// behind. those processors are never reported, owned ones live until
+	// this object goes
+	uint64_t unreported() const
+	{
+		return m_unreported.load(std::memory_order_relaxed);
+	}
+	// opt-in. takes effect from the next Start()
+	void Harden(const nv2::audio::RtHardening& opts)
+	{
+		m_hardening = opts;
+		m_harden = opts.enabled();
+		m_report.clear();
+	}
+	// which hardening steps succeeded
+	const nv2::audio::RtHardeningReport& hardening() const
+	{
+		return m_report;
+	}
+	// safe to call from any thread while the stream runs
+	nv2::audio::CallbackMetrics::Snapshot metrics() const
+	{
+		return m_metrics.snapshot();
+	}
+	//
+	void resetMetrics()
+	{
+		m_metrics.reset();
+	}
+	//
+	virtual 
+	int process(T* outputBuffer, 
+		T* inputBuffer, 
+		unsigned int samples,
+		unsigned int ipChannels,
+		unsigned int opChannels,
+		unsigned int sampleRate,
+		double streamTime, RtAudioStreamStatus status)
+	{
+		//
+		int ret = 0;
+		// first callback on this thread since Start()
+		if (m_harden && !m_hardened)
+		{
+			nv2::audio::rt::hardenThread(m_hardening, m_report);
+			m_hardened = true;
+		}
+		// time the whole callback, xruns are counted at the end
+		nv2::audio::CallbackMetrics::clock_t::time_point start = m_metrics.begin();
+		// pick up a hot swapped processor
+		adopt();
+		// fully faded out, skip the processors altogether
+		if (silent(opChannels))
+		{
+			std::fill(outputBuffer, outputBuffer + (size_t(samples) * opChannels), T(0));
+		}
+		else
+		{
+			if (m_fadeOut && m_processor &&
+				size_t(samples) * ipChannels <= m_fadeIp.size() &&
+				size_t(samples) * opChannels <= m_fadeOp.size())
+			{
+				ret = fade(outputBuffer, inputBuffer, samples, ipChannels, opChannels, sampleRate, streamTime, status);
+			}
+			else if (m_processor)
+			{
+				// no room to fade, switch now
+				retire(m_fadeOut);
+				m_fadeOut = nullptr;
+				ret = run(m_processor, outputBuffer, inputBuffer, samples, ipChannels, opChannels, sampleRate, streamTime, status);
+			}
+			// mix in the incoming audio
+			mix(outputBuffer, inputBuffer, samples, ipChannels, opChannels);
+		}
+		//
+		m_metrics.end(start, samples, sampleRate, streamTime,
+			(status & RTAUDIO_INPUT_OVERFLOW) != 0,
+			(status & RTAUDIO_OUTPUT_UNDERFLOW) != 0);
+		return ret;
+	}
+};
+
@@ -0,0 +1,522 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <g40/nv2_util.h>
+#include <audio/audio_u.h>
+#include <audio/wav_rdr.h>
+#include <audio/peak_index.h>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// true when no sample in the frames exceeds +/-threshold. packed
+		// frames are one flat run of samples, so SSE covers any channel count
+		inline bool quiet(const float* p, size_t frames, size_t channels, size_t stride, float threshold)
+		{
+			if (stride == channels)
+			{
+				const size_t count = frames * channels;
+				size_t i = 0;
+#if _RT_X86
+				const __m128 sign = _mm_set1_ps(-0.0f);
+				__m128 vmx = _mm_setzero_ps();
+				for (; i + 16 <= count; i += 16)
+				{
+					const __m128 a = _mm_max_ps(_mm_andnot_ps(sign, _mm_loadu_ps(p + i)), _mm_andnot_ps(sign, _mm_loadu_ps(p + i + 4)));
+					const __m128 b = _mm_max_ps(_mm_andnot_ps(sign, _mm_loadu_ps(p + i + 8)), _mm_andnot_ps(sign, _mm_loadu_ps(p + i + 12)));
+					vmx = _mm_max_ps(vmx, _mm_max_ps(a, b));
+				}
+				if (_mm_movemask_ps(_mm_cmpgt_ps(vmx, _mm_set1_ps(threshold))))
+					return false;
+#endif
+				for (; i < count; i++)
+					if (std::fabs(p[i]) > threshold)
+						return false;
+				return true;
+			}
+			for (size_t f = 0; f < frames; f++)
+			{
+				const float* ps = p + (f * stride);
+				for (size_t c = 0; c < channels; c++)
+					if (std::fabs(ps[c]) > threshold)
+						return false;
+			}
+			return true;
+		}
+
+		//-----------------------------------------------------------------------------
+		// as above for native 16 bit PCM, 8 samples a vector
+		inline bool quiet(const short* p, size_t frames, size_t channels, size_t stride, short threshold)
+		{
+			if (stride == channels)
+			{
+				const size_t count = frames * channels;
+				size_t i = 0;
+#if _RT_X86
+				const __m128i zero = _mm_setzero_si128();
+				__m128i vmx = zero;
+				for (; i + 16 <= count; i += 16)
+				{
+					const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+					const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 8));
+					// saturating, so -32768 folds to 32767
+					vmx = _mm_max_epi16(vmx, _mm_max_epi16(a, _mm_subs_epi16(zero, a)));
+					vmx = _mm_max_epi16(vmx, _mm_max_epi16(b, _mm_subs_epi16(zero, b)));
+				}
+				if (_mm_movemask_epi8(_mm_cmpgt_epi16(vmx, _mm_set1_epi16(threshold))))
+					return false;
+#endif
+				for (; i < count; i++)
+					if (p[i] > threshold || p[i] < -threshold)
+						return false;
+				return true;
+			}
+			for (size_t f = 0; f < frames; f++)
+			{
+				const short* ps = p + (f * stride);
+				for (size_t c = 0; c < channels; c++)
+					if (ps[c] > threshold || ps[c] < -threshold)
+						return false;
+			}
+			return true;
+		}
+
+		//-----------------------------------------------------------------------------
+		// runs of near-silent frames, found a block at a time as audio is
+		// decoded. anything downstream can ask how much silence or activity
+		// lies ahead of a frame and skip or fast-path it without losing its
+		// place: the map is in frames, so timing is unaffected. a few bytes
+		// per run, optionally kept as a sidecar next to the source.
+		class SilenceMap
+		{
+		public:
+			//
+			struct Options
+			{
+				// dBFS. every channel must stay at or below it
+				double threshold = -60.0;
+				// blocks of 2^shift frames are tested together
+				size_t shift = 8;
+				// seconds. shorter gaps are treated as activity
+				double minimum = 0.05;
+			};
+			// silent frames [first, first + frames)
+			struct Run
+			{
+				uint64_t first;
+				uint64_t frames;
+			};
+
+		private:
+			// sidecar layout, followed by the runs
+			struct Header
+			{
+				uint32_t tag;
+				uint32_t version;
+				uint32_t channels;
+				uint32_t sampleRate;
+				uint32_t shift;
+				float threshold;
+				double minimum;
+				uint64_t frames;
+				uint64_t runs;
+				// size and modification time of the source when built
+				uint64_t sourceSize;
+				int64_t sourceTime;
+			};
+			static const uint32_t tag = 0x584D4C53;	// 'SLMX'
+			static const uint32_t version = 1;
+			//
+			size_t m_channels = 0;
+			size_t m_sampleRate = 0;
+			Options m_options;
+			uint64_t m_frames = 0;
+			std::vector<Run> m_runs;
+			// while building
+			float m_threshold = 0;
+			short m_pcmThreshold = 0;
+			size_t m_fill = 0;
+			bool m_loud = false;
+			// silent run being extended, frames == 0 when none
+			Run m_run{ 0, 0 };
+			//
+			uint64_t minimum() const
+			{
+				return std::max<uint64_t>(uint64_t(m_options.minimum * m_sampleRate), 1);
+			}
+			// close the block being built
+			void emit()
+			{
+				if (m_fill == 0)
+					return;
+				if (m_loud)
+					close();
+				else
+				{
+					if (m_run.frames == 0)
+						m_run.first = m_frames - m_fill;
+					m_run.frames += m_fill;
+				}
+				m_fill = 0;
+				m_loud = false;
+			}
+			//
+			void close()
+			{
+				if (m_run.frames >= minimum())
+					m_runs.push_back(m_run);
+				m_run.frames = 0;
+			}
+			//
+			bool test(const InterleavedView<const float>& ip, size_t done, size_t n, size_t channels) const
+			{
+				return quiet(ip.frame(done), n, channels, ip.stride, m_threshold);
+			}
+			bool test(const InterleavedView<const short>& ip, size_t done, size_t n, size_t channels) const
+			{
+				return quiet(ip.frame(done), n, channels, ip.stride, m_pcmThreshold);
+			}
+			//
+			template <typename S>
+			void append(const InterleavedView<const S>& ip)
+			{
+				const size_t block = size_t(1) << m_options.shift;
+				const size_t channels = std::min(ip.channels, m_channels);
+				size_t done = 0;
+				while (done < ip.frames)
+				{
+					const size_t n = std::min(block - m_fill, ip.frames - done);
+					// one loud sample settles the block
+					if (!m_loud && !test(ip, done, n, channels))
+						m_loud = true;
+					m_fill += n;
+					m_frames += n;
+					done += n;
+					if (m_fill == block)
+						emit();
+				}
+			}
+			// first run ending after frame
+			std::vector<Run>::const_iterator after(uint64_t frame) const
+			{
+				return std::upper_bound(m_runs.begin(), m_runs.end(), frame,
+					[](uint64_t f, const Run& r) { return f < r.first + r.frames; });
+			}
+
+		public:
+			//
+			SilenceMap() {}
+
+			// start building
+			void begin(size_t channels, size_t sampleRate, const Options& options)
+			{
+				m_channels = std::max<size_t>(channels, 1);
+				m_sampleRate = sampleRate;
+				m_options = options;
+				m_options.shift = std::max<size_t>(1, std::min<size_t>(m_options.shift, 24));
+				const double linear = std::pow(10.0, m_options.threshold / 20.0);
+				m_threshold = float(linear);
+				m_pcmThreshold = short(std::min(32767.0, std::floor(linear * 32767.0)));
+				m_frames = 0;
+				m_runs.clear();
+				m_fill = 0;
+				m_loud = false;
+				m_run = Run{ 0, 0 };
+			}
+			//
+			void begin(size_t channels, size_t sampleRate)
+			{
+				begin(channels, sampleRate, Options());
+			}
+			// feed frames in order, any number at a time
+			void add(const SampleView& ip) { append(ip); }
+			void add(const InterleavedView<const short>& ip) { append(ip); }
+			// close the last block and any open run
+			void finish()
+			{
+				emit();
+				close();
+			}
+
+			// everything in memory, float or compact
+			void build(const SampleData& sd, const Options& options)
+			{
+				const size_t channels = std::max<size_t>(sd.channels, 1);
+				begin(channels, sd.sampleRate, options);
+				if (sd.compact())
+					add(InterleavedView<const short>(sd.begin_pcm(), sd.pcm.size() / channels, channels));
+				else
+					add(view(sd));
+				finish();
+			}
+			//
+			void build(const SampleData& sd)
+			{
+				build(sd, Options());
+			}
+
+			// streams from the reader's position to the end, a chunk at a time
+			bool build(wav::Reader& rdr, const Options& options, size_t chunkFrames = 64 * 1024)
+			{
+				if (!rdr.isOpen())
+					return false;
+				begin(rdr.channels(), rdr.sampleRate(), options);
+				std::vector<short> pcm(chunkFrames * rdr.channels());
+				for (;;)
+				{
+					const size_t n = rdr.read(pcm.data(), chunkFrames);
+					if (n == 0)
+						break;
+					add(InterleavedView<const short>(pcm.data(), n, rdr.channels()));
+				}
+				finish();
+				return true;
+			}
+			//
+			bool build(wav::Reader& rdr)
+			{
+				return build(rdr, Options());
+			}
+
+			// wav::read() that builds the map from the same pass over the
+			// file. empty SampleData on failure
+			static SampleData decode(const std::string& filename, SilenceMap& map, bool compact, const Options& options)
+			{
+				SampleData ret;
+				wav::Reader rdr;
+				if (!rdr.open(filename))
+					return ret;
+				const size_t channels = rdr.channels();
+				const size_t frames = rdr.frames();
+				ret.blockSize = (1024 * 1024);
+				ret.channels = uint32_t(channels);
+				ret.sampleRate = uint32_t(rdr.sampleRate());
+				map.begin(channels, rdr.sampleRate(), options);
+				// compact reads straight into place, else a chunk at a time
+				// is scanned and converted while it is still in cache
+				const size_t chunkFrames = 64 * 1024;
+				std::vector<short> scratch;
+				if (compact)
+					ret.pcm.resize(frames * channels);
+				else
+				{
+					ret.buffer.resize(frames * channels);
+					scratch.resize(chunkFrames * channels);
+				}
+				size_t done = 0;
+				while (done < frames)
+				{
+					short* pcm = (compact ? ret.pcm.data() + (done * channels) : scratch.data());
+					const size_t n = rdr.read(pcm, std::min(chunkFrames, frames - done));
+					if (n == 0)
+						break;
+					map.add(InterleavedView<const short>(pcm, n, channels));
+					if (!compact)
+					{
+						float* pd = ret.buffer.data() + (done * channels);
+						for (size_t s = 0; s < n * channels; s++)
+							pd[s] = u::convert(pcm[s]);
+					}
+					done += n;
+				}
+				map.finish();
+				// short read. keep what we have
+				ret.samples = uint32_t(done * channels);
+				if (compact)
+					ret.pcm.resize(ret.samples);
+				else
+					ret.buffer.resize(ret.samples);
+				return ret;
+			}
+			//
+			static SampleData decode(const std::string& filename, SilenceMap& map, bool compact = false)
+			{
+				return decode(filename, map, compact, Options());
+			}
+
+			// frames of silence from frame on, 0 when frame is active
+			uint64_t silence(uint64_t frame) const
+			{
+				auto it = after(frame);
+				return (it != m_runs.end() && it->first <= frame ? (it->first + it->frames) - frame : 0);
+			}
+			// frames of activity from frame on, 0 when frame is silent
+			uint64_t activity(uint64_t frame) const
+			{
+				if (frame >= m_frames)
+					return 0;
+				auto it = after(frame);
+				if (it == m_runs.end())
+					return m_frames - frame;
+				return (it->first <= frame ? 0 : it->first - frame);
+			}
+			// is all of [first, first + frames) inside one silent run
+			bool silent(uint64_t first, uint64_t frames) const
+			{
+				return (silence(first) >= std::max<uint64_t>(frames, 1));
+			}
+
+			// reader fast path. fills op from the reader's position, zeros
+			// for silent runs, which are seeked over instead of read.
+			// returns frames produced, as rdr.read() would
+			size_t read(wav::Reader& rdr, const InterleavedView<float>& op) const
+			{
+				size_t done = 0;
+				const size_t channels = std::min(rdr.channels(), op.channels);
+				while (done < op.frames && rdr.position() < rdr.frames())
+				{
+					const size_t want = std::min(op.frames - done, rdr.frames() - rdr.position());
+					const uint64_t quiet = silence(rdr.position());
+					if (quiet)
+					{
+						const size_t n = size_t(std::min<uint64_t>(quiet, want));
+						for (size_t f = 0; f < n; f++)
+						{
+							float* pd = op.frame(done + f);
+							for (size_t c = 0; c < channels; c++)
+								pd[c] = 0.0f;
+						}
+						if (!rdr.seek(rdr.position() + n))
+							break;
+						done += n;
+						continue;
+					}
+					const uint64_t active = activity(rdr.position());
+					const size_t n = (active ? size_t(std::min<uint64_t>(active, want)) : want);
+					const size_t got = rdr.read(op.slice(done, n));
+					done += got;
+					if (got < n)
+						break;
+				}
+				return done;
+			}
+
+			// write the sidecar. source names the file it describes, so load()
+			// can tell when it has changed
+			bool save(const std::string& path, const std::string& source = std::string()) const
+			{
+				if (m_channels == 0)
+					return false;
+				Header h{ tag, version, uint32_t(m_channels), uint32_t(m_sampleRate), uint32_t(m_options.shift),
+					float(m_options.threshold), m_options.minimum, m_frames, m_runs.size(), 0, 0 };
+				if (!source.empty() && !sidecar::stamp(source, h.sourceSize, h.sourceTime))
+					return false;
+				FILE* fp = sidecar::open(path, "wb");
+				if (!fp)
+					return false;
+				u::FILECloser fc(fp);
+				bool ok = (fwrite(&h, sizeof(h), 1, fp) == 1);
+				ok = ok && (m_runs.empty() || fwrite(m_runs.data(), sizeof(Run), m_runs.size(), fp) == m_runs.size());
+				return ok;
+			}
+
+			// read a sidecar. false if it is damaged or, given the source,
+			// out of date
+			bool load(const std::string& path, const std::string& source = std::string())
+			{
+				FILE* fp = sidecar::open(path, "rb");
+				if (!fp)
+					return false;
+				u::FILECloser fc(fp);
+				Header h;
+				if (fread(&h, sizeof(h), 1, fp) != 1 || h.tag != tag || h.version != version ||
+					h.channels == 0 || h.shift == 0 || h.shift > 24 || h.runs > (h.frames >> h.shift) + 1)
+					return false;
+				if (!source.empty())
+				{
+					uint64_t size = 0;
+					int64_t time = 0;
+					if (!sidecar::stamp(source, size, time) || size != h.sourceSize || time != h.sourceTime)
+						return false;
+				}
+				std::vector<Run> runs(size_t(h.runs));
+				if (h.runs && fread(runs.data(), sizeof(Run), runs.size(), fp) != runs.size())
+					return false;
+				m_channels = h.channels;
+				m_sampleRate = h.sampleRate;
+				m_options.shift = h.shift;
+				m_options.threshold = h.threshold;
+				m_options.minimum = h.minimum;
+				m_frames = h.frames;
+				m_runs = std::move(runs);
+				return true;
+			}
+
+			// map for a 16 bit wav file. from the sidecar when it is up to
+			// date and built with the same options, else built by streaming
+			// the file and saved. the sidecar defaults to the file name plus
+			// ".slx"
+			bool cache(const std::string& filename, const std::string& sidecar, const Options& options)
+			{
+				const std::string path = (sidecar.empty() ? filename + ".slx" : sidecar);
+				if (load(path, filename) && m_options.shift == options.shift &&
+					m_options.threshold == float(options.threshold) && m_options.minimum == options.minimum)
+					return true;
+				wav::Reader rdr;
+				if (!rdr.open(filename) || !build(rdr, options))
+					return false;
+				rdr.close();
+				// a read-only location is not an error, just slower next time
+				save(path, filename);
+				return true;
+			}
+			//
+			bool cache(const std::string& filename, const std::string& sidecar = std::string())
+			{
+				return cache(filename, sidecar, Options());
+			}
+
+			//
+			size_t channels() const { return m_channels; }
+			size_t sampleRate() const { return m_sampleRate; }
+			uint64_t frames() const { return m_frames; }
+			const Options& options() const { return m_options; }
+			const std::vector<Run>& runs() const { return m_runs; }
+			//
+			uint64_t silentFrames() const
+			{
+				uint64_t ret = 0;
+				for (const Run& r : m_runs)
+					ret += r.frames;
+				return ret;
+			}
+		};
+	}
+}
@@ -0,0 +1,311 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <thread>
+#include <audio/audio_u.h>
+#include <audio/rtaudio.hpp>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// input for a simulated stream. fill the view, return frames written.
+		// fewer than asked for ends the stream
+		template <typename T = float>
+		using SimSource = std::function<size_t(const InterleavedView<T>&)>;
+
+		//-----------------------------------------------------------------------------
+		// play SampleData, float or compact. optionally loop forever. the
+		// source shares ownership, it runs later on the stream's thread
+		inline SimSource<float> wavSource(std::shared_ptr<const SampleData> psd, bool loop = false)
+		{
+			std::shared_ptr<size_t> position = std::make_shared<size_t>(0);
+			if (!psd)
+				return [](const InterleavedView<float>&) -> size_t { return 0; };
+			return [psd, position, loop](const InterleavedView<float>& op) -> size_t
+			{
+				const size_t channels = std::max<size_t>(psd->channels, 1);
+				const size_t total = psd->samples / channels;
+				size_t done = 0;
+				while (done < op.frames && total)
+				{
+					if (*position >= total)
+					{
+						if (!loop)
+							break;
+						*position = 0;
+					}
+					const size_t n = std::min(op.frames - done, total - *position);
+					const size_t c = std::min(channels, op.channels);
+					for (size_t f = 0; f < n; f++)
+					{
+						const size_t s = (*position + f) * channels;
+						float* pd = op.frame(done + f);
+						for (size_t ch = 0; ch < c; ch++)
+							pd[ch] = psd->compact() ? u::convert(psd->pcm[s + ch]) : psd->buffer[s + ch];
+					}
+					*position += n;
+					done += n;
+				}
+				return done;
+			};
+		}
+		// takes the data, e.g. wavSource(wav::read(filename))
+		inline SimSource<float> wavSource(SampleData sd, bool loop = false)
+		{
+			return wavSource(std::make_shared<const SampleData>(std::move(sd)), loop);
+		}
+
+		//-----------------------------------------------------------------------------
+		// endless sine on every channel
+		inline SimSource<float> sineSource(double frequency, unsigned int sampleRate, float level = 0.5f)
+		{
+			std::shared_ptr<double> phase = std::make_shared<double>(0.0);
+			const double step = 2.0 * 3.14159265358979323846 * frequency / sampleRate;
+			return [phase, step, level](const InterleavedView<float>& op) -> size_t
+			{
+				for (size_t f = 0; f < op.frames; f++)
+				{
+					const float v = level * float(sin(*phase));
+					*phase += step;
+					float* pd = op.frame(f);
+					for (size_t c = 0; c < op.channels; c++)
+						pd[c] = v;
+				}
+				return op.frames;
+			};
+		}
+
+		//-----------------------------------------------------------------------------
+		// device-less RtAudioDuplex. drives the same callback and processors
+		// from a source, either as fast as possible (offline render) or paced
+		// to the buffer period with optional jitter (benchmarking).
+		template <typename T = float>
+		class SimDuplex : public RtAudioDuplex<T>
+		{
+		public:
+			//
+			enum Mode { eOffline, eRealtime };
+			//
+			struct Options
+			{
+				Mode mode = eOffline;
+				// +/- fraction of a buffer period added to each wake up
+				double jitter = 0.0;
+				// deterministic jitter
+				unsigned int seed = 1;
+				// stop after this many frames, 0 runs until the source ends
+				size_t maxFrames = 0;
+				// keep the interleaved output, e.g. to write a file
+				bool capture = false;
+			};
+
+		private:
+			//
+			using base_t = RtAudioDuplex<T>;
+			//
+			SimSource<T> m_source;
+			Options m_options;
+			unsigned int m_samples = 0;
+			bool m_open = false;
+			// callback buffers, RtAudio layout
+			std::vector<T> m_ipBuffer;
+			std::vector<T> m_opBuffer;
+			// source is always interleaved
+			std::vector<T> m_scratch;
+			//
+			std::vector<T> m_output;
+			size_t m_frames = 0;
+			//
+			std::thread m_thread;
+			std::atomic<bool> m_running{ false };
+			// one callback. false when the source is exhausted
+			bool step(double streamTime)
+			{
+				const unsigned int ipc = base_t::ipChannels();
+				const unsigned int opc = base_t::opChannels();
+				size_t want = m_samples;
+				if (m_options.maxFrames)
+					want = std::min(want, m_options.maxFrames - m_frames);
+				InterleavedView<T> src(base_t::isPlanar() ? m_scratch.data() : m_ipBuffer.data(), want, ipc);
+				size_t got = m_source ? m_source(src) : 0;
+				if (got == 0)
+					return false;
+				// silence after a short final block
+				for (size_t f = got; f < m_samples; f++)
+					for (size_t c = 0; c < ipc; c++)
+						src.at(f, c) = T(0);
+				if (base_t::isPlanar())
+				{
+					// RtAudio lays channels end to end
+					for (size_t c = 0; c < ipc; c++)
+					{
+						T* pd = m_ipBuffer.data() + (c * m_samples);
+						for (size_t f = 0; f < m_samples; f++)
+							pd[f] = m_scratch[(f * ipc) + c];
+					}
+				}
+				std::fill(m_opBuffer.begin(), m_opBuffer.end(), T(0));
+				base_t::callback(m_opBuffer.data(), m_ipBuffer.data(), m_samples, streamTime, 0, this);
+				if (m_options.capture)
+				{
+					for (size_t f = 0; f < got; f++)
+						for (size_t c = 0; c < opc; c++)
+							m_output.push_back(base_t::isPlanar() ? m_opBuffer[(c * m_samples) + f] : m_opBuffer[(f * opc) + c]);
+				}
+				m_frames += got;
+				return (got == m_samples) && (m_options.maxFrames == 0 || m_frames < m_options.maxFrames);
+			}
+			// as fast as possible. a worker also checks for Stop()
+			size_t render(bool worker)
+			{
+				const size_t start = m_frames;
+				double streamTime = double(m_frames) / base_t::sampleRate();
+				while (step(streamTime))
+				{
+					streamTime = double(m_frames) / base_t::sampleRate();
+					if (worker && !m_running.load(std::memory_order_acquire))
+						break;
+				}
+				return m_frames - start;
+			}
+			// real-time paced loop
+			void pace()
+			{
+				using clock_t = std::chrono::steady_clock;
+				const double period = double(m_samples) / base_t::sampleRate();
+				std::mt19937 rng(m_options.seed);
+				std::uniform_real_distribution<double> jitter(-m_options.jitter, m_options.jitter);
+				const clock_t::time_point start = clock_t::now();
+				for (uint64_t n = 0; m_running.load(std::memory_order_acquire); n++)
+				{
+					double when = (n + (m_options.jitter > 0 ? jitter(rng) : 0.0)) * period;
+					std::this_thread::sleep_until(start + std::chrono::duration_cast<clock_t::duration>(std::chrono::duration<double>(when)));
+					double streamTime = std::chrono::duration<double>(clock_t::now() - start).count();
+					if (!step(streamTime))
+						break;
+				}
+				m_running.store(false, std::memory_order_release);
+			}
+			// non-copyable
+			SimDuplex(const SimDuplex&) = delete;
+			SimDuplex& operator=(const SimDuplex&) = delete;
+
+		public:
+			//
+			SimDuplex() {}
+			//
+			virtual ~SimDuplex() { Close(); }
+			// same shape as RtAudioDuplex::Open with a source instead of devices
+			bool Open(SimSource<T> source,
+						IDuplexProcessor<T>* processor = nullptr,
+						int ipChannels = 2,
+						int opChannels = 2,
+						int sampleRate = 44100, unsigned int samples = 512,
+						bool planar = false,
+						const Options& options = Options())
+			{
+				if (m_open || samples == 0 || sampleRate <= 0)
+					return false;
+				m_source = source;
+				m_options = options;
+				m_samples = samples;
+				m_ipBuffer.assign(size_t(samples) * ipChannels, T(0));
+				m_opBuffer.assign(size_t(samples) * opChannels, T(0));
+				m_scratch.assign(size_t(samples) * ipChannels, T(0));
+				m_output.clear();
+				m_frames = 0;
+				base_t::Configure(processor, ipChannels, opChannels, sampleRate, planar, samples);
+				m_open = true;
+				return true;
+			}
+			// offline render on the calling thread. returns frames processed
+			size_t Run()
+			{
+				if (!m_open || m_running.load())
+					return 0;
+				base_t::Prepare();
+				return render(false);
+			}
+			// offline renders on a worker, real-time paces a worker
+			bool Start()
+			{
+				if (!m_open || m_running.load())
+					return false;
+				if (m_thread.joinable())
+					m_thread.join();
+				base_t::Prepare();
+				m_running.store(true);
+				if (m_options.mode == eRealtime)
+					m_thread = std::thread([this]() { pace(); });
+				else
+					m_thread = std::thread([this]() { render(true); m_running.store(false); });
+				return true;
+			}
+			//
+			bool Stop()
+			{
+				m_running.store(false, std::memory_order_release);
+				if (m_thread.joinable())
+					m_thread.join();
+				return true;
+			}
+			//
+			bool Close()
+			{
+				Stop();
+				m_open = false;
+				return true;
+			}
+			//
+			bool isRunning() const
+			{
+				return m_running.load(std::memory_order_acquire);
+			}
+			// frames pushed through the callback so far
+			size_t frames() const { return m_frames; }
+			// interleaved output when Options::capture is set
+			const std::vector<T>& output() const { return m_output; }
+			//
+			InterleavedView<const T> outputView() const
+			{
+				return InterleavedView<const T>(m_output.data(), m_output.size() / std::max(base_t::opChannels(), 1u), base_t::opChannels());
+			}
+		};
+	}
+}
@@ -0,0 +1,498 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include <audio/audio_u.h>
+#include <audio/fft.h>
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// framing shared by analysis and resynthesis
+		struct StftOptions
+		{
+			//
+			enum Window { eRectangular, eHann, eHamming, eBlackman };
+			// FFT size, a power of two
+			size_t size = 1024;
+			// frames advance by this many samples, at most size
+			size_t hop = 256;
+			Window window = eHann;
+			// frames per sink call. batching amortises the sink, each frame
+			// is still its own FFT
+			size_t batch = 16;
+
+			// periodic, so overlapped copies sum evenly
+			static void window_(Window window, float* w, size_t size)
+			{
+				const double pi = 3.14159265358979323846;
+				for (size_t n = 0; n < size; n++)
+				{
+					const double x = 2.0 * pi * double(n) / double(size);
+					switch (window)
+					{
+					case eHann: w[n] = float(0.5 - (0.5 * std::cos(x))); break;
+					case eHamming: w[n] = float(0.54 - (0.46 * std::cos(x))); break;
+					case eBlackman: w[n] = float(0.42 - (0.5 * std::cos(x)) + (0.08 * std::cos(2.0 * x))); break;
+					default: w[n] = 1.0f; break;
+					}
+				}
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		// streaming short-time Fourier transform. samples go in as they
+		// arrive, from SampleBlocks, planar or interleaved views, and every
+		// hop samples one windowed frame per channel is queued. a full queue
+		// is transformed, frame by frame, and handed to the sink in one
+		// call. frame k covers samples
+		// [k * hop - (size - hop), (k + 1) * hop), the start padded with
+		// zeros. flush() pads the end the same way so every sample sits
+		// under a full set of frames and ISTFT gives the input back exactly,
+		// sample for sample.
+		// nothing is allocated after construction, so it can run in a
+		// callback. analyze() splits a whole file over threads instead.
+		class STFT
+		{
+		public:
+			//
+			using Options = StftOptions;
+			// one batch of frames. bins are interleaved complex, n/2 + 1
+			// per frame and channel
+			struct Spectra
+			{
+				// index of the first frame
+				int64_t frame = 0;
+				size_t frames = 0;
+				size_t channels = 0;
+				size_t bins = 0;
+				size_t size = 0;
+				size_t hop = 0;
+				// [frame][channel][bin]
+				const float* data = nullptr;
+				//
+				const float* at(size_t f, size_t c) const
+				{
+					return data + (((f * channels) + c) * bins * 2);
+				}
+				// first input sample under frame f, negative in the padding
+				int64_t position(size_t f) const
+				{
+					return ((frame + int64_t(f)) * int64_t(hop)) - int64_t(size - hop);
+				}
+			};
+			// live, on the thread calling add(). analyze(), on any worker
+			using Sink = std::function<void(const Spectra&)>;
+
+		private:
+			//
+			Options m_options;
+			size_t m_channels = 0;
+			size_t m_stride = 0;
+			FFT m_fft;
+			AlignedBuffer<float> m_window;
+			// [channel][size], the frame being filled
+			AlignedBuffer<float> m_history;
+			size_t m_fill = 0;
+			// [frame][channel][size] windowed, then [frame][channel][bins]
+			AlignedBuffer<float> m_time;
+			AlignedBuffer<float> m_bins;
+			size_t m_count = 0;
+			int64_t m_next = 0;
+			// samples added since reset()
+			int64_t m_samples = 0;
+			Sink m_sink;
+			// transform and hand over whatever is queued
+			void run()
+			{
+				if (m_count == 0)
+					return;
+				const size_t size = m_options.size;
+				m_fft.forward(m_time.data(), size, m_bins.data(), m_stride, m_count * m_channels);
+				Spectra s;
+				s.frame = m_next - int64_t(m_count);
+				s.frames = m_count;
+				s.channels = m_channels;
+				s.bins = m_fft.bins();
+				s.size = size;
+				s.hop = m_options.hop;
+				s.data = m_bins.data();
+				m_count = 0;
+				if (m_sink)
+					m_sink(s);
+			}
+			// queue the history as frame m_next
+			void push()
+			{
+				const size_t size = m_options.size;
+				float* pt = m_time.data() + (m_count * m_channels * size);
+				for (size_t c = 0; c < m_channels; c++)
+				{
+					const float* ph = m_history.data() + (c * size);
+					for (size_t n = 0; n < size; n++)
+						pt[(c * size) + n] = ph[n] * m_window[n];
+				}
+				m_count++;
+				m_next++;
+				if (m_count == m_options.batch)
+					run();
+				// keep the overlap for the next frame
+				const size_t hop = m_options.hop;
+				for (size_t c = 0; c < m_channels; c++)
+				{
+					float* ph = m_history.data() + (c * size);
+					std::memmove(ph, ph + hop, (size - hop) * sizeof(float));
+				}
+				m_fill = size - hop;
+			}
+			//
+			template <typename V>
+			void append(const V& ip)
+			{
+				if (!valid())
+					return;
+				const size_t size = m_options.size;
+				const size_t channels = std::min(ip.channels, m_channels);
+				size_t done = 0;
+				while (done < ip.frames)
+				{
+					const size_t n = std::min(size - m_fill, ip.frames - done);
+					for (size_t c = 0; c < channels; c++)
+					{
+						float* ph = m_history.data() + (c * size) + m_fill;
+						for (size_t f = 0; f < n; f++)
+							ph[f] = ip.at(done + f, c);
+					}
+					// missing channels are silent
+					for (size_t c = channels; c < m_channels; c++)
+						std::fill(m_history.data() + (c * size) + m_fill, m_history.data() + (c * size) + m_fill + n, 0.0f);
+					m_fill += n;
+					done += n;
+					if (m_fill == size)
+						push();
+				}
+				m_samples += int64_t(ip.frames);
+			}
+			// frame k straight from memory, for analyze()
+			void load(const SampleData& sd, int64_t k)
+			{
+				const size_t size = m_options.size;
+				const int64_t total = int64_t(sd.compact() ? sd.pcm.size() : sd.buffer.size()) / int64_t(m_channels);
+				const int64_t first = start(k);
+				float* pt = m_time.data() + (m_count * m_channels * size);
+				for (size_t c = 0; c < m_channels; c++)
+				{
+					for (size_t n = 0; n < size; n++)
+					{
+						const int64_t t = first + int64_t(n);
+						float v = 0.0f;
+						if (t >= 0 && t < total)
+						{
+							const size_t s = (size_t(t) * m_channels) + c;
+							v = (sd.compact() ? u::convert(sd.pcm[s]) : sd.buffer[s]);
+						}
+						pt[(c * size) + n] = v * m_window[n];
+					}
+				}
+				m_count++;
+				m_next = k + 1;
+				if (m_count == m_options.batch)
+					run();
+			}
+
+		public:
+			//
+			STFT(size_t channels, const Options& options, Sink sink) :
+				m_options(options),
+				m_channels(std::max<size_t>(channels, 1)),
+				m_sink(sink)
+			{
+				m_options.batch = std::max<size_t>(m_options.batch, 1);
+				if (m_options.hop == 0 || m_options.hop > m_options.size || !m_fft.assign(m_options.size, FFTPlan::eReal))
+					return;
+				const size_t size = m_options.size;
+				m_stride = 2 * m_fft.bins();
+				m_window.assign(size);
+				Options::window_(m_options.window, m_window.data(), size);
+				m_history.assign(m_channels * size);
+				m_time.assign(m_options.batch * m_channels * size);
+				m_bins.assign(m_options.batch * m_channels * m_stride);
+				reset();
+			}
+			//
+			STFT(size_t channels, Sink sink) :
+				STFT(channels, Options(), sink)
+			{
+			}
+			// false if the size is not a power of two or the hop is out of range
+			bool valid() const { return m_fft.valid(); }
+			// back to the start, leading padding included
+			void reset()
+			{
+				std::fill(m_history.data(), m_history.data() + m_history.size(), 0.0f);
+				m_fill = m_options.size - m_options.hop;
+				m_count = 0;
+				m_next = 0;
+				m_samples = 0;
+			}
+			// samples in order, any number at a time
+			void add(const PlanarSampleView& ip) { append(ip); }
+			void add(const SampleView& ip) { append(ip); }
+			void add(const SampleBlock& sb) { append(view(sb)); }
+			// end of input. queues zero padded frames until the last sample
+			// added has been under every frame that overlaps it, then
+			// delivers any partial batch. reset() before starting again
+			void flush()
+			{
+				if (!valid())
+					return;
+				const size_t size = m_options.size;
+				while (start(m_next) < m_samples)
+				{
+					for (size_t c = 0; c < m_channels; c++)
+						std::fill(m_history.data() + (c * size) + m_fill, m_history.data() + ((c + 1) * size), 0.0f);
+					push();
+				}
+				run();
+			}
+			//
+			const Options& options() const { return m_options; }
+			size_t channels() const { return m_channels; }
+			size_t bins() const { return m_fft.bins(); }
+			// frames queued so far
+			int64_t frames() const { return m_next; }
+			// first input sample under frame k
+			int64_t start(int64_t k) const
+			{
+				return (k * int64_t(m_options.hop)) - int64_t(m_options.size - m_options.hop);
+			}
+			// frames needed to cover 'samples' at both ends
+			int64_t frames(int64_t samples) const
+			{
+				return (samples + int64_t(m_options.size) - 1) / int64_t(m_options.hop);
+			}
+
+			// a whole file, float or compact, spread over a pool of threads.
+			// each takes the next run of frames straight from memory, so
+			// batches reach the sink concurrently and out of order, in
+			// batches of at most options.batch frames. 0 threads uses every
+			// hardware thread. returns the frame count, 0 if options.size is not
+			// a power of two or the hop is out of range
+			static int64_t analyze(const SampleData& sd, const Options& options, const Sink& sink, size_t threads = 0)
+			{
+				const size_t channels = std::max<size_t>(sd.channels, 1);
+				const int64_t total = int64_t(sd.compact() ? sd.pcm.size() : sd.buffer.size()) / int64_t(channels);
+				if (options.hop == 0 || options.hop > options.size || total == 0 || !FFTPlan::get(options.size, FFTPlan::eReal))
+					return 0;
+				const int64_t frames = (total + int64_t(options.size) - 1) / int64_t(options.hop);
+				// a few batches per task keeps the pool balanced
+				const int64_t task = int64_t(std::max<size_t>(options.batch, 1) * 8);
+				const int64_t tasks = (frames + task - 1) / task;
+				TaskPool pool(size_t(tasks), threads);
+				pool.run([&]()
+				{
+					STFT local(channels, options, sink);
+					if (!local.valid())
+						return;
+					for (size_t t = 0; pool.take(t);)
+					{
+						const int64_t last = std::min(frames, int64_t(t + 1) * task);
+						for (int64_t k = int64_t(t) * task; k < last; k++)
+							local.load(sd, k);
+						local.run();
+					}
+				});
+				return frames;
+			}
+			//
+			static int64_t analyze(const SampleData& sd, const Sink& sink, size_t threads = 0)
+			{
+				return analyze(sd, Options(), sink, threads);
+			}
+
+			// |X| of 'bins' interleaved complex values
+			static void magnitude(const float* bins, size_t count, float* out)
+			{
+				for (size_t k = 0; k < count; k++)
+					out[k] = std::sqrt((bins[2 * k] * bins[2 * k]) + (bins[(2 * k) + 1] * bins[(2 * k) + 1]));
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		// weighted overlap-add resynthesis of STFT frames with the same
+		// options. each frame completes hop samples per channel, normalised
+		// by the summed squared window so an unmodified STFT comes back
+		// exactly. frames must arrive in order; output goes to the sink a
+		// batch at a time, as a planar view. the leading padding is dropped
+		// so output starts at input sample 0, and after STFT::flush() it
+		// runs to the end of the input, rounded up to a hop.
+		class ISTFT
+		{
+		public:
+			//
+			using Options = StftOptions;
+			// planar, batch * hop frames at most
+			using Sink = std::function<void(const PlanarSampleView&)>;
+
+		private:
+			//
+			Options m_options;
+			size_t m_channels = 0;
+			FFT m_fft;
+			// synthesis window with the 1/size of the inverse folded in
+			AlignedBuffer<float> m_window;
+			// 1 / summed squared window, one hop long
+			AlignedBuffer<float> m_norm;
+			// [channel][size] overlap-add accumulator
+			AlignedBuffer<float> m_ola;
+			// [frame][channel][size]
+			AlignedBuffer<float> m_time;
+			// [channel][batch * hop]
+			AlignedBuffer<float> m_out;
+			std::vector<const float*> m_ptrs;
+			int64_t m_frames = 0;
+			// padding still to drop
+			size_t m_skip = 0;
+			Sink m_sink;
+
+		public:
+			//
+			ISTFT(size_t channels, const Options& options, Sink sink) :
+				m_options(options),
+				m_channels(std::max<size_t>(channels, 1)),
+				m_sink(sink)
+			{
+				m_options.batch = std::max<size_t>(m_options.batch, 1);
+				if (m_options.hop == 0 || m_options.hop > m_options.size || !m_fft.assign(m_options.size, FFTPlan::eReal))
+					return;
+				const size_t size = m_options.size;
+				const size_t hop = m_options.hop;
+				m_window.assign(size);
+				Options::window_(m_options.window, m_window.data(), size);
+				m_norm.assign(hop);
+				for (size_t j = 0; j < hop; j++)
+				{
+					double sum = 0;
+					for (size_t n = j; n < size; n += hop)
+						sum += double(m_window[n]) * m_window[n];
+					m_norm[j] = (sum > 1e-9 ? float(1.0 / sum) : 0.0f);
+				}
+				for (size_t n = 0; n < size; n++)
+					m_window[n] /= float(size);
+				m_ola.assign(m_channels * size);
+				m_time.assign(m_options.batch * m_channels * size);
+				m_out.assign(m_channels * m_options.batch * hop);
+				for (size_t c = 0; c < m_channels; c++)
+					m_ptrs.push_back(m_out.data() + (c * m_options.batch * hop));
+				reset();
+			}
+			//
+			ISTFT(size_t channels, Sink sink) :
+				ISTFT(channels, Options(), sink)
+			{
+			}
+			//
+			bool valid() const { return m_fft.valid(); }
+			//
+			void reset()
+			{
+				std::fill(m_ola.data(), m_ola.data() + m_ola.size(), 0.0f);
+				m_frames = 0;
+				m_skip = m_options.size - m_options.hop;
+			}
+			// frames resynthesised so far
+			int64_t frames() const { return m_frames; }
+			// the next frames, e.g. straight from an STFT sink after any
+			// spectral processing
+			void add(const STFT::Spectra& s)
+			{
+				if (!valid() || s.bins != m_fft.bins())
+					return;
+				const size_t size = m_options.size;
+				const size_t hop = m_options.hop;
+				const size_t channels = std::min(s.channels, m_channels);
+				for (size_t b = 0; b < s.frames; b += m_options.batch)
+				{
+					const size_t n = std::min(m_options.batch, s.frames - b);
+					if (s.channels == m_channels)
+					{
+						// frames and channels are contiguous, one strided call
+						m_fft.inverse(s.at(b, 0), 2 * s.bins, m_time.data(), size, n * m_channels);
+					}
+					else
+					{
+						for (size_t f = 0; f < n; f++)
+						{
+							for (size_t c = 0; c < m_channels; c++)
+							{
+								float* pt = m_time.data() + (((f * m_channels) + c) * size);
+								if (c < channels)
+									m_fft.inverse(s.at(b + f, c), pt);
+								else
+									std::fill(pt, pt + size, 0.0f);
+							}
+						}
+					}
+					size_t written = 0;
+					for (size_t f = 0; f < n; f++)
+					{
+						const size_t skip = std::min(m_skip, hop);
+						for (size_t c = 0; c < m_channels; c++)
+						{
+							const float* pt = m_time.data() + (((f * m_channels) + c) * size);
+							float* pa = m_ola.data() + (c * size);
+							for (size_t k = 0; k < size; k++)
+								pa[k] += pt[k] * m_window[k];
+							// the first hop is now complete
+							float* po = m_out.data() + (c * m_options.batch * hop) + written - skip;
+							for (size_t j = skip; j < hop; j++)
+								po[j] = pa[j] * m_norm[j];
+							std::memmove(pa, pa + hop, (size - hop) * sizeof(float));
+							std::fill(pa + (size - hop), pa + size, 0.0f);
+						}
+						written += hop - skip;
+						m_skip -= skip;
+					}
+					m_frames += int64_t(n);
+					if (m_sink && written)
+						m_sink(PlanarSampleView(m_ptrs.data(), written, m_channels));
+				}
+			}
+		};
+	}
+}
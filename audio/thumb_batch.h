@@ -0,0 +1,348 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include <g40/nv2_util.h>
+#include <g40/nv2_mmf.h>
+#include <audio/audio_u.h>
+#include <audio/peak_index.h>
+
+#if !_IS_WINDOWS
+#include <dirent.h>
+#endif
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// waveform thumbnails for many 16 bit wav files at once. each file is
+		// memory mapped and scanned in place as int16 with SIMD min/max, no
+		// float conversion and no copies. files are spread over a pool of
+		// threads, each worker taking the next file as it finishes.
+		class ThumbnailBatch
+		{
+		public:
+			//
+			struct Options
+			{
+				// thumbnail width
+				size_t pixels = 100;
+				// 0 uses every hardware thread
+				size_t threads = 0;
+				// when listing a directory, case insensitive
+				std::string extension = ".wav";
+				bool recurse = false;
+				// also write a PeakIndex sidecar next to each file. the
+				// thumbnail is then taken from the index, block aligned
+				bool sidecar = false;
+				size_t shift = 8;
+			};
+			//
+			struct Thumbnail
+			{
+				std::string path;
+				bool ok = false;
+				size_t channels = 0;
+				size_t sampleRate = 0;
+				size_t frames = 0;
+				// pixels x channels, channel interleaved. +/-1.0f
+				std::vector<PeakIndex::Peak> peaks;
+				//
+				size_t pixels() const { return (channels ? peaks.size() / channels : 0); }
+				const PeakIndex::Peak& at(size_t px, size_t c) const { return peaks[(px * channels) + c]; }
+			};
+			// aggregate throughput
+			struct Stats
+			{
+				size_t files = 0;
+				size_t failed = 0;
+				uint64_t bytes = 0;
+				double seconds = 0;
+				size_t threads = 0;
+				//
+				double filesPerSecond() const { return (seconds > 0 ? double(files) / seconds : 0.0); }
+				double gbPerSecond() const { return (seconds > 0 ? double(bytes) / (1e9 * seconds) : 0.0); }
+				// single line for logs
+				std::string str() const
+				{
+					return nv2::sprintf("files %llu failed %llu bytes %llu threads %llu %.3fs %.1f files/s %.2f GB/s",
+						(unsigned long long)files,
+						(unsigned long long)failed,
+						(unsigned long long)bytes,
+						(unsigned long long)threads,
+						seconds, filesPerSecond(), gbPerSecond());
+				}
+			};
+			// called on the worker threads, once per file
+			using Sink = std::function<void(const Thumbnail&)>;
+
+		private:
+			//
+			Options m_options;
+			std::vector<Thumbnail> m_thumbnails;
+			//
+			static bool matches(const std::string& name, const std::string& extension)
+			{
+				if (extension.empty())
+					return true;
+				if (name.size() < extension.size())
+					return false;
+				for (size_t i = 0; i < extension.size(); i++)
+				{
+					if (tolower((unsigned char)name[name.size() - extension.size() + i]) != tolower((unsigned char)extension[i]))
+						return false;
+				}
+				return true;
+			}
+			//
+			static void walk(const std::string& directory, const std::string& extension, bool recurse, std::vector<std::string>& files)
+			{
+#if _IS_WINDOWS
+				WIN32_FIND_DATAW fd;
+				HANDLE h = FindFirstFileW(nv2::n2w(directory + "\\*").c_str(), &fd);
+				if (h == INVALID_HANDLE_VALUE)
+					return;
+				do
+				{
+					const std::string name = nv2::w2n(fd.cFileName);
+					if (name == "." || name == "..")
+						continue;
+					const std::string path = directory + "\\" + name;
+					if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+					{
+						if (recurse)
+							walk(path, extension, recurse, files);
+					}
+					else if (matches(name, extension))
+					{
+						files.push_back(path);
+					}
+				} while (FindNextFileW(h, &fd));
+				FindClose(h);
+#else
+				DIR* dir = opendir(directory.c_str());
+				if (!dir)
+					return;
+				while (struct dirent* de = readdir(dir))
+				{
+					const std::string name = de->d_name;
+					if (name == "." || name == "..")
+						continue;
+					const std::string path = directory + "/" + name;
+					struct stat st;
+					if (stat(path.c_str(), &st) != 0)
+						continue;
+					if (S_ISDIR(st.st_mode))
+					{
+						if (recurse)
+							walk(path, extension, recurse, files);
+					}
+					else if (S_ISREG(st.st_mode) && matches(name, extension))
+					{
+						files.push_back(path);
+					}
+				}
+				closedir(dir);
+#endif
+			}
+			// fmt and data chunks of a mapped RIFF/WAVE file, 16 bit PCM only
+			static bool parse(const uint8_t* p, uint64_t size, wav::WAVE_FORMAT_HEADER& wfx, const short*& data, uint64_t& bytes)
+			{
+				uint32_t id = 0;
+				uint32_t len = 0;
+				if (size < 12)
+					return false;
+				memcpy(&id, p, 4);
+				if (id != wav::RIFF_TAG)
+					return false;
+				memcpy(&id, p + 8, 4);
+				if (id != wav::WAVE_TAG)
+					return false;
+				bool format = false;
+				data = nullptr;
+				// chunks are word aligned, so data is always short aligned
+				for (uint64_t offset = 12; offset + 8 <= size; offset += 8 + uint64_t(len) + (len & 1))
+				{
+					memcpy(&id, p + offset, 4);
+					memcpy(&len, p + offset + 4, 4);
+					if (id == wav::FMT__TAG && len >= sizeof(wfx) && offset + 8 + sizeof(wfx) <= size)
+					{
+						memcpy(&wfx, p + offset + 8, sizeof(wfx));
+						format = true;
+					}
+					else if (id == wav::DATA_TAG && format)
+					{
+						data = reinterpret_cast<const short*>(p + offset + 8);
+						bytes = std::min<uint64_t>(len, size - (offset + 8));
+						break;
+					}
+				}
+				// plain or extensible PCM
+				return data && (wfx.wFormat == WAVE_FORMAT_PCM || wfx.wFormat == 0xFFFE) &&
+					wfx.wBitsPerSample == 16 && wfx.nChannels > 0;
+			}
+
+		public:
+			//
+			explicit ThumbnailBatch(const Options& options) : m_options(options) {}
+			//
+			ThumbnailBatch() {}
+
+			// matching files under a directory, sorted
+			static std::vector<std::string> list(const std::string& directory, const std::string& extension = ".wav", bool recurse = false)
+			{
+				std::vector<std::string> ret;
+				walk(directory, extension, recurse, ret);
+				std::sort(ret.begin(), ret.end());
+				return ret;
+			}
+
+			// one file on the calling thread. bytes is the size mapped
+			static bool thumbnail(const std::string& path, const Options& options, Thumbnail& out, uint64_t& bytes)
+			{
+				out = Thumbnail();
+				out.path = path;
+				bytes = 0;
+				nv2::MMapFile<uint8_t> mmf;
+				if (!mmf.Open(nv2::n2t(path)))
+					return false;
+				bytes = mmf.size();
+				wav::WAVE_FORMAT_HEADER wfx;
+				const short* data = nullptr;
+				uint64_t dataBytes = 0;
+				if (!parse(mmf.data(), mmf.size(), wfx, data, dataBytes))
+					return false;
+				const size_t channels = wfx.nChannels;
+				const size_t frames = size_t(dataBytes / (sizeof(short) * channels));
+				const size_t pixels = std::max<size_t>(options.pixels, 1);
+				out.channels = channels;
+				out.sampleRate = wfx.dwSampleRate;
+				out.frames = frames;
+				out.peaks.assign(pixels * channels, PeakIndex::Peak());
+				if (options.sidecar)
+				{
+					// one pass for the index, the thumbnail comes from it
+					PeakIndex index;
+					index.begin(channels, wfx.dwSampleRate, options.shift, frames);
+					index.add(InterleavedView<const short>(data, frames, channels));
+					index.finish();
+					std::vector<PeakIndex::Peak> peaks(pixels);
+					for (size_t c = 0; c < channels; c++)
+					{
+						const size_t n = index.query(c, 0, frames, peaks.data(), pixels);
+						for (size_t px = 0; px < n; px++)
+							out.peaks[(px * channels) + c] = peaks[px];
+					}
+					mmf.Close();
+					index.save(path + ".pkx", path);
+				}
+				else
+				{
+					std::vector<float> mn(channels);
+					std::vector<float> mx(channels);
+					std::vector<double> ss(channels);
+					for (size_t px = 0; px < pixels && frames; px++)
+					{
+						const size_t start = size_t((double(px) * frames) / pixels);
+						const size_t end = std::max(start + 1, size_t((double(px + 1) * frames) / pixels));
+						std::fill(mn.begin(), mn.end(), FLT_MAX);
+						std::fill(mx.begin(), mx.end(), -FLT_MAX);
+						std::fill(ss.begin(), ss.end(), 0.0);
+						extents(data + (start * channels), end - start, channels, channels, mn.data(), mx.data(), ss.data());
+						for (size_t c = 0; c < channels; c++)
+						{
+							PeakIndex::Peak& pk = out.peaks[(px * channels) + c];
+							pk.min = mn[c];
+							pk.max = mx[c];
+							pk.rms = float(std::sqrt(ss[c] / double(end - start)));
+						}
+					}
+				}
+				out.ok = true;
+				return true;
+			}
+
+			// every file, spread over the pool. without a sink the results
+			// are kept, in file order, for thumbnails()
+			Stats run(const std::vector<std::string>& files, Sink sink = Sink())
+			{
+				using clock_t = std::chrono::steady_clock;
+				const clock_t::time_point start = clock_t::now();
+				Stats ret;
+				ret.files = files.size();
+				m_thumbnails.clear();
+				if (!sink)
+					m_thumbnails.resize(files.size());
+				TaskPool pool(files.size(), m_options.threads);
+				std::atomic<size_t> failed{ 0 };
+				std::atomic<uint64_t> bytes{ 0 };
+				pool.run([&]()
+				{
+					Thumbnail local;
+					for (size_t i = 0; pool.take(i);)
+					{
+						Thumbnail& tn = (sink ? local : m_thumbnails[i]);
+						uint64_t mapped = 0;
+						if (!thumbnail(files[i], m_options, tn, mapped))
+							failed.fetch_add(1, std::memory_order_relaxed);
+						bytes.fetch_add(mapped, std::memory_order_relaxed);
+						if (sink)
+							sink(tn);
+					}
+				});
+				ret.failed = failed.load();
+				ret.bytes = bytes.load();
+				ret.threads = pool.threads();
+				ret.seconds = std::chrono::duration<double>(clock_t::now() - start).count();
+				return ret;
+			}
+
+			// every matching file in a directory
+			Stats run(const std::string& directory, Sink sink = Sink())
+			{
+				return run(list(directory, m_options.extension, m_options.recurse), sink);
+			}
+
+			// results of the last run() without a sink
+			const std::vector<Thumbnail>& thumbnails() const { return m_thumbnails; }
+		};
+	}
+}
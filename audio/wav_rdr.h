@@ -1,206 +1,341 @@
-/*
-
-
-
-
-
-*/
-
-#pragma once
-
-#include <stdio.h>
-#include <string>
-#include <vector>
-#include <g40/nv2_util.h>
-#include <audio/audio_u.h>
-
-
-namespace nv2
-{
-	namespace wav
-	{
-		//-----------------------------------------------------------------------------
-		// 
-		//-----------------------------------------------------------------------------
-		// do everything in 1 pass.
-		static
-		nv2::audio::SampleData 
-		read(const std::string& filename, int blockSize = (1024 * 1024))
-		{
-
-			nv2::audio::SampleData wav_data;
-
-			// these 3 structures make up the wave file header
-			WAVE_RIFF_HEADER m_wrh{ 0 };	// 'RIFF' size 'WAVE'
-			WAVE_FORMAT_HEADER m_wfx{ 0 };	// content format
-			WAVE_DATA_HEADER m_wdh{ 0 };	// 'DATA' file size
-			FILE* fp = nullptr;
-#if _IS_WINDOWS
-			errno_t err = fopen_s(&fp, filename.c_str(), "rb");
-			u::throw_if(err != 0, "wav_rdr: could not open file");
-#else
-			fp = fopen(filename.c_str(), "rb");
-			//
-			u::throw_if(fp == nullptr, "wav_rdr: could not open file");
-#endif
-			
-			// closer for file handle
-			nv2::u::FILECloser fc(fp);
-
-			do
-			{
-				size_t read = fread(&m_wrh, 1, sizeof(m_wrh), fp);
-				if (read != sizeof(m_wrh))
-					break;
-				read = fread(&m_wfx, 1, sizeof(m_wfx), fp);
-				if (read != sizeof(m_wfx))
-					break;
-				read = fread(&m_wdh, 1, sizeof(m_wdh), fp);
-				if (read != sizeof(m_wdh))
-					break;
-
-				// sanity checks
-				u::throw_if(m_wrh.dwRiff != RIFF_TAG, "Expecting RIFF");
-				u::throw_if(m_wrh.dwWave != WAVE_TAG, "Expecting WAVE");
-				u::throw_if(m_wrh.dwFormat != FMT__TAG, "Expecting fmt ");
-				u::throw_if(m_wrh.dwFormatLength != sizeof(m_wfx), "Bad wave format size");
-				u::throw_if(m_wdh.dwData != DATA_TAG, "Expecting data");
-				// we only support 16 bit data now.
-				if (m_wfx.wBitsPerSample != 16)
-					break;
-				//
-				wav_data.blockSize = blockSize;
-				wav_data.channels = m_wfx.nChannels;
-				wav_data.sampleRate = m_wfx.dwSampleRate;
-				wav_data.samples = m_wdh.dwDataLength / (m_wfx.wBitsPerSample / 8);
-				wav_data.buffer.assign(wav_data.samples, 0);
-
-				// float destination buffer
-				float* pdf = &wav_data.buffer[0];
-				// housekeeping for on the fly conversion
-				size_t total = (size_t) m_wdh.dwDataLength;
-				size_t chunksize = (4 * 1024);
-				std::vector<unsigned char> data(chunksize,0);
-				//
-				for (;;)
-				{
-					size_t toRead = (std::min)(total, chunksize);
-					// read the block
-					size_t ret = fread(&data[0], 1, toRead, fp);
-					if (ret == 0)
-					{
-						// ok. we read nothing
-						break;
-					}
-					if (ret != toRead)
-					{
-						// error
-						break;
-					}
-					// convert this chunk
-					const short* pc = (const short*)&data[0];
-					const short* pce = pc + (ret / sizeof(short));
-					while (pc < pce)
-					{
-						*pdf++ = u::convert(*pc++);
-					}
-					//
-					total -= ret;
-				}
-				//
-			} while (0);
-			//
-			return wav_data;
-		}
-
-		//-----------------------------------------------------------------------------
-		// interleaved raw sample data. no conversions. for debugging etc.
-		struct RawData
-		{
-			unsigned long samples = 0;
-			unsigned long channels = 0;
-			unsigned long sampleRate = 0;
-			// thus samples * channels in size
-			std::vector<unsigned char> buffer;
-		};
-
-		//-----------------------------------------------------------------------------
-		// do everything in 1 pass. debug version. 
-		// return value should match size of buffer
-		static
-		size_t 
-		read(const std::string& filename, RawData& rd)
-		{
-			size_t totalRead = 0;
-			// these 3 structures make up the wave file header
-			WAVE_RIFF_HEADER m_wrh;	// 'RIFF' size 'WAVE'
-			WAVE_FORMAT_HEADER m_wfx;	// content format
-			WAVE_DATA_HEADER m_wdh;	// 'DATA' file size
-			FILE* fp = nullptr;
-#if _IS_WINDOWS
-			errno_t err = fopen_s(&fp, filename.c_str(), "rb");
-			u::throw_if(err != 0, "wav_rdr: could not open file");
-#else
-			fp = fopen(filename.c_str(), "rb");
-			//
-			u::throw_if(fp == nullptr, "wav_rdr: could not open file");
-#endif
-			// closer for file handle
-			nv2::u::FILECloser fc(fp);
-
-			do
-			{
-				size_t read = fread(&m_wrh, 1, sizeof(m_wrh), fp);
-				if (read != sizeof(m_wrh))
-					break;
-				read = fread(&m_wfx, 1, sizeof(m_wfx), fp);
-				if (read != sizeof(m_wfx))
-					break;
-				read = fread(&m_wdh, 1, sizeof(m_wdh), fp);
-				if (read != sizeof(m_wdh))
-					break;
-				// sanity checks
-				u::throw_if(m_wrh.dwRiff != RIFF_TAG, "Expecting RIFF");
-				u::throw_if(m_wrh.dwWave != WAVE_TAG, "Expecting WAVE");
-				u::throw_if(m_wrh.dwFormat != FMT__TAG, "Expecting fmt ");
-				u::throw_if(m_wrh.dwFormatLength != sizeof(m_wfx), "Bad wave format size");
-				u::throw_if(m_wdh.dwData != DATA_TAG, "Expecting data");
-				// we only support 16 bit data now.
-				if (m_wfx.wBitsPerSample != 16)
-					break;
-				//
-				//
-				rd.channels = m_wfx.nChannels;
-				rd.sampleRate = m_wfx.dwSampleRate;
-				rd.samples = m_wdh.dwDataLength / (m_wfx.wBitsPerSample / 8);
-				rd.buffer.assign(m_wdh.dwDataLength, 0);
-				//
-				size_t total = m_wdh.dwDataLength;
-				size_t chunksize = (4 * 1024);
-				unsigned char* pd = &rd.buffer[0];
-				//
-				for (;;)
-				{
-					size_t toWrite = (std::min)(total, chunksize);
-					size_t ret = fread(pd, 1, toWrite, fp);
-					if (ret == 0)
-					{
-						break;
-					}
-					if (ret != toWrite)
-					{
-						// error. throw
-						break;
-					}
-					total -= ret;
-					pd += ret;
-					totalRead += ret;
-				}
-				//
-			} while (0);
-			//
-			return totalRead;
-		}
-	}
-}
-
+/*
+
+
+
+
+
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <g40/nv2_util.h>
+#include <audio/audio_u.h>
+
+
+namespace nv2
+{
+	namespace wav
+	{
+		//-----------------------------------------------------------------------------
+		// 
+		//-----------------------------------------------------------------------------
+		// do everything in 1 pass.
+		// compact keeps the native 16 bit PCM, halving the resident size.
+		// SampleIterator and BlockCache convert to float a block at a time.
+		static
+		nv2::audio::SampleData 
+		read(const std::string& filename, int blockSize = (1024 * 1024), bool compact = false)
+		{
+
+			nv2::audio::SampleData wav_data;
+
+			// these 3 structures make up the wave file header
+			WAVE_RIFF_HEADER m_wrh{};	// 'RIFF' size 'WAVE'
+			WAVE_FORMAT_HEADER m_wfx{};	// content format
+			WAVE_DATA_HEADER m_wdh{};	// 'DATA' file size
+			FILE* fp = nullptr;
+#if _IS_WINDOWS
+			errno_t err = fopen_s(&fp, filename.c_str(), "rb");
+			u::throw_if(err != 0, "wav_rdr: could not open file");
+#else
+			fp = fopen(filename.c_str(), "rb");
+			//
+			u::throw_if(fp == nullptr, "wav_rdr: could not open file");
+#endif
+			
+			// closer for file handle
+			nv2::u::FILECloser fc(fp);
+
+			do
+			{
+				size_t read = fread(&m_wrh, 1, sizeof(m_wrh), fp);
+				if (read != sizeof(m_wrh))
+					break;
+				read = fread(&m_wfx, 1, sizeof(m_wfx), fp);
+				if (read != sizeof(m_wfx))
+					break;
+				read = fread(&m_wdh, 1, sizeof(m_wdh), fp);
+				if (read != sizeof(m_wdh))
+					break;
+
+				// sanity checks
+				u::throw_if(m_wrh.dwRiff != RIFF_TAG, "Expecting RIFF");
+				u::throw_if(m_wrh.dwWave != WAVE_TAG, "Expecting WAVE");
+				u::throw_if(m_wrh.dwFormat != FMT__TAG, "Expecting fmt ");
+				u::throw_if(m_wrh.dwFormatLength != sizeof(m_wfx), "Bad wave format size");
+				u::throw_if(m_wdh.dwData != DATA_TAG, "Expecting data");
+				// we only support 16 bit data now.
+				if (m_wfx.wBitsPerSample != 16)
+					break;
+				//
+				wav_data.blockSize = blockSize;
+				wav_data.channels = m_wfx.nChannels;
+				wav_data.sampleRate = m_wfx.dwSampleRate;
+				wav_data.samples = m_wdh.dwDataLength / (m_wfx.wBitsPerSample / 8);
+				if (compact)
+				{
+					// straight into the native buffer, no conversion
+					wav_data.pcm.assign(wav_data.samples, 0);
+					size_t bytes = wav_data.samples * sizeof(short);
+					size_t ret = (bytes ? fread(wav_data.pcm.data(), 1, bytes, fp) : 0);
+					if (ret != bytes)
+					{
+						// short read. keep what we have
+						wav_data.samples = (uint32_t)(ret / sizeof(short));
+						wav_data.pcm.resize(wav_data.samples);
+					}
+					break;
+				}
+				wav_data.buffer.assign(wav_data.samples, 0);
+
+				// float destination buffer
+				float* pdf = &wav_data.buffer[0];
+				// housekeeping for on the fly conversion
+				size_t total = (size_t) m_wdh.dwDataLength;
+				size_t chunksize = (4 * 1024);
+				std::vector<unsigned char> data(chunksize,0);
+				//
+				for (;;)
+				{
+					size_t toRead = (std::min)(total, chunksize);
+					// read the block
+					size_t ret = fread(&data[0], 1, toRead, fp);
+					if (ret == 0)
+					{
+						// ok. we read nothing
+						break;
+					}
+					if (ret != toRead)
+					{
+						// error
+						break;
+					}
+					// convert this chunk
+					const short* pc = (const short*)&data[0];
+					const short* pce = pc + (ret / sizeof(short));
+					while (pc < pce)
+					{
+						*pdf++ = u::convert(*pc++);
+					}
+					//
+					total -= ret;
+				}
+				//
+			} while (0);
+			//
+			return wav_data;
+		}
+
+		//-----------------------------------------------------------------------------
+		// interleaved raw sample data. no conversions. for debugging etc.
+		struct RawData
+		{
+			unsigned long samples = 0;
+			unsigned long channels = 0;
+			unsigned long sampleRate = 0;
+			// thus samples * channels in size
+			std::vector<unsigned char> buffer;
+		};
+
+		//-----------------------------------------------------------------------------
+		// do everything in 1 pass. debug version. 
+		// return value should match size of buffer
+		static
+		size_t 
+		read(const std::string& filename, RawData& rd)
+		{
+			size_t totalRead = 0;
+			// these 3 structures make up the wave file header
+			WAVE_RIFF_HEADER m_wrh;	// 'RIFF' size 'WAVE'
+			WAVE_FORMAT_HEADER m_wfx;	// content format
+			WAVE_DATA_HEADER m_wdh;	// 'DATA' file size
+			FILE* fp = nullptr;
+#if _IS_WINDOWS
+			errno_t err = fopen_s(&fp, filename.c_str(), "rb");
+			u::throw_if(err != 0, "wav_rdr: could not open file");
+#else
+			fp = fopen(filename.c_str(), "rb");
+			//
+			u::throw_if(fp == nullptr, "wav_rdr: could not open file");
+#endif
+			// closer for file handle
+			nv2::u::FILECloser fc(fp);
+
+			do
+			{
+				size_t read = fread(&m_wrh, 1, sizeof(m_wrh), fp);
+				if (read != sizeof(m_wrh))
+					break;
+				read = fread(&m_wfx, 1, sizeof(m_wfx), fp);
+				if (read != sizeof(m_wfx))
+					break;
+				read = fread(&m_wdh, 1, sizeof(m_wdh), fp);
+				if (read != sizeof(m_wdh))
+					break;
+				// sanity checks
+				u::throw_if(m_wrh.dwRiff != RIFF_TAG, "Expecting RIFF");
+				u::throw_if(m_wrh.dwWave != WAVE_TAG, "Expecting WAVE");
+				u::throw_if(m_wrh.dwFormat != FMT__TAG, "Expecting fmt ");
+				u::throw_if(m_wrh.dwFormatLength != sizeof(m_wfx), "Bad wave format size");
+				u::throw_if(m_wdh.dwData != DATA_TAG, "Expecting data");
+				// we only support 16 bit data now.
+				if (m_wfx.wBitsPerSample != 16)
+					break;
+				//
+				//
+				rd.channels = m_wfx.nChannels;
+				rd.sampleRate = m_wfx.dwSampleRate;
+				rd.samples = m_wdh.dwDataLength / (m_wfx.wBitsPerSample / 8);
+				rd.buffer.assign(m_wdh.dwDataLength, 0);
+				//
+				size_t total = m_wdh.dwDataLength;
+				size_t chunksize = (4 * 1024);
+				unsigned char* pd = &rd.buffer[0];
+				//
+				for (;;)
+				{
+					size_t toWrite = (std::min)(total, chunksize);
+					size_t ret = fread(pd, 1, toWrite, fp);
+					if (ret == 0)
+					{
+						break;
+					}
+					if (ret != toWrite)
+					{
+						// error. throw
+						break;
+					}
+					total -= ret;
+					pd += ret;
+					totalRead += ret;
+				}
+				//
+			} while (0);
+			//
+			return totalRead;
+		}
+
+		//-----------------------------------------------------------------------------
+		// streaming 16 bit reader. parses the same header as read() then
+		// hands out frames on demand, so long files need not fit in memory
+		class Reader
+		{
+			FILE* m_fp = nullptr;
+			size_t m_channels = 0;
+			size_t m_sampleRate = 0;
+			size_t m_frames = 0;
+			// file offset of the first sample
+			long long m_data = 0;
+			// next frame to read
+			size_t m_position = 0;
+			// conversion scratch
+			std::vector<short> m_pcm;
+			//
+			bool seek_bytes(long long offset)
+			{
+#if _IS_WINDOWS
+				return (_fseeki64(m_fp, offset, SEEK_SET) == 0);
+#else
+				return (fseeko(m_fp, (off_t)offset, SEEK_SET) == 0);
+#endif
+			}
+			// non-copyable
+			Reader(const Reader&) = delete;
+			Reader& operator=(const Reader&) = delete;
+		public:
+			//
+			Reader() {}
+			//
+			~Reader() { close(); }
+			// false for anything but a plain 16 bit PCM file
+			bool open(const std::string& filename)
+			{
+				close();
+				WAVE_RIFF_HEADER wrh{};
+				WAVE_FORMAT_HEADER wfx{};
+				WAVE_DATA_HEADER wdh{};
+#if _IS_WINDOWS
+				errno_t err = fopen_s(&m_fp, filename.c_str(), "rb");
+#else
+				m_fp = fopen(filename.c_str(), "rb");
+#endif
+				if (!m_fp)
+					return false;
+				bool ok = (fread(&wrh, 1, sizeof(wrh), m_fp) == sizeof(wrh)) &&
+							(fread(&wfx, 1, sizeof(wfx), m_fp) == sizeof(wfx)) &&
+							(fread(&wdh, 1, sizeof(wdh), m_fp) == sizeof(wdh));
+				ok = ok && wrh.dwRiff == RIFF_TAG && wrh.dwWave == WAVE_TAG && wrh.dwFormat == FMT__TAG;
+				ok = ok && wrh.dwFormatLength == sizeof(wfx) && wdh.dwData == DATA_TAG;
+				ok = ok && wfx.wBitsPerSample == 16 && wfx.nChannels > 0;
+				if (!ok)
+				{
+					close();
+					return false;
+				}
+				m_channels = wfx.nChannels;
+				m_sampleRate = wfx.dwSampleRate;
+				m_frames = wdh.dwDataLength / (sizeof(short) * m_channels);
+				m_data = (long long)(sizeof(wrh) + sizeof(wfx) + sizeof(wdh));
+				m_position = 0;
+				return true;
+			}
+			//
+			void close()
+			{
+				if (m_fp)
+				{
+					fclose(m_fp);
+					m_fp = nullptr;
+				}
+			}
+			//
+			bool isOpen() const { return (m_fp != nullptr); }
+			size_t channels() const { return m_channels; }
+			size_t sampleRate() const { return m_sampleRate; }
+			size_t frames() const { return m_frames; }
+			size_t position() const { return m_position; }
+			//
+			bool seek(size_t frame)
+			{
+				if (!m_fp)
+					return false;
+				frame = std::min(frame, m_frames);
+				if (!seek_bytes(m_data + (long long)(frame * m_channels * sizeof(short))))
+					return false;
+				m_position = frame;
+				return true;
+			}
+			// native samples, no conversion. returns frames read
+			size_t read(short* pcm, size_t frames)
+			{
+				if (!m_fp)
+					return 0;
+				frames = std::min(frames, m_frames - m_position);
+				size_t ret = fread(pcm, sizeof(short) * m_channels, frames, m_fp);
+				m_position += ret;
+				return ret;
+			}
+			// converted to float. channels beyond the file's are left alone
+			size_t read(const audio::InterleavedView<float>& op)
+			{
+				const size_t want = std::min(op.frames, m_frames - m_position);
+				if (m_pcm.size() < want * m_channels)
+					m_pcm.resize(want * m_channels);
+				const size_t ret = read(m_pcm.data(), want);
+				const size_t channels = std::min(m_channels, op.channels);
+				for (size_t f = 0; f < ret; f++)
+				{
+					const short* ps = m_pcm.data() + (f * m_channels);
+					float* pd = op.frame(f);
+					for (size_t c = 0; c < channels; c++)
+						pd[c] = u::convert(ps[c]);
+				}
+				return ret;
+			}
+		};
+	}
+}
+
@@ -1,113 +1,271 @@
-/*
-
-
-
-
-
-*/
-
-#pragma once
-
-#include <cstdio>
-#include <string>
-#include <vector>
-//#include "audio_util.h"
-#include <audio/audio_u.h>
-
-namespace nv2
-{
-	namespace wav
-	{
-			//-----------------------------------------------------------------------------
-			// do everything in 1 pass.
-			template <typename T>
-			bool write(const std::string& filename, const T& sd)
-			{	
-				bool ok = false;
-				// these 3 structures make up the wave file header
-				WAVE_RIFF_HEADER m_wrh;	// 'RIFF' size 'WAVE'
-				WAVE_FORMAT_HEADER m_wfx;	// content format
-				WAVE_DATA_HEADER m_wdh;	// 'DATA' file size
-				
-				// for clarity
-				size_t hdr_size = sizeof(m_wrh) + sizeof(m_wfx) + sizeof(m_wdh);
-				// samples is interleaved count recall
-				size_t pcm_size = sd.samples * sizeof(short);
-
-				m_wrh.dwRiff = RIFF_TAG;
-				m_wrh.dwFileSize = (unsigned long) (hdr_size + pcm_size - 8);
-				m_wrh.dwWave = WAVE_TAG;
-				m_wrh.dwFormat = FMT__TAG;
-				m_wrh.dwFormatLength = sizeof(WAVE_FORMAT_HEADER);
-
-				m_wfx.dwSampleRate = (unsigned long)sd.sampleRate;
-				m_wfx.nChannels = (unsigned short) sd.channels;
-				m_wfx.wBitsPerSample = 16;
-				m_wfx.wFormat = WAVE_FORMAT_PCM;
-				m_wfx.wBlockAlign = (m_wfx.nChannels == 1 ? 2 : 4);	// always 4 for 16 bit samples ?
-				m_wfx.dwBytesPerSec = m_wfx.nChannels * m_wfx.dwSampleRate * (m_wfx.wBitsPerSample / 8);
-
-				m_wdh.dwData = DATA_TAG;
-				m_wdh.dwDataLength = (unsigned long) pcm_size;
-
-				FILE* fp = nullptr;
-				errno_t err = fopen_s(&fp, filename.c_str(), "wb");
-				if (!fp)
-					return ok;
-				do
-				{
-					size_t ret = fwrite(&m_wrh, 1, sizeof(m_wrh), fp);
-					if (ret != sizeof(m_wrh))
-						break;
-					ret = fwrite(&m_wfx, 1, sizeof(m_wfx), fp);
-					if (ret != sizeof(m_wfx))
-						break;
-					ret = fwrite(&m_wdh, 1, sizeof(m_wdh), fp);
-					if (ret != sizeof(m_wdh))
-						break;
-						
-					// set up source pointers for writing
-					const float* psf = sd.begin();
-					const float* pcf = psf;
-					const float* pef = psf + sd.samples;
-
-					// arbitrary but should match host file system
-					size_t chunksize = (4 * 1024);
-					// conversion buffer
-					std::vector<unsigned char> bytes(chunksize, 0);
-					// switch units from samples to bytes
-					size_t totalBytesToWrite = (size_t)(sd.samples * sizeof(short));
-					for (;;)
-					{
-						// write in chunks to file
-						size_t toWrite = (std::min)(totalBytesToWrite, chunksize);
-						// float => *short*
-						short* pc = (short*) &bytes[0];
-						const short* pce = pc + (toWrite / sizeof(short));
-						while (pc < pce)
-						{
-							*pc++ = u::convert(*pcf++);
-						}
-						// write the converted chunk
-						size_t ret = fwrite(&bytes[0], 1, toWrite, fp);
-						if (ret == 0)
-						{
-							//
-							ok = true;
-							break;
-						}
-						if (ret != toWrite)
-						{
-							// error ...
-							break;
-						}
-						totalBytesToWrite -= ret;
-					}
-				} while (0);
-				//
-				fclose(fp);
-				//
-				return ok;
-			}
-	}
-}
+/*
+
+
+
+
+
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+//#include "audio_util.h"
+#include <audio/audio_u.h>
+
+namespace nv2
+{
+	namespace wav
+	{
+			//-----------------------------------------------------------------------------
+			// write the 3 header structures. samples is interleaved count
+			inline bool write_header(FILE* fp, size_t channels, size_t sampleRate, size_t samples)
+			{
+				// these 3 structures make up the wave file header
+				WAVE_RIFF_HEADER m_wrh;	// 'RIFF' size 'WAVE'
+				WAVE_FORMAT_HEADER m_wfx;	// content format
+				WAVE_DATA_HEADER m_wdh;	// 'DATA' file size
+				
+				// for clarity
+				size_t hdr_size = sizeof(m_wrh) + sizeof(m_wfx) + sizeof(m_wdh);
+				// samples is interleaved count recall
+				size_t pcm_size = samples * sizeof(short);
+
+				m_wrh.dwRiff = RIFF_TAG;
+				m_wrh.dwFileSize = (unsigned long) (hdr_size + pcm_size - 8);
+				m_wrh.dwWave = WAVE_TAG;
+				m_wrh.dwFormat = FMT__TAG;
+				m_wrh.dwFormatLength = sizeof(WAVE_FORMAT_HEADER);
+
+				m_wfx.dwSampleRate = (unsigned long)sampleRate;
+				m_wfx.nChannels = (unsigned short) channels;
+				m_wfx.wBitsPerSample = 16;
+				m_wfx.wFormat = WAVE_FORMAT_PCM;
+				m_wfx.wBlockAlign = (m_wfx.nChannels == 1 ? 2 : 4);	// always 4 for 16 bit samples ?
+				m_wfx.dwBytesPerSec = m_wfx.nChannels * m_wfx.dwSampleRate * (m_wfx.wBitsPerSample / 8);
+
+				m_wdh.dwData = DATA_TAG;
+				m_wdh.dwDataLength = (unsigned long) pcm_size;
+
+				size_t ret = fwrite(&m_wrh, 1, sizeof(m_wrh), fp);
+				if (ret != sizeof(m_wrh))
+					return false;
+				ret = fwrite(&m_wfx, 1, sizeof(m_wfx), fp);
+				if (ret != sizeof(m_wfx))
+					return false;
+				ret = fwrite(&m_wdh, 1, sizeof(m_wdh), fp);
+				if (ret != sizeof(m_wdh))
+					return false;
+				return true;
+			}
+
+			//-----------------------------------------------------------------------------
+			// do everything in 1 pass.
+			template <typename T>
+			bool write(const std::string& filename, const T& sd)
+			{	
+				bool ok = false;
+				// float storage only, the SampleData overload expands compact data
+				if (sd.samples && sd.begin() == sd.end())
+					return ok;
+				FILE* fp = nullptr;
+				errno_t err = fopen_s(&fp, filename.c_str(), "wb");
+				if (!fp)
+					return ok;
+				do
+				{
+					if (!write_header(fp, sd.channels, sd.sampleRate, sd.samples))
+						break;
+						
+					// set up source pointers for writing
+					const float* psf = sd.begin();
+					const float* pcf = psf;
+					const float* pef = psf + sd.samples;
+
+					// arbitrary but should match host file system
+					size_t chunksize = (4 * 1024);
+					// conversion buffer
+					std::vector<unsigned char> bytes(chunksize, 0);
+					// switch units from samples to bytes
+					size_t totalBytesToWrite = (size_t)(sd.samples * sizeof(short));
+					for (;;)
+					{
+						// write in chunks to file
+						size_t toWrite = (std::min)(totalBytesToWrite, chunksize);
+						// float => *short*
+						short* pc = (short*) &bytes[0];
+						const short* pce = pc + (toWrite / sizeof(short));
+						while (pc < pce)
+						{
+							*pc++ = u::convert(*pcf++);
+						}
+						// write the converted chunk
+						size_t ret = fwrite(&bytes[0], 1, toWrite, fp);
+						if (ret == 0)
+						{
+							//
+							ok = true;
+							break;
+						}
+						if (ret != toWrite)
+						{
+							// error ...
+							break;
+						}
+						totalBytesToWrite -= ret;
+					}
+				} while (0);
+				//
+				fclose(fp);
+				//
+				return ok;
+			}
+
+			//-----------------------------------------------------------------------------
+			// write any interleaved view, e.g. a slice or a subset of channels
+			inline bool write(const std::string& filename, const audio::SampleView& sv, size_t sampleRate)
+			{
+				bool ok = false;
+				FILE* fp = nullptr;
+#if _IS_WINDOWS
+				errno_t err = fopen_s(&fp, filename.c_str(), "wb");
+#else
+				fp = fopen(filename.c_str(), "wb");
+#endif
+				if (!fp)
+					return ok;
+				// closer for file handle
+				nv2::u::FILECloser fc(fp);
+				if (!write_header(fp, sv.channels, sampleRate, sv.frames * sv.channels))
+					return ok;
+				// arbitrary but should match host file system
+				const size_t chunkFrames = (4 * 1024) / (sizeof(short) * std::max<size_t>(sv.channels, 1));
+				std::vector<short> bytes(chunkFrames * sv.channels, 0);
+				for (size_t f = 0; f < sv.frames; f += chunkFrames)
+				{
+					const size_t frames = std::min(chunkFrames, sv.frames - f);
+					short* pc = bytes.data();
+					for (size_t s = 0; s < frames; s++)
+					{
+						const float* pf = sv.frame(f + s);
+						for (size_t c = 0; c < sv.channels; c++)
+							*pc++ = u::convert(pf[c]);
+					}
+					size_t toWrite = frames * sv.channels * sizeof(short);
+					if (fwrite(bytes.data(), 1, toWrite, fp) != toWrite)
+						return ok;
+				}
+				ok = true;
+				return ok;
+			}
+
+			//-----------------------------------------------------------------------------
+			// compact data is expanded into a temporary before writing
+			inline bool write(const std::string& filename, const audio::SampleData& sd)
+			{
+				if (!sd.compact())
+					return write<audio::SampleData>(filename, sd);
+				audio::SampleData tmp = sd;
+				tmp.expand();
+				return write<audio::SampleData>(filename, tmp);
+			}
+
+			//-----------------------------------------------------------------------------
+			// streaming 16 bit writer for data that arrives a block at a time.
+			// converted samples are gathered into one large buffer so the disk
+			// sees big sequential writes. the header is patched on close()
+			class Writer
+			{
+				FILE* m_fp = nullptr;
+				size_t m_channels = 0;
+				size_t m_sampleRate = 0;
+				// interleaved samples written so far
+				size_t m_samples = 0;
+				//
+				std::vector<short> m_buffer;
+				size_t m_used = 0;
+				bool m_ok = false;
+				//
+				bool flush()
+				{
+					if (m_used && m_fp)
+					{
+						const size_t bytes = m_used * sizeof(short);
+						m_ok = m_ok && (fwrite(m_buffer.data(), 1, bytes, m_fp) == bytes);
+						m_used = 0;
+					}
+					return m_ok;
+				}
+				// non-copyable
+				Writer(const Writer&) = delete;
+				Writer& operator=(const Writer&) = delete;
+			public:
+				//
+				Writer() {}
+				//
+				~Writer() { close(); }
+				// writeBytes is the size of each disk write
+				bool open(const std::string& filename, size_t channels, size_t sampleRate, size_t writeBytes = (256 * 1024))
+				{
+					close();
+#if _IS_WINDOWS
+					errno_t err = fopen_s(&m_fp, filename.c_str(), "wb");
+#else
+					m_fp = fopen(filename.c_str(), "wb");
+#endif
+					if (!m_fp)
+						return false;
+					m_channels = std::max<size_t>(channels, 1);
+					m_sampleRate = sampleRate;
+					m_samples = 0;
+					m_used = 0;
+					// whole frames per write
+					const size_t frames = std::max<size_t>(writeBytes / (sizeof(short) * m_channels), 1);
+					m_buffer.assign(frames * m_channels, 0);
+					// sizes are filled in by close()
+					m_ok = write_header(m_fp, m_channels, m_sampleRate, 0);
+					return m_ok;
+				}
+				//
+				bool isOpen() const { return (m_fp != nullptr); }
+				// false once any write has failed
+				bool ok() const { return m_ok; }
+				// frames accepted so far
+				size_t frames() const { return m_samples / std::max<size_t>(m_channels, 1); }
+				// channels beyond the file's are dropped, missing ones are silent
+				bool write(const audio::SampleView& sv)
+				{
+					if (!m_fp)
+						return false;
+					for (size_t f = 0; f < sv.frames; f++)
+					{
+						if (m_used == m_buffer.size() && !flush())
+							return false;
+						const float* pf = sv.frame(f);
+						short* pc = m_buffer.data() + m_used;
+						for (size_t c = 0; c < m_channels; c++)
+							pc[c] = (c < sv.channels ? u::convert(pf[c]) : short(0));
+						m_used += m_channels;
+						m_samples += m_channels;
+					}
+					return m_ok;
+				}
+				// flush, fix up the header and close. returns false if
+				// anything failed along the way
+				bool close()
+				{
+					if (!m_fp)
+						return false;
+					flush();
+					if (fseek(m_fp, 0, SEEK_SET) == 0)
+						m_ok = write_header(m_fp, m_channels, m_sampleRate, m_samples) && m_ok;
+					else
+						m_ok = false;
+					m_ok = (fclose(m_fp) == 0) && m_ok;
+					m_fp = nullptr;
+					return m_ok;
+				}
+			};
+	}
+}
@@ -0,0 +1,321 @@
+/*
+
+	Visit https://github.com/g40
+
+	Copyright (c) Jerry Evans, 1999-2024
+
+	All rights reserved.
+
+	The MIT License (MIT)
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+
+
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <audio/audio_u.h>
+#include <audio/ring_buffer.h>
+#include <audio/rt_metrics.h>
+#include <audio/rt_thread.h>
+#include <audio/rtaudio.hpp>
+
+#if !_IS_WINDOWS
+#include <semaphore.h>
+#include <cerrno>
+#endif
+
+namespace nv2
+{
+	namespace audio
+	{
+		//-----------------------------------------------------------------------------
+		// counting wake up. post() is a single atomic add unless the other
+		// side is actually asleep, so safe to call from the audio callback
+		class Wakeup
+		{
+			// negative while a waiter sleeps
+			std::atomic<int> m_count{ 0 };
+#if _IS_WINDOWS
+			HANDLE m_sem = NULL;
+			void os_post() { ReleaseSemaphore(m_sem, 1, NULL); }
+			void os_wait() { WaitForSingleObject(m_sem, INFINITE); }
+#else
+			sem_t m_sem;
+			void os_post() { sem_post(&m_sem); }
+			void os_wait() { while (sem_wait(&m_sem) != 0 && errno == EINTR) {} }
+#endif
+			// non-copyable
+			Wakeup(const Wakeup&) = delete;
+			Wakeup& operator=(const Wakeup&) = delete;
+		public:
+			//
+			Wakeup()
+			{
+#if _IS_WINDOWS
+				m_sem = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL);
+#else
+				sem_init(&m_sem, 0, 0);
+#endif
+			}
+			//
+			~Wakeup()
+			{
+#if _IS_WINDOWS
+				CloseHandle(m_sem);
+#else
+				sem_destroy(&m_sem);
+#endif
+			}
+			//
+			void post()
+			{
+				if (m_count.fetch_add(1, std::memory_order_release) < 0)
+					os_post();
+			}
+			//
+			void wait()
+			{
+				if (m_count.fetch_sub(1, std::memory_order_acquire) <= 0)
+					os_wait();
+			}
+		};
+
+		//-----------------------------------------------------------------------------
+		// runs a processor on its own thread, 'periods' blocks ahead of the
+		// callback. the callback only moves audio through a pair of rings
+		// and posts a wake up, so a heavy chain gets the whole lookahead
+		// to finish instead of one buffer period. costs periods * frames of
+		// extra latency.
+		template <typename T = float>
+		class WorkerProcessor : public IDuplexProcessor<T>
+		{
+		public:
+			//
+			using base_t = IDuplexProcessor<T>;
+			using typename base_t::ipview_t;
+			using typename base_t::opview_t;
+			//
+			struct Options
+			{
+				// blocks of lookahead, i.e. added latency. at least 1
+				unsigned int periods = 2;
+				// applied to the worker thread on start up, off unless set
+				RtHardening hardening;
+			};
+			// worker deadline statistics
+			struct Stats
+			{
+				// worker timing, load is against the block period
+				CallbackMetrics::Snapshot worker;
+				// frames queued ahead of the callback when the worker
+				// finished a block. 0 means it only just made it
+				size_t minSlack = 0;
+				double meanSlack = 0;
+				// callback found less output than it needed
+				uint64_t underruns = 0;
+				// no room for callback input, the worker fell behind
+				uint64_t overflows = 0;
+			};
+
+		private:
+			//
+			base_t* m_processor = nullptr;
+			unsigned int m_ipChannels = 0;
+			unsigned int m_opChannels = 0;
+			unsigned int m_frames = 0;
+			Options m_options;
+			// what the worker thread applied
+			RtHardeningReport m_report;
+			//
+			InterleavedRing<T> m_ipRing;
+			InterleavedRing<T> m_opRing;
+			// worker block buffers
+			std::vector<T> m_ip;
+			std::vector<T> m_op;
+			//
+			Wakeup m_wakeup;
+			std::thread m_thread;
+			std::atomic<bool> m_running{ false };
+			// latest from the callback
+			std::atomic<unsigned int> m_sampleRate{ 0 };
+			std::atomic<unsigned int> m_status{ 0 };
+			// stats
+			CallbackMetrics m_metrics;
+			std::atomic<size_t> m_minSlack{ size_t(-1) };
+			std::atomic<double> m_meanSlack{ 0 };
+			std::atomic<uint64_t> m_underruns{ 0 };
+			std::atomic<uint64_t> m_overflows{ 0 };
+			//
+			//
+			static Options checked(Options options)
+			{
+				options.periods = std::max(options.periods, 1u);
+				return options;
+			}
+			//
+			void work()
+			{
+				if (m_options.hardening.enabled())
+					rt::hardenThread(m_options.hardening, m_report);
+				const ipview_t ip(m_ip.data(), m_frames, m_ipChannels);
+				const opview_t op(m_op.data(), m_frames, m_opChannels);
+				uint64_t blocks = 0;
+				// the worker's own clock, 'periods' ahead of the stream's
+				double streamTime = 0;
+				for (;;)
+				{
+					m_wakeup.wait();
+					if (!m_running.load(std::memory_order_acquire))
+						break;
+					// catch up with everything the callback has queued
+					while (m_ipRing.readable() >= m_frames && m_opRing.writable() >= m_frames)
+					{
+						m_ipRing.read(InterleavedView<T>(m_ip.data(), m_frames, m_ipChannels));
+						std::fill(m_op.begin(), m_op.end(), T(0));
+						const unsigned int sampleRate = m_sampleRate.load(std::memory_order_relaxed);
+						const RtAudioStreamStatus status = m_status.exchange(0, std::memory_order_relaxed);
+						CallbackMetrics::clock_t::time_point start = m_metrics.begin();
+						m_processor->process(ip, op, sampleRate, streamTime, status);
+						m_metrics.end(start, m_frames, sampleRate, streamTime,
+							(status & RTAUDIO_INPUT_OVERFLOW) != 0,
+							(status & RTAUDIO_OUTPUT_UNDERFLOW) != 0);
+						// how far ahead of the callback we still are
+						const size_t slack = m_opRing.size();
+						if (slack < m_minSlack.load(std::memory_order_relaxed))
+							m_minSlack.store(slack, std::memory_order_relaxed);
+						blocks++;
+						const double mean = m_meanSlack.load(std::memory_order_relaxed);
+						m_meanSlack.store(blocks == 1 ? double(slack) : mean + 0.05 * (double(slack) - mean), std::memory_order_relaxed);
+						m_opRing.write(ipview_t(m_op.data(), m_frames, m_opChannels));
+						streamTime += (sampleRate ? double(m_frames) / sampleRate : 0.0);
+					}
+				}
+			}
+			// non-copyable
+			WorkerProcessor(const WorkerProcessor&) = delete;
+			WorkerProcessor& operator=(const WorkerProcessor&) = delete;
+
+		public:
+			// frames is the block size handed to the processor, normally the
+			// stream buffer size. the worker starts straight away
+			WorkerProcessor(base_t* processor,
+							unsigned int ipChannels,
+							unsigned int opChannels,
+							unsigned int frames,
+							const Options& options = Options()) :
+				m_processor(processor),
+				m_ipChannels(ipChannels),
+				m_opChannels(opChannels),
+				m_frames(std::max(frames, 1u)),
+				m_options(checked(options)),
+				m_ipRing(size_t(m_frames) * (m_options.periods + 2), ipChannels),
+				m_opRing(size_t(m_frames) * (m_options.periods + 2), opChannels),
+				m_ip(size_t(m_frames) * ipChannels, T(0)),
+				m_op(size_t(m_frames) * opChannels, T(0))
+			{
+				// the lookahead starts out as silence
+				std::vector<T> silence(size_t(m_frames) * m_options.periods * opChannels, T(0));
+				m_opRing.write(ipview_t(silence.data(), size_t(m_frames) * m_options.periods, opChannels));
+				m_running.store(true);
+				m_thread = std::thread([this]() { work(); });
+			}
+			//
+			virtual ~WorkerProcessor()
+			{
+				m_running.store(false, std::memory_order_release);
+				m_wakeup.post();
+				if (m_thread.joinable())
+					m_thread.join();
+			}
+			// frames of delay added on top of the stream's own
+			size_t latency() const
+			{
+				return size_t(m_frames) * m_options.periods;
+			}
+			// any thread
+			Stats stats() const
+			{
+				Stats ret;
+				ret.worker = m_metrics.snapshot();
+				const size_t minSlack = m_minSlack.load(std::memory_order_relaxed);
+				ret.minSlack = (minSlack == size_t(-1) ? 0 : minSlack);
+				ret.meanSlack = m_meanSlack.load(std::memory_order_relaxed);
+				ret.underruns = m_underruns.load(std::memory_order_relaxed);
+				ret.overflows = m_overflows.load(std::memory_order_relaxed);
+				return ret;
+			}
+			// which hardening steps the worker thread applied, filled in
+			// once it has started
+			const RtHardeningReport& hardening() const
+			{
+				return m_report;
+			}
+			//
+			virtual void prefault()
+			{
+				m_processor->prefault();
+			}
+			// callback side. input in, output out, wake the worker
+			virtual int process(const ipview_t& ip,
+								const opview_t& op,
+								unsigned int sampleRate,
+								double streamTime,
+								RtAudioStreamStatus status)
+			{
+				m_sampleRate.store(sampleRate, std::memory_order_relaxed);
+				if (status)
+					m_status.fetch_or(status, std::memory_order_relaxed);
+				if (m_ipRing.write(ip) < ip.frames)
+					m_overflows.fetch_add(1, std::memory_order_relaxed);
+				const size_t got = m_opRing.read(op);
+				if (got < op.frames)
+				{
+					m_underruns.fetch_add(1, std::memory_order_relaxed);
+					for (size_t f = got; f < op.frames; f++)
+						for (size_t c = 0; c < op.channels; c++)
+							op.at(f, c) = T(0);
+				}
+				m_wakeup.post();
+				return 0;
+			}
+			//
+			virtual int process(T* outputBuffer,
+								T* inputBuffer,
+								unsigned int samples,
+								unsigned int ipChannels,
+								unsigned int opChannels,
+								unsigned int sampleRate,
+								double streamTime,
+								RtAudioStreamStatus status)
+			{
+				return process(ipview_t(inputBuffer, samples, ipChannels),
+								opview_t(outputBuffer, samples, opChannels),
+								sampleRate,
+								streamTime,
+								status);
+			}
+			using base_t::process;
+		};
+	}
+}
@@ -1,43 +1,655 @@
-/*
-
-    Visit https://github.com/g40
-
-    Copyright (c) Jerry Evans, 1999-2024
-
-    All rights reserved.
-
-    The MIT License (MIT)
-
-    Permission is hereby granted, free of charge, to any person obtaining a copy
-    of this software and associated documentation files (the "Software"), to deal
-    in the Software without restriction, including without limitation the rights
-    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-    copies of the Software, and to permit persons to whom the Software is
-    furnished to do so, subject to the following conditions:
-
-    The above copyright notice and this permission notice shall be included in
-    all copies or substantial portions of the Software.
-
-    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-    THE SOFTWARE.
-
-
-
-*/
-
-#include <g40/nv2_util.h>
-
-namespace g40
-{
-
-	static
-		void test() {
-
-	}
-}
-
+/*
+
+    Visit https://github.com/g40
+
+    Copyright (c) Jerry Evans, 1999-2024
+
+    All rights reserved.
+
+    The MIT License (MIT)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+
+
+
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <g40/nv2_util.h>
+#include <audio/rs4.h>
+#include <audio/ring_buffer.h>
+#include <audio/block_pool.h>
+#include <audio/fft.h>
+#include <audio/convolver.h>
+#include <audio/stft.h>
+#include <audio/reblock.h>
+#include <audio/recorder.h>
+#include <audio/wav_rdr.h>
+
+namespace g40
+{
+	using namespace nv2::audio;
+
+	//-----------------------------------------------------------------------------
+	// report one check, returns 1 on failure
+	static
+		int check(const char* name, bool ok)
+	{
+		printf("%s %s\n", ok ? "pass" : "FAIL", name);
+		return (ok ? 0 : 1);
+	}
+
+	//-----------------------------------------------------------------------------
+	// quality requests are applied inside process() and must neither
+	// allocate nor compute a sinc table, down and back up again, with and
+	// without a varying ratio
+	static
+		int test_rs4_request()
+	{
+		int failed = 0;
+		for (bool vary : { false, true })
+		{
+			RS4 rs;
+			rs.assign(2, 44100, 48000, 10);
+			if (vary)
+				rs.vary(0.005);
+			std::vector<float> ip(512 * 2), op(1024 * 2);
+			size_t before = 0;
+			size_t builds = 0;
+			bool ok = true;
+			for (size_t b = 0; b < 64; b++)
+			{
+				for (size_t f = 0; f < 512; f++)
+					ip[(f * 2)] = ip[(f * 2) + 1] = float(std::sin(double((b * 512) + f) * 0.05));
+				if (b % 8 == 2)
+					rs.request((b / 8) % 2 ? 10 : 3);
+				if (b % 8 == 6)
+					rs.request(0);
+				rs.process(SampleView(ip.data(), 512, 2), InterleavedView<float>(op.data(), 1024, 2));
+				if (b == 0)
+				{
+					before = RS4::allocations();
+					builds = RS4::tableBuilds();
+				}
+				if (b % 8 == 2)
+					ok = ok && (rs.quality() == ((b / 8) % 2 ? 10u : 3u));
+			}
+			failed += check(vary ? "rs4 request quality, varying ratio" : "rs4 request quality", ok);
+			failed += check(vary ? "rs4 request no allocation, varying ratio" : "rs4 request no allocation", RS4::allocations() == before);
+			failed += check(vary ? "rs4 request no table build, varying ratio" : "rs4 request no table build", RS4::tableBuilds() == builds);
+		}
+		return failed;
+	}
+
+	//-----------------------------------------------------------------------------
+	// SPSC rings: capacity rounding, full and empty, and a running count
+	// pushed through in uneven pieces so every offset wraps many times.
+	// then the same across 2 threads
+	static
+		int test_rings()
+	{
+		const size_t channels = 2;
+		int failed = 0;
+		{
+			InterleavedRing<float> ring(100, channels);
+			PlanarRing<float> planar(100, channels);
+			failed += check("ring capacity", ring.capacity() == 128 && planar.capacity() == 128 && ring.writable() == 128);
+			std::vector<float> ip(200 * channels), op(200 * channels);
+			for (size_t k = 0; k < ip.size(); k++)
+				ip[k] = float(k);
+			const size_t in = ring.write(SampleView(ip.data(), 200, channels));
+			const size_t over = ring.write(SampleView(ip.data(), 1, channels));
+			const size_t out = ring.read(InterleavedView<float>(op.data(), 200, channels));
+			const size_t under = ring.read(InterleavedView<float>(op.data(), 1, channels));
+			bool ok = (in == 128 && over == 0 && out == 128 && under == 0 && ring.readable() == 0 && ring.writable() == 128);
+			for (size_t k = 0; ok && k < 128 * channels; k++)
+				ok = (op[k] == float(k));
+			failed += check("ring full and empty", ok);
+		}
+		// both rings, interleaved and planar ends, uneven writes and reads
+		{
+			InterleavedRing<float> ring(64, channels);
+			PlanarRing<float> planar(64, channels);
+			std::vector<float> ip(64 * channels), op(64 * channels), pl(64 * channels);
+			std::vector<float*> pp = { pl.data(), pl.data() + 64 };
+			size_t written = 0;
+			size_t read = 0;
+			size_t wraps = 0;
+			bool ok = true;
+			for (size_t i = 0; ok && i < 1000; i++)
+			{
+				const size_t w = ((i * 7) + 3) % 61;
+				for (size_t f = 0; f < w; f++)
+					for (size_t c = 0; c < channels; c++)
+						ip[(f * channels) + c] = float(((written + f) * channels) + c);
+				const size_t n = ring.write(SampleView(ip.data(), w, channels));
+				ok = (planar.write(SampleView(ip.data(), n, channels)) == n);
+				written += n;
+				const size_t r = ((i * 11) + 5) % 53;
+				if (ring.read_region(r).second.frames)
+					wraps++;
+				const size_t got = ring.read(InterleavedView<float>(op.data(), r, channels));
+				ok = ok && (planar.read(PlanarView<float>(pp.data(), r, channels)) == got);
+				for (size_t f = 0; ok && f < got; f++)
+				{
+					for (size_t c = 0; c < channels; c++)
+					{
+						const float v = float(((read + f) * channels) + c);
+						ok = (op[(f * channels) + c] == v && pp[c][f] == v);
+					}
+				}
+				read += got;
+				ok = ok && (ring.readable() == written - read && planar.readable() == written - read);
+			}
+			failed += check("ring wrap-around", ok && wraps > 0 && read > 10000);
+		}
+		// producer and consumer on their own threads
+		{
+			const size_t total = 200000;
+			InterleavedRing<float> ring(256, 1);
+			std::thread producer([&]() {
+				std::vector<float> ip(97);
+				for (size_t pos = 0; pos < total; )
+				{
+					const size_t n = std::min(ip.size(), total - pos);
+					for (size_t f = 0; f < n; f++)
+						ip[f] = float(pos + f);
+					pos += ring.write(SampleView(ip.data(), n, 1));
+				}
+			});
+			std::vector<float> op(131);
+			size_t pos = 0;
+			bool ok = true;
+			while (pos < total)
+			{
+				const size_t got = ring.read(InterleavedView<float>(op.data(), op.size(), 1));
+				for (size_t f = 0; f < got; f++)
+					ok = ok && (op[f] == float(pos + f));
+				pos += got;
+			}
+			producer.join();
+			failed += check("ring across threads", ok && ring.readable() == 0);
+		}
+		return failed;
+	}
+
+	//-----------------------------------------------------------------------------
+	// MPMC queue: capacity rounding, full and empty, FIFO order through
+	// many wraps, then every element exactly once from 2 producers into 2
+	// consumers
+	static
+		int test_mpmc()
+	{
+		int failed = 0;
+		MpmcQueue<size_t> queue(5);
+		bool ok = (queue.capacity() == 8);
+		for (size_t i = 0; i < 8; i++)
+			ok = ok && queue.push(i);
+		size_t v = 99;
+		ok = ok && !queue.push(v) && v == 99;
+		for (size_t i = 0; i < 8; i++)
+			ok = ok && queue.pop(v) && v == i;
+		ok = ok && !queue.pop(v);
+		failed += check("mpmc capacity, full and empty", ok);
+		ok = true;
+		size_t next = 0;
+		size_t expect = 0;
+		for (size_t i = 0; ok && i < 1000; i++)
+		{
+			for (size_t k = 0; k < (i % 7) + 1 && queue.push(next); k++)
+				next++;
+			for (size_t k = 0; k < (i % 5) + 1 && queue.pop(v); k++)
+				ok = (v == expect++);
+		}
+		while (ok && queue.pop(v))
+			ok = (v == expect++);
+		failed += check("mpmc wrap-around order", ok && expect == next && next > 1000);
+		const size_t per = 50000;
+		std::atomic<size_t> popped{ 0 };
+		std::atomic<uint64_t> sum{ 0 };
+		std::vector<std::thread> threads;
+		for (size_t p = 0; p < 2; p++)
+		{
+			threads.emplace_back([&, p]() {
+				for (size_t i = 0; i < per; i++)
+					while (!queue.push((p * per) + i + 1))
+						std::this_thread::yield();
+			});
+			threads.emplace_back([&]() {
+				size_t e = 0;
+				while (popped.load() < per * 2)
+				{
+					if (queue.pop(e))
+					{
+						sum += e;
+						popped++;
+					}
+					else
+						std::this_thread::yield();
+				}
+			});
+		}
+		for (auto& t : threads)
+			t.join();
+		const uint64_t n = per * 2;
+		failed += check("mpmc across threads", popped == n && sum == (n * (n + 1)) / 2 && !queue.pop(v));
+		return failed;
+	}
+
+	//-----------------------------------------------------------------------------
+	// block pool: exhaustion gives an empty handle and is counted, handles
+	// return their block when reset, moved or dropped, and blocks taken
+	// and given back on several threads are never handed out twice
+	static
+		int test_pool()
+	{
+		int failed = 0;
+		SampleBlockPool pool(4, 64, 2);
+		{
+			std::vector<SampleBlockPool::Handle> held;
+			for (size_t i = 0; i < 4; i++)
+				held.push_back(pool.acquire());
+			SampleBlockPool::Handle none = pool.acquire();
+			bool ok = (!none && pool.available() == 0 && pool.stats().failed == 1);
+			for (size_t i = 0; ok && i < 4; i++)
+				for (size_t j = i + 1; ok && j < 4; j++)
+					ok = (held[i] && held[j] && held[i].get() != held[j].get());
+			failed += check("pool exhaustion", ok);
+			// moved handles own the block once
+			SampleBlockPool::Handle moved = std::move(held[0]);
+			ok = (!held[0] && moved && pool.available() == 0);
+			held[1].reset();
+			ok = ok && (pool.available() == 1 && !held[1]);
+			moved = std::move(held[2]);
+			ok = ok && (pool.available() == 2);
+			held[1] = pool.acquire();
+			ok = ok && held[1] && (pool.available() == 1);
+			failed += check("pool handles", ok);
+		}
+		SampleBlockPool::Stats st = pool.stats();
+		failed += check("pool stats", pool.available() == 4 && st.inUse == 0 && st.highWater == 4 && st.capacity == 4);
+		// each thread stamps what it holds and checks nobody else wrote it
+		std::atomic<bool> ok{ true };
+		std::vector<std::thread> threads;
+		for (size_t t = 0; t < 3; t++)
+		{
+			threads.emplace_back([&, t]() {
+				for (size_t i = 0; i < 20000; i++)
+				{
+					SampleBlockPool::Handle a = pool.acquire();
+					SampleBlockPool::Handle b = pool.acquire();
+					const float stamp = float((t * 100000) + i);
+					if (a)
+						a->data()[0][0] = stamp;
+					if (b)
+						b->data()[1][63] = stamp;
+					std::this_thread::yield();
+					if ((a && a->data()[0][0] != stamp) || (b && b->data()[1][63] != stamp))
+						ok = false;
+				}
+			});
+		}
+		for (auto& t : threads)
+			t.join();
+		st = pool.stats();
+		failed += check("pool across threads", ok && pool.available() == 4 && st.inUse == 0 && st.highWater == 4);
+		return failed;
+	}
+
+	//-----------------------------------------------------------------------------
+	// deterministic noise in +/-1
+	static
+		float noise(uint32_t& seed)
+	{
+		seed = (seed * 1664525u) + 1013904223u;
+		return (float(seed >> 8) / float(1 << 23)) - 1.0f;
+	}
+
+	//-----------------------------------------------------------------------------
+	// every size from 64 to 65536: complex against a direct DFT up to
+	// 1024 points, real against complex, a strided batch against single
+	// calls and forward then inverse back to the input. prints the time
+	// per transform
+	static
+		int test_fft()
+	{
+		const double pi = 3.14159265358979323846;
+		int failed = 0;
+		uint32_t seed = 1;
+		for (size_t n = 64; n <= 65536; n *= 2)
+		{
+			FFT cf(n, FFTPlan::eComplex);
+			FFT rf(n, FFTPlan::eReal);
+			std::vector<float> x(n * 2), y(n * 2), z(n * 2), r(n), rb((n / 2 + 1) * 2);
+			for (auto& v : x)
+				v = noise(seed);
+			for (size_t k = 0; k < n; k++)
+				r[k] = x[2 * k];
+			double err = 0;
+			double mag = 0;
+			// complex against a direct DFT
+			cf.forward(x.data(), y.data());
+			if (n <= 1024)
+			{
+				for (size_t k = 0; k < n; k++)
+				{
+					double sr = 0, si = 0;
+					for (size_t t = 0; t < n; t++)
+					{
+						const double a = -2.0 * pi * double((k * t) % n) / double(n);
+						sr += (x[2 * t] * std::cos(a)) - (x[(2 * t) + 1] * std::sin(a));
+						si += (x[2 * t] * std::sin(a)) + (x[(2 * t) + 1] * std::cos(a));
+					}
+					err = std::max(err, std::max(std::fabs(sr - y[2 * k]), std::fabs(si - y[(2 * k) + 1])));
+					mag = std::max(mag, std::max(std::fabs(sr), std::fabs(si)));
+				}
+			}
+			// forward then inverse, scaled by n
+			cf.inverse(y.data(), z.data());
+			double rt = 0;
+			for (size_t k = 0; k < n * 2; k++)
+				rt = std::max(rt, std::fabs((z[k] / double(n)) - x[k]));
+			// real against complex of the same input
+			for (size_t k = 0; k < n; k++)
+			{
+				z[2 * k] = r[k];
+				z[(2 * k) + 1] = 0;
+			}
+			cf.forward(z.data(), y.data());
+			rf.forward(r.data(), rb.data());
+			double re = 0;
+			double rmag = 0;
+			for (size_t k = 0; k < rb.size(); k++)
+			{
+				re = std::max(re, double(std::fabs(rb[k] - y[k])));
+				rmag = std::max(rmag, double(std::fabs(y[k])));
+			}
+			rf.inverse(rb.data(), z.data());
+			double rrt = 0;
+			for (size_t k = 0; k < n; k++)
+				rrt = std::max(rrt, std::fabs((z[k] / double(n)) - r[k]));
+			// a batch of 4 real transforms, strided apart
+			std::vector<float> bi(n * 4), bo(rb.size() * 4);
+			for (auto& v : bi)
+				v = noise(seed);
+			rf.forward(bi.data(), n, bo.data(), rb.size(), 4);
+			double be = 0;
+			for (size_t b = 0; b < 4; b++)
+			{
+				rf.forward(bi.data() + (b * n), rb.data());
+				for (size_t k = 0; k < rb.size(); k++)
+					be = std::max(be, double(std::fabs(rb[k] - bo[(b * rb.size()) + k])));
+			}
+			const bool ok = (n > 1024 || err <= 1e-5 * mag) && rt <= 1e-5 && re <= 1e-5 * rmag && rrt <= 1e-5 && be == 0;
+			// time per transform
+			using clock_t = std::chrono::steady_clock;
+			const size_t reps = std::max<size_t>(4, (size_t(1) << 22) / n);
+			clock_t::time_point t0 = clock_t::now();
+			for (size_t i = 0; i < reps; i++)
+				cf.forward(x.data(), y.data());
+			const double tc = std::chrono::duration<double>(clock_t::now() - t0).count() / double(reps);
+			t0 = clock_t::now();
+			for (size_t i = 0; i < reps; i++)
+				rf.forward(r.data(), rb.data());
+			const double tr = std::chrono::duration<double>(clock_t::now() - t0).count() / double(reps);
+			const std::string name = nv2::sprintf("fft %zu, complex %.2fus real %.2fus", n, tc * 1e6, tr * 1e6);
+			failed += check(name.c_str(), ok);
+		}
+		return failed;
+	}
+
+	//-----------------------------------------------------------------------------
+	// partitioned convolution against direct convolution, with and
+	// without helper threads
+	static
+		int test_convolver()
+	{
+		const size_t frames = 1000;
+		const size_t block = 64;
+		const size_t samples = block * 40;
+		const size_t channels = 2;
+		uint32_t seed = 2;
+		std::vector<float> ir(frames * channels), x(samples * channels);
+		for (auto& v : ir)
+			v = noise(seed) * 0.1f;
+		for (auto& v : x)
+			v = noise(seed);
+		auto cir = ConvolutionIR::create(SampleView(ir.data(), frames, channels), block);
+		int failed = check("convolver IR", cir != nullptr && cir->partitions() == 16);
+		if (!cir)
+			return failed;
+		for (size_t threads : { 0, 2 })
+		{
+			ConvolutionProcessor::Options options;
+			options.threads = threads;
+			ConvolutionProcessor cp(cir, channels, channels, options);
+			std::vector<float> y(samples * channels);
+			for (size_t pos = 0; pos < samples; pos += block)
+				cp.process(y.data() + (pos * channels), x.data() + (pos * channels), block, channels, channels, 48000, 0, 0);
+			double err = 0;
+			double mag = 0;
+			for (size_t n = 0; n < samples; n++)
+			{
+				for (size_t c = 0; c < channels; c++)
+				{
+					double s = 0;
+					for (size_t k = 0; k < frames && k <= n; k++)
+						s += double(ir[(k * channels) + c]) * x[((n - k) * channels) + c];
+					err = std::max(err, std::fabs(s - y[(n * channels) + c]));
+					mag = std::max(mag, std::fabs(s));
+				}
+			}
+			const std::string name = nv2::sprintf("convolver against direct, %zu helpers", threads);
+			failed += check(name.c_str(), err <= 1e-5 * mag && cp.mismatches() == 0);
+		}
+		return failed;
+	}
+
+	//-----------------------------------------------------------------------------
+	// STFT into ISTFT gives the input back, fed in irregular blocks, and
+	// analyze() covers the same frames
+	static
+		int test_stft()
+	{
+		const size_t channels = 2;
+		const size_t frames = 48000 + 37;
+		SampleData sd;
+		sd.channels = channels;
+		sd.sampleRate = 48000;
+		sd.buffer.resize(frames * channels);
+		sd.samples = sd.buffer.size();
+		uint32_t seed = 3;
+		for (auto& v : sd.buffer)
+			v = noise(seed) * 0.5f;
+		StftOptions options;
+		options.size = 1024;
+		options.hop = 256;
+		options.batch = 7;
+		std::vector<float> out[channels];
+		ISTFT istft(channels, options, [&](const PlanarSampleView& v)
+		{
+			for (size_t c = 0; c < channels; c++)
+				for (size_t f = 0; f < v.frames; f++)
+					out[c].push_back(v.at(f, c));
+		});
+		STFT stft(channels, options, [&](const STFT::Spectra& s) { istft.add(s); });
+		size_t pos = 0;
+		size_t n = 1;
+		while (pos < frames)
+		{
+			n = std::min(frames - pos, n);
+			stft.add(SampleView(sd.buffer.data() + (pos * channels), n, channels));
+			pos += n;
+			n = ((n * 7) + 13) % 900 + 1;
+		}
+		stft.flush();
+		bool ok = (out[0].size() >= frames && out[1].size() >= frames);
+		double err = 0;
+		for (size_t c = 0; ok && c < channels; c++)
+			for (size_t f = 0; f < frames; f++)
+				err = std::max(err, double(std::fabs(out[c][f] - sd.buffer[(f * channels) + c])));
+		int failed = check("stft round trip", ok && err <= 1e-5);
+		std::atomic<int64_t> analyzed{ 0 };
+		const int64_t total = STFT::analyze(sd, options, [&](const STFT::Spectra& s) { analyzed += int64_t(s.frames); }, 2);
+		failed += check("stft analyze", total == stft.frames() && analyzed == total);
+		options.size = 1000;
+		failed += check("stft analyze size", STFT::analyze(sd, options, [](const STFT::Spectra&) {}) == 0);
+		return failed;
+	}
+
+	//-----------------------------------------------------------------------------
+	// passes input to output and notes the time of each block it is given
+	class BlockLog : public IDuplexProcessor<float>
+	{
+	public:
+		std::vector<double> times;
+		std::vector<size_t> frames;
+		//
+		virtual int process(const ipview_t& ip, const opview_t& op, unsigned int, double streamTime, RtAudioStreamStatus)
+		{
+			times.push_back(streamTime);
+			frames.push_back(op.frames);
+			InterleavedRing<float>::copy(ip, op);
+			return 0;
+		}
+		//
+		virtual int process(float* outputBuffer, float* inputBuffer, unsigned int samples, unsigned int ipChannels, unsigned int opChannels,
+							unsigned int sampleRate, double streamTime, RtAudioStreamStatus status)
+		{
+			return process(ipview_t(inputBuffer, samples, ipChannels), opview_t(outputBuffer, samples, opChannels), sampleRate, streamTime, status);
+		}
+		using IDuplexProcessor<float>::process;
+	};
+
+	//-----------------------------------------------------------------------------
+	// reblocking: whole blocks run in place with no delay, the first uneven
+	// host buffer inserts exactly one block of silence, and every block the
+	// wrapped processor sees, including those completed from a partial
+	// block, carries the time of its first frame
+	static
+		int test_reblock()
+	{
+		const size_t block = 64;
+		const size_t channels = 2;
+		const unsigned int rate = 48000;
+		const size_t sizes[] = { 64, 128, 100, 37, 5, 300, 64, 1000, 27 };
+		size_t total = 0;
+		for (size_t n : sizes)
+			total += n;
+		std::vector<float> ip(total * channels), op(total * channels);
+		for (size_t k = 0; k < ip.size(); k++)
+			ip[k] = float(k + 1);
+		BlockLog log;
+		ReblockProcessor<float> rb(&log, block, channels, channels);
+		size_t pos = 0;
+		size_t inPlace = 0;
+		for (size_t n : sizes)
+		{
+			rb.process(op.data() + (pos * channels), ip.data() + (pos * channels), (unsigned int)n, channels, channels, rate, double(pos) / rate, 0);
+			if (rb.latency() == 0)
+				inPlace = pos + n;
+			pos += n;
+		}
+		// 192 frames in place, then the same frames a block late
+		bool ok = (inPlace == 192 && rb.latency() == block);
+		for (size_t f = 0; ok && f < total; f++)
+		{
+			for (size_t c = 0; c < channels; c++)
+			{
+				float want = 0;
+				if (f < inPlace)
+					want = ip[(f * channels) + c];
+				else if (f >= inPlace + block)
+					want = ip[((f - block) * channels) + c];
+				ok = ok && (op[(f * channels) + c] == want);
+			}
+		}
+		int failed = check("reblock one block delay", ok);
+		ok = (log.times.size() == total / block);
+		for (size_t b = 0; ok && b < log.times.size(); b++)
+			ok = (log.frames[b] == block && std::fabs(log.times[b] - (double(b * block) / rate)) < 1e-9);
+		failed += check("reblock block times", ok);
+		return failed;
+	}
+
+	//-----------------------------------------------------------------------------
+	// recording: pre-roll lands first and in time order even after the
+	// history has wrapped, followed by what arrives once started. without
+	// pre-roll only the latter is written
+	static
+		int test_recorder()
+	{
+		const unsigned int channels = 2;
+		const unsigned int rate = 8000;
+		const char* filename = "test_recorder.wav";
+		int failed = 0;
+		for (double preroll : { 0.01, 0.0 })
+		{
+			RecorderProcessor::Options options;
+			options.preroll = preroll;
+			RecorderProcessor rec(channels, rate, options);
+			// sample k is written as k after the 16 bit conversion
+			std::vector<float> ip(250 * channels), op(250 * channels);
+			for (size_t k = 0; k < ip.size(); k++)
+				ip[k] = (float(k) + 0.5f) / 32767.0f;
+			size_t pos = 0;
+			for (; pos < 200; pos += 25)
+				rec.process(op.data(), ip.data() + (pos * channels), 25, channels, channels, rate, 0, 0);
+			bool ok = rec.Start(filename);
+			for (; pos < 250; pos += 25)
+				rec.process(op.data(), ip.data() + (pos * channels), 25, channels, channels, rate, 0, 0);
+			ok = ok && rec.Stop();
+			// 80 frames of pre-roll, the newest
+			const size_t first = (preroll > 0 ? 200 - size_t(preroll * rate) : 200);
+			nv2::wav::Reader reader;
+			ok = ok && reader.open(filename) && reader.frames() == 250 - first;
+			std::vector<short> pcm(reader.frames() * channels);
+			ok = ok && reader.read(pcm.data(), reader.frames()) == reader.frames();
+			for (size_t k = 0; ok && k < pcm.size(); k++)
+				ok = (pcm[k] == short((first * channels) + k));
+			reader.close();
+			std::remove(filename);
+			failed += check(preroll > 0 ? "recorder pre-roll order" : "recorder without pre-roll", ok);
+		}
+		return failed;
+	}
+
+	//-----------------------------------------------------------------------------
+	// returns the number of failed checks
+	static
+		int test() {
+		int failed = 0;
+		failed += test_rs4_request();
+		failed += test_rings();
+		failed += test_mpmc();
+		failed += test_pool();
+		failed += test_fft();
+		failed += test_convolver();
+		failed += test_stft();
+		failed += test_reblock();
+		failed += test_recorder();
+		return failed;
+	}
+}
+